@@ -0,0 +1,10 @@
+@echo off
+if not exist build (
+  mkdir build
+)
+
+pushd build
+
+clang -g -o atlas_baker.exe ../build_atlas_baker.c -O0 -std=c11 -D_CRT_SECURE_NO_WARNINGS -Wextra -Wno-incompatible-library-redeclaration -Wno-sign-compare -Wno-unused-parameter -Wno-builtin-requires-header -lkernel32 -luser32 -lwinmm -lshlwapi -lole32 -lsynchronization -ldbghelp -femit-all-decls
+
+popd
\ No newline at end of file
@@ -0,0 +1,29 @@
+
+///
+// Sprite atlas baker. Build with build_atlas_baker.bat and run:
+//
+//     atlas_baker.exe <directory with pngs> <output .atlas file>
+//
+// e.g. "atlas_baker.exe ../resources ../resources/sprites.atlas" from the build directory.
+// Load the result with sprite_atlas_load() (see oogabooga/sprite_atlas.c).
+
+#define INITIAL_PROGRAM_MEMORY_SIZE MB(5)
+
+// No window, but the null renderer keeps the gfx api (the baker shares the atlas packing code)
+#define OOGABOOGA_HEADLESS 1
+#define GFX_RENDERER GFX_RENDERER_NULL
+
+#define ENTRY_PROC entry
+
+#include "oogabooga/oogabooga.c"
+
+int entry(int argc, char **argv) {
+	if (argc != 3) {
+		print("Usage: %cs <directory with pngs> <output .atlas file>\n", argc > 0 ? argv[0] : "atlas_baker");
+		return 1;
+	}
+	
+	bool ok = bake_sprite_atlas(STR(argv[1]), STR(argv[2]));
+	
+	return ok ? 0 : 1;
+}
@@ -89,6 +89,15 @@ typedef enum SpriteID {
 
 Sprite sprites[SPRITE_MAX];
 
+// Baked with build_atlas_baker.c, the sprites are loaded as separate pngs if it's missing
+Sprite_Atlas sprite_atlas;
+
+Gfx_Image* load_sprite_image(string name) {
+	Gfx_Image* image = sprite_atlas_get(&sprite_atlas, name);
+	if (image) return image;
+	return load_image_from_disk(tprint("resources/%s.png", name), get_heap_allocator());
+}
+
 Sprite* get_sprite(SpriteID id) {
 	if (id >= 0 && id < SPRITE_MAX){
 		return &sprites[id];
@@ -272,12 +281,15 @@ int entry(int argc, char **argv) {
 	memset(world, 0, sizeof(World));
 	
 	// :sprites
-	sprites[0] = (Sprite){ .image = load_image_from_disk(STR("resources/missing_texture.png"), get_heap_allocator())};
-	sprites[SPRITE_player] = (Sprite){ .image = load_image_from_disk(STR("resources/player.png"), get_heap_allocator())};
-	sprites[SPRITE_plastic_0] = (Sprite){ .image = load_image_from_disk(STR("resources/plastic_0.png"), get_heap_allocator())};
-	sprites[SPRITE_wood] = (Sprite){ .image = load_image_from_disk(STR("resources/wood.png"), get_heap_allocator())};
-	sprites[SPRITE_item_plastic] = (Sprite){ .image = load_image_from_disk(STR("resources/item_plastic.png"), get_heap_allocator())};
-	sprites[SPRITE_item_wood] = (Sprite){ .image = load_image_from_disk(STR("resources/item_wood.png"), get_heap_allocator())};
+	if (os_is_file(STR("resources/sprites.atlas"))) {
+		sprite_atlas_load(&sprite_atlas, STR("resources/sprites.atlas"), get_heap_allocator());
+	}
+	sprites[0] = (Sprite){ .image = load_sprite_image(STR("missing_texture"))};
+	sprites[SPRITE_player] = (Sprite){ .image = load_sprite_image(STR("player"))};
+	sprites[SPRITE_plastic_0] = (Sprite){ .image = load_sprite_image(STR("plastic_0"))};
+	sprites[SPRITE_wood] = (Sprite){ .image = load_sprite_image(STR("wood"))};
+	sprites[SPRITE_item_plastic] = (Sprite){ .image = load_sprite_image(STR("item_plastic"))};
+	sprites[SPRITE_item_wood] = (Sprite){ .image = load_sprite_image(STR("item_wood"))};
 
 	// :font
 	Gfx_Font *font = load_font_from_disk(STR("C:/windows/fonts/arial.ttf"), get_heap_allocator());
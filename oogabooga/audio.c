@@ -56,10 +56,14 @@ typedef struct Audio_Format {
 // Implemented per OS
 ogb_instance Audio_Format audio_output_format; 
 ogb_instance Mutex audio_init_mutex;
+// Audio sources are copied by value into players, so this can't live in the source.
+// It's held while a source is sampled on the audio thread & while a source is destroyed.
+ogb_instance Mutex audio_source_destroy_mutex;
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 Audio_Format audio_output_format; 
 Mutex audio_init_mutex;
+Mutex audio_source_destroy_mutex;
 #endif
 
 // I don't see a big reason for you to use anything else than WAV and OGG.
@@ -134,8 +138,6 @@ typedef struct Audio_Source {
 	// For memory source
 	void *pcm_frames;
 	
-	Mutex mutex_for_destroy; // This should ONLY be used so a source isnt sampled on audio thread while it's being destroyed
-	
 } Audio_Source;
 
 int 
@@ -546,8 +548,6 @@ audio_open_source_stream_format(Audio_Source *src, string path, Audio_Format for
 							    Allocator allocator) {
 	*src = ZERO(Audio_Source);
 	
-	mutex_init(&src->mutex_for_destroy);
-	
 	src->allocator = allocator;
 	src->kind = AUDIO_SOURCE_FILE_STREAM;
 	
@@ -601,8 +601,6 @@ audio_open_source_load_format(Audio_Source *src, string path, Audio_Format forma
 							  Allocator allocator) {
 	*src = ZERO(Audio_Source);
 	
-	mutex_init(&src->mutex_for_destroy);
-	
 	src->allocator = allocator;
 	src->kind = AUDIO_SOURCE_MEMORY;
 	src->format = format;
@@ -674,7 +672,7 @@ audio_open_source_load(Audio_Source *src, string path, Allocator allocator) {
 void 
 audio_source_destroy(Audio_Source *src) {
 
-	mutex_acquire_or_wait(&src->mutex_for_destroy);
+	mutex_acquire_or_wait(&audio_source_destroy_mutex);
 
 	switch (src->kind) {
 		case AUDIO_SOURCE_FILE_STREAM: {
@@ -699,7 +697,7 @@ audio_source_destroy(Audio_Source *src) {
 		}
 	}
 	
-	mutex_release(&src->mutex_for_destroy);
+	mutex_release(&audio_source_destroy_mutex);
 }
 
 int
@@ -1163,7 +1161,8 @@ typedef struct Audio_Player {
 	bool release_when_done;
 	// I think we only need to sync when audio thread samples the source, which should be
 	// very quick and low contention, hence a spinlock.
-	Spinlock sample_lock; 
+	// Ticket lock so the audio thread can't get starved by the game thread poking the player.
+	Ticket_Lock sample_lock; 
 	
 	// These can be set safely
 	Vector3 position; // ndc space -1 to 1
@@ -1232,7 +1231,7 @@ audio_player_set_state(Audio_Player *p, Audio_Player_State state) {
 
 	if (p->state == state) return;
 
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	p->state = state;
 	
@@ -1248,11 +1247,11 @@ audio_player_set_state(Audio_Player *p, Audio_Player_State state) {
 	p->fade_frames = (u64)round(fade_factor*(float64)p->source.number_of_frames);
 	p->fade_frames_total = p->fade_frames;
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 void
 audio_player_set_time_stamp(Audio_Player *p, float64 time_in_seconds) {
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	
 	float64 full_duration 
@@ -1262,39 +1261,39 @@ audio_player_set_time_stamp(Audio_Player *p, float64 time_in_seconds) {
 	
 	p->frame_index = (u64)round((float64)p->source.number_of_frames*progression);
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 void // 0 - 1
 audio_player_set_progression_factor(Audio_Player *p, float64 factor) {
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	
 	p->frame_index = (u64)round((float64)p->source.number_of_frames*factor);
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 float64 // seconds
 audio_player_get_time_stamp(Audio_Player *p) {
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	
 	float64 full_duration 
 		= (float64)p->source.number_of_frames/(float64)p->source.format.sample_rate;
 	float64 progression = (float64)p->frame_index / (float64)p->source.number_of_frames;
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 	
 	return progression*full_duration;
 }
 float64
 audio_player_get_current_progression_factor(Audio_Player *p) {
 	if (!p->has_source) return 0;
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	
 	float64 progression = (float64)p->frame_index / (float64)p->source.number_of_frames;
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 	
 	return progression;
 }
@@ -1303,7 +1302,7 @@ audio_player_set_source(Audio_Player *p, Audio_Source src, bool retain_progressi
 
 	float64 last_progression = audio_player_get_current_progression_factor(p);
 	
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 
 	p->source = src;
 	p->has_source = true;
@@ -1314,22 +1313,22 @@ audio_player_set_source(Audio_Player *p, Audio_Source src, bool retain_progressi
 		p->frame_index = 0;
 	}
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 void 
 audio_player_clear_source(Audio_Player *p) {
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	assert(p->frame_index <= p->source.number_of_frames);
 	
 	p->has_source = false;
 	p->state = AUDIO_PLAYER_STATE_PAUSED;
 	p->source = ZERO(Audio_Source);
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 void
 audio_player_set_looping(Audio_Player *p, bool looping) {
-	spinlock_acquire_or_wait(&p->sample_lock);
+	ticket_lock_acquire_or_wait(&p->sample_lock);
 	
 	if (p->has_source && looping && !p->looping && p->frame_index == p->source.number_of_frames) {
 		p->frame_index = 0;
@@ -1337,7 +1336,7 @@ audio_player_set_looping(Audio_Player *p, bool looping) {
 	
 	p->looping = looping;
 	
-	spinlock_release(&p->sample_lock);
+	ticket_lock_release(&p->sample_lock);
 }
 
 // #Global
@@ -1622,6 +1621,7 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 	
 	memset(mix_buffer, 0, mix_buffer_size);
 	
+	u64 active_voices = 0;
 	
 	while (block) {
 		
@@ -1645,11 +1645,13 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 				if (p->fade_frames == 0) continue;
 			}
 			
-			spinlock_acquire_or_wait(&p->sample_lock);
+			active_voices += 1;
+			
+			ticket_lock_acquire_or_wait(&p->sample_lock);
 			
 			Audio_Source src = p->source;
 			
-			mutex_acquire_or_wait(&src.mutex_for_destroy);
+			mutex_acquire_or_wait(&audio_source_destroy_mutex);
 			
 			bool need_convert = !bytes_match(
 				&out_format, 
@@ -1761,7 +1763,7 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 				}
 			}
 			
-			spinlock_release(&p->sample_lock);
+			ticket_lock_release(&p->sample_lock);
 						
 			if (need_convert) {
 				int converted = convert_frames(
@@ -1783,9 +1785,11 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 			
 			mix_frames(output, mix_buffer, number_of_output_frames, out_format);
 			
-			mutex_release(&src.mutex_for_destroy);
+			mutex_release(&audio_source_destroy_mutex);
 		}
 		
 		block = block->next;
 	}
+	
+	tm_counter("Audio voices active", active_voices);
 }
\ No newline at end of file
@@ -0,0 +1,1282 @@
+
+/*
+	Benchmarks for the core library. Enable with RUN_BENCHMARKS, no window is needed for them
+	but the audio benchmarks only exist when not headless, and drawing & text only with
+	graphics (or the null renderer).
+
+	Every benchmark is warmed up, then timed over BENCHMARK_RUNS runs of the same number of ops.
+	Results are in ns per op and written to BENCHMARK_OUTPUT_PATH as json with one benchmark
+	per line, so two runs can be diffed between commits to catch regressions.
+
+	Your own code can be measured the same way:
+
+		void my_benchmark(u64 op_count, void *data) {
+			for (u64 i = 0; i < op_count; i++) benchmark_sink += do_thing(i);
+		}
+		Benchmark_Result r = benchmark_run(STR("do_thing"), 1000, 0, my_benchmark, 0);
+
+	The setup proc (may be 0) runs before every run and is not timed.
+*/
+
+#ifndef BENCHMARK_WARMUP_RUNS
+	#define BENCHMARK_WARMUP_RUNS 3
+#endif
+#ifndef BENCHMARK_RUNS
+	#define BENCHMARK_RUNS 21
+#endif
+#ifndef BENCHMARK_OUTPUT_PATH
+	#define BENCHMARK_OUTPUT_PATH "oogabooga_benchmarks.json"
+#endif
+#define BENCHMARK_JSON_VERSION 2
+
+typedef void (*Benchmark_Proc)(u64 op_count, void *data);
+
+// Times are ns per op
+typedef struct Benchmark_Result {
+	string name;
+	u64 ops_per_run;
+	u64 runs;
+	f64 min_ns;
+	f64 median_ns;
+	f64 mean_ns;
+	f64 stddev_ns;
+	f64 bytes_per_op; // Set by the caller for benchmarks that produce data, 0 otherwise
+} Benchmark_Result;
+
+// Benchmarks add results here so the work isn't optimized away
+volatile u64 benchmark_sink = 0;
+
+int _benchmark_compare_f64(const void *a, const void *b) {
+	f64 x = *(const f64*)a;
+	f64 y = *(const f64*)b;
+	return (x > y) - (x < y);
+}
+
+Benchmark_Result benchmark_run(string name, u64 ops_per_run, Benchmark_Proc setup, Benchmark_Proc proc, void *data) {
+	assert(ops_per_run > 0, "Benchmark '%s' needs at least one op per run", name);
+
+	for (u64 i = 0; i < BENCHMARK_WARMUP_RUNS; i++) {
+		if (setup) setup(ops_per_run, data);
+		proc(ops_per_run, data);
+	}
+
+	f64 times[BENCHMARK_RUNS];
+	f64 help[BENCHMARK_RUNS];
+	f64 sum = 0;
+	for (u64 i = 0; i < BENCHMARK_RUNS; i++) {
+		if (setup) setup(ops_per_run, data);
+
+		u64 start = rdtsc();
+		proc(ops_per_run, data);
+		u64 cycles = rdtsc()-start;
+
+		times[i] = cycles_to_seconds(cycles)*1000000000.0/(f64)ops_per_run;
+		sum += times[i];
+	}
+	merge_sort(times, help, BENCHMARK_RUNS, sizeof(f64), _benchmark_compare_f64);
+
+	Benchmark_Result r = {0};
+	r.name = name;
+	r.ops_per_run = ops_per_run;
+	r.runs = BENCHMARK_RUNS;
+	r.min_ns = times[0];
+	r.median_ns = times[BENCHMARK_RUNS/2];
+	r.mean_ns = sum/BENCHMARK_RUNS;
+	f64 variance = 0;
+	for (u64 i = 0; i < BENCHMARK_RUNS; i++) {
+		variance += (times[i]-r.mean_ns)*(times[i]-r.mean_ns);
+	}
+	r.stddev_ns = sqrt(variance/BENCHMARK_RUNS);
+	return r;
+}
+
+///
+// Memory
+
+void benchmark_heap_64(u64 op_count, void *data) {
+	for (u64 i = 0; i < op_count; i++) {
+		void *p = alloc(get_heap_allocator(), 64);
+		benchmark_sink += (u64)p;
+		dealloc(get_heap_allocator(), p);
+	}
+}
+void benchmark_heap_4k(u64 op_count, void *data) {
+	for (u64 i = 0; i < op_count; i++) {
+		void *p = alloc(get_heap_allocator(), 4096);
+		benchmark_sink += (u64)p;
+		dealloc(get_heap_allocator(), p);
+	}
+}
+// Allocate all, then free every other and then the rest, which fragments the free list
+void benchmark_heap_mixed(u64 op_count, void *data) {
+	void **pointers = (void**)data;
+	for (u64 i = 0; i < op_count; i++) {
+		pointers[i] = alloc(get_heap_allocator(), 16 + (i*37)%2048);
+	}
+	for (u64 i = 0; i < op_count; i += 2) dealloc(get_heap_allocator(), pointers[i]);
+	for (u64 i = 1; i < op_count; i += 2) dealloc(get_heap_allocator(), pointers[i]);
+}
+void benchmark_temp_reset(u64 op_count, void *data) {
+	reset_temporary_storage();
+}
+void benchmark_talloc_64(u64 op_count, void *data) {
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += (u64)talloc(64);
+	}
+}
+
+///
+// Hash table
+
+typedef struct Benchmark_Hash_Data {
+	Hash_Table table;
+	u64 *keys;
+} Benchmark_Hash_Data;
+
+void benchmark_hash_reset(u64 op_count, void *data) {
+	hash_table_reset(&((Benchmark_Hash_Data*)data)->table);
+}
+void benchmark_hash_set(u64 op_count, void *data) {
+	Benchmark_Hash_Data *d = (Benchmark_Hash_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		u64 key = d->keys[i];
+		hash_table_set(&d->table, key, i);
+	}
+}
+void benchmark_hash_fill(u64 op_count, void *data) {
+	benchmark_hash_reset(op_count, data);
+	benchmark_hash_set(op_count, data);
+}
+void benchmark_hash_find_hit(u64 op_count, void *data) {
+	Benchmark_Hash_Data *d = (Benchmark_Hash_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		u64 key = d->keys[i];
+		benchmark_sink += (u64)hash_table_find(&d->table, key);
+	}
+}
+void benchmark_hash_find_miss(u64 op_count, void *data) {
+	Benchmark_Hash_Data *d = (Benchmark_Hash_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		u64 key = d->keys[i]+1; // Keys are even
+		benchmark_sink += (u64)hash_table_find(&d->table, key);
+	}
+}
+
+///
+// Strings & formatting
+
+typedef struct Benchmark_String_Data {
+	string text; // ~1kb
+	string needle;
+	string a;
+	string b;
+} Benchmark_String_Data;
+
+void benchmark_strings_match(u64 op_count, void *data) {
+	Benchmark_String_Data *d = (Benchmark_String_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += strings_match(d->a, d->b);
+	}
+}
+void benchmark_string_find(u64 op_count, void *data) {
+	Benchmark_String_Data *d = (Benchmark_String_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += (u64)string_find_from_left(d->text, d->needle);
+	}
+}
+void benchmark_string_concat(u64 op_count, void *data) {
+	Benchmark_String_Data *d = (Benchmark_String_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += string_concat(d->a, d->b, get_temporary_allocator()).count;
+	}
+}
+void benchmark_string_replace_all(u64 op_count, void *data) {
+	Benchmark_String_Data *d = (Benchmark_String_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += string_replace_all(d->text, STR("ooga"), STR("booga"), get_temporary_allocator()).count;
+	}
+}
+void benchmark_tprint(u64 op_count, void *data) {
+	for (u64 i = 0; i < op_count; i++) {
+		benchmark_sink += tprint("Entity %d named %s at %.3f", (int)i, STR("Bob"), (f64)i*0.5).count;
+	}
+}
+void benchmark_string_builder_print(u64 op_count, void *data) {
+	String_Builder *sb = (String_Builder*)data;
+	sb->count = 0;
+	for (u64 i = 0; i < op_count; i++) {
+		string_builder_print(sb, "{\"id\":%llu,\"value\":%.3f},", i, (f64)i*0.5);
+	}
+	benchmark_sink += sb->count;
+}
+
+///
+// Sorting
+
+typedef struct Benchmark_Sort_Item {
+	u64 key;
+	u64 payload;
+} Benchmark_Sort_Item;
+typedef struct Benchmark_Sort_Data {
+	Benchmark_Sort_Item *items;
+	Benchmark_Sort_Item *help;
+	Benchmark_Sort_Item *unsorted;
+} Benchmark_Sort_Data;
+
+void benchmark_sort_setup(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	memcpy(d->items, d->unsorted, op_count*sizeof(Benchmark_Sort_Item));
+}
+void benchmark_radix_sort(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	radix_sort(d->items, d->help, op_count, sizeof(Benchmark_Sort_Item), offsetof(Benchmark_Sort_Item, key), 21);
+	benchmark_sink += d->items[0].payload;
+}
+
+///
+// Linmath
+
+#define BENCHMARK_MATRIX_COUNT 256
+void benchmark_m4_mul(u64 op_count, void *data) {
+	Matrix4 *m = (Matrix4*)data;
+	Matrix4 r = m4_scalar(1.0);
+	for (u64 i = 0; i < op_count; i++) {
+		r = m4_mul(m[i%BENCHMARK_MATRIX_COUNT], r);
+	}
+	benchmark_sink += (u64)r.m[0][0];
+}
+void benchmark_m4_inverse(u64 op_count, void *data) {
+	Matrix4 *m = (Matrix4*)data;
+	f32 sum = 0;
+	for (u64 i = 0; i < op_count; i++) {
+		sum += m4_inverse(m[i%BENCHMARK_MATRIX_COUNT]).m[0][0];
+	}
+	benchmark_sink += (u64)sum;
+}
+
+///
+// Jobs
+
+#define BENCHMARK_JOB_CHILD_COUNT 64
+#define BENCHMARK_JOB_WORK 2000
+typedef struct Benchmark_Job_Data {
+	volatile u64 sink;
+} Benchmark_Job_Data;
+void benchmark_job_work(void *data) {
+	Benchmark_Job_Data *d = (Benchmark_Job_Data*)data;
+	u64 x = 0;
+	for (u64 i = 0; i < BENCHMARK_JOB_WORK; i++) {
+		x = x*6364136223846793005ull + 1442695040888963407ull;
+	}
+	d->sink = x;
+}
+void benchmark_job_fan_out(void *data) {
+	Job jobs[BENCHMARK_JOB_CHILD_COUNT];
+	for (u64 i = 0; i < BENCHMARK_JOB_CHILD_COUNT; i++) {
+		jobs[i].proc = benchmark_job_work;
+		jobs[i].data = data;
+	}
+	Job_Counter children = {0};
+	jobs_run(jobs, BENCHMARK_JOB_CHILD_COUNT, &children);
+	job_wait(&children);
+}
+// Jobs that spawn & wait on jobs, ops are the leaf jobs
+void benchmark_jobs_fan_out(u64 op_count, void *data) {
+	Job_Counter counter = {0};
+	for (u64 i = 0; i < op_count/BENCHMARK_JOB_CHILD_COUNT; i++) {
+		job_run(benchmark_job_fan_out, data, &counter);
+	}
+	job_wait(&counter);
+}
+
+///
+// Threads, locks & queues
+
+// Spawned threads keep their temporary storage, so threads are started once per
+// configuration and woken for every run instead of being spawned in every run.
+#define BENCHMARK_MAX_THREADS 128
+typedef void (*Benchmark_Thread_Proc)(u64 thread_index, void *data);
+typedef struct Benchmark_Threads {
+	Thread threads[BENCHMARK_MAX_THREADS];
+	u64 count;
+	Benchmark_Thread_Proc proc;
+	void *data;
+	volatile u64 run;
+	volatile u64 done_count;
+	volatile bool quit;
+} Benchmark_Threads;
+void _benchmark_thread(Thread *t) {
+	Benchmark_Threads *g = (Benchmark_Threads*)t->data;
+	u64 thread_index = t-g->threads;
+	u64 seen_run = 0;
+	while (true) {
+		while (atomic_load_64(&g->run, MEMORY_ORDER_ACQUIRE) == seen_run && !g->quit) os_yield_thread();
+		if (g->quit) return;
+		seen_run += 1;
+		g->proc(thread_index, g->data);
+		atomic_fetch_add_64(&g->done_count, 1);
+	}
+}
+void benchmark_threads_start(Benchmark_Threads *g, u64 count, Benchmark_Thread_Proc proc, void *data) {
+	assert(count <= BENCHMARK_MAX_THREADS, "Too many benchmark threads");
+	g->count = count;
+	g->proc = proc;
+	g->data = data;
+	g->run = 0;
+	g->done_count = 0;
+	g->quit = false;
+	for (u64 i = 0; i < count; i++) {
+		os_thread_init(&g->threads[i], _benchmark_thread);
+		g->threads[i].data = g;
+		os_thread_start(&g->threads[i]);
+	}
+}
+void benchmark_threads_kick(Benchmark_Threads *g) {
+	g->done_count = 0;
+	atomic_fetch_add_64(&g->run, 1);
+}
+void benchmark_threads_wait(Benchmark_Threads *g) {
+	while (atomic_load_64(&g->done_count, MEMORY_ORDER_ACQUIRE) < g->count) os_yield_thread();
+}
+void benchmark_threads_stop(Benchmark_Threads *g) {
+	g->quit = true;
+	for (u64 i = 0; i < g->count; i++) {
+		os_thread_destroy(&g->threads[i]);
+	}
+}
+
+typedef enum Benchmark_Lock_Kind {
+	BENCHMARK_LOCK_SPINLOCK,
+	BENCHMARK_LOCK_TICKET_LOCK,
+	BENCHMARK_LOCK_NAIVE,
+	BENCHMARK_LOCK_MUTEX,
+	BENCHMARK_LOCK_OS_MUTEX,
+} Benchmark_Lock_Kind;
+typedef struct Benchmark_Lock_Data {
+	Spinlock spinlock;
+	Ticket_Lock ticket_lock;
+	Mutex mutex;
+	Mutex_Handle os_mutex;
+	volatile bool naive_lock;
+	Benchmark_Lock_Kind kind;
+	u64 counter;
+	u64 locks_per_thread;
+	Benchmark_Threads threads;
+} Benchmark_Lock_Data;
+void benchmark_lock_thread(u64 thread_index, void *data) {
+	Benchmark_Lock_Data *d = (Benchmark_Lock_Data*)data;
+	switch (d->kind) {
+		case BENCHMARK_LOCK_SPINLOCK:
+			for (u64 i = 0; i < d->locks_per_thread; i++) {
+				spinlock_acquire_or_wait(&d->spinlock);
+				d->counter += 1;
+				spinlock_release(&d->spinlock);
+			}
+			break;
+		case BENCHMARK_LOCK_TICKET_LOCK:
+			for (u64 i = 0; i < d->locks_per_thread; i++) {
+				ticket_lock_acquire_or_wait(&d->ticket_lock);
+				d->counter += 1;
+				ticket_lock_release(&d->ticket_lock);
+			}
+			break;
+		case BENCHMARK_LOCK_NAIVE:
+			// What Spinlock used to be: cas in a tight loop, no backoff
+			for (u64 i = 0; i < d->locks_per_thread; i++) {
+				while (!compare_and_swap_bool(&d->naive_lock, true, false)) {
+					while (d->naive_lock) MEMORY_BARRIER;
+				}
+				d->counter += 1;
+				MEMORY_BARRIER;
+				compare_and_swap_bool(&d->naive_lock, false, true);
+			}
+			break;
+		case BENCHMARK_LOCK_MUTEX:
+			for (u64 i = 0; i < d->locks_per_thread; i++) {
+				mutex_acquire_or_wait(&d->mutex);
+				d->counter += 1;
+				mutex_release(&d->mutex);
+			}
+			break;
+		case BENCHMARK_LOCK_OS_MUTEX:
+			for (u64 i = 0; i < d->locks_per_thread; i++) {
+				os_lock_mutex(d->os_mutex);
+				d->counter += 1;
+				os_unlock_mutex(d->os_mutex);
+			}
+			break;
+	}
+}
+void benchmark_lock_setup(u64 op_count, void *data) {
+	Benchmark_Lock_Data *d = (Benchmark_Lock_Data*)data;
+	d->counter = 0;
+	d->locks_per_thread = op_count/d->threads.count;
+}
+// Every thread takes the lock the same number of times, ops are locks
+void benchmark_lock_contended(u64 op_count, void *data) {
+	Benchmark_Lock_Data *d = (Benchmark_Lock_Data*)data;
+	benchmark_threads_kick(&d->threads);
+	benchmark_threads_wait(&d->threads);
+	assert(d->counter == d->threads.count*d->locks_per_thread, "Benchmark lock let more than one thread in");
+}
+typedef struct Benchmark_Semaphore_Data {
+	Binary_Semaphore ping;
+	Binary_Semaphore pong;
+	u64 rounds;
+	Benchmark_Threads threads;
+} Benchmark_Semaphore_Data;
+void benchmark_semaphore_ponger(u64 thread_index, void *data) {
+	Benchmark_Semaphore_Data *d = (Benchmark_Semaphore_Data*)data;
+	for (u64 i = 0; i < d->rounds; i++) {
+		binary_semaphore_wait(&d->ping);
+		binary_semaphore_signal(&d->pong);
+	}
+}
+// Ops are round trips
+void benchmark_semaphore_ping_pong(u64 op_count, void *data) {
+	Benchmark_Semaphore_Data *d = (Benchmark_Semaphore_Data*)data;
+	d->rounds = op_count;
+	benchmark_threads_kick(&d->threads);
+	for (u64 i = 0; i < op_count; i++) {
+		binary_semaphore_signal(&d->ping);
+		binary_semaphore_wait(&d->pong);
+	}
+	benchmark_threads_wait(&d->threads);
+}
+
+#define BENCHMARK_QUEUE_BATCH_SIZE 64
+typedef struct Benchmark_Queue_Data {
+	Spsc_Queue spsc;
+	Mpmc_Queue mpmc;
+	bool batched;
+	u64 producer_count;
+	u64 items_per_producer;
+	volatile u64 popped_count;
+	Benchmark_Threads threads;
+} Benchmark_Queue_Data;
+void benchmark_queue_spsc_producer(u64 thread_index, void *data) {
+	Benchmark_Queue_Data *d = (Benchmark_Queue_Data*)data;
+	u64 batch[BENCHMARK_QUEUE_BATCH_SIZE];
+	u64 i = 0;
+	while (i < d->items_per_producer) {
+		u64 pushed;
+		if (d->batched) {
+			u64 count = min(BENCHMARK_QUEUE_BATCH_SIZE, d->items_per_producer-i);
+			for (u64 j = 0; j < count; j++) batch[j] = i+j;
+			pushed = spsc_queue_push_many(&d->spsc, batch, count);
+		} else {
+			pushed = spsc_queue_push(&d->spsc, &i) ? 1 : 0;
+		}
+		if (pushed == 0) os_yield_thread();
+		i += pushed;
+	}
+}
+// The first half of the threads produce, the rest consume
+void benchmark_queue_mpmc_thread(u64 thread_index, void *data) {
+	Benchmark_Queue_Data *d = (Benchmark_Queue_Data*)data;
+	u64 batch[BENCHMARK_QUEUE_BATCH_SIZE];
+	if (thread_index < d->producer_count) {
+		u64 i = 0;
+		while (i < d->items_per_producer) {
+			u64 pushed;
+			if (d->batched) {
+				u64 count = min(BENCHMARK_QUEUE_BATCH_SIZE, d->items_per_producer-i);
+				for (u64 j = 0; j < count; j++) batch[j] = i+j;
+				pushed = mpmc_queue_push_many(&d->mpmc, batch, count);
+			} else {
+				pushed = mpmc_queue_push(&d->mpmc, &i) ? 1 : 0;
+			}
+			if (pushed == 0) os_yield_thread();
+			i += pushed;
+		}
+	} else {
+		u64 total = d->items_per_producer*d->producer_count;
+		u64 sum = 0;
+		while (atomic_load_64(&d->popped_count, MEMORY_ORDER_ACQUIRE) < total) {
+			u64 popped = d->batched
+				? mpmc_queue_pop_many(&d->mpmc, batch, BENCHMARK_QUEUE_BATCH_SIZE)
+				: (mpmc_queue_pop(&d->mpmc, batch) ? 1 : 0);
+			if (popped == 0) {
+				os_yield_thread();
+				continue;
+			}
+			for (u64 j = 0; j < popped; j++) sum += batch[j];
+			atomic_fetch_add_64(&d->popped_count, popped);
+		}
+		benchmark_sink += sum;
+	}
+}
+// One producer thread, this thread consumes. Ops are items.
+void benchmark_queue_spsc(u64 op_count, void *data) {
+	Benchmark_Queue_Data *d = (Benchmark_Queue_Data*)data;
+	d->items_per_producer = op_count;
+	benchmark_threads_kick(&d->threads);
+
+	u64 batch[BENCHMARK_QUEUE_BATCH_SIZE];
+	u64 popped_count = 0;
+	u64 sum = 0;
+	while (popped_count < op_count) {
+		u64 popped = d->batched
+			? spsc_queue_pop_many(&d->spsc, batch, BENCHMARK_QUEUE_BATCH_SIZE)
+			: (spsc_queue_pop(&d->spsc, batch) ? 1 : 0);
+		if (popped == 0) os_yield_thread();
+		for (u64 j = 0; j < popped; j++) sum += batch[j];
+		popped_count += popped;
+	}
+	benchmark_threads_wait(&d->threads);
+	benchmark_sink += sum;
+}
+// As many producers as consumers. Ops are items.
+void benchmark_queue_mpmc(u64 op_count, void *data) {
+	Benchmark_Queue_Data *d = (Benchmark_Queue_Data*)data;
+	d->items_per_producer = op_count/d->producer_count;
+	d->popped_count = 0;
+	benchmark_threads_kick(&d->threads);
+	benchmark_threads_wait(&d->threads);
+}
+
+///
+// Parallel for
+
+#define BENCHMARK_ENTITY_COUNT (1024*16)
+#define BENCHMARK_QUAD_COUNT (1024*64)
+typedef struct Benchmark_Entity {
+	Vector2 pos;
+	Vector2 velocity;
+	u32 brain_iterations; // Some entities are much more expensive than others
+	bool is_valid;
+} Benchmark_Entity;
+typedef struct Benchmark_Parallel_Data {
+	Benchmark_Entity *entities;
+	Benchmark_Entity *initial_entities;
+	Vector2 *quads_in;
+	Vector2 *quads_out;
+	Matrix4 xform;
+} Benchmark_Parallel_Data;
+void benchmark_update_entities(u64 first, u64 end, void *userdata) {
+	Benchmark_Parallel_Data *d = (Benchmark_Parallel_Data*)userdata;
+	for (u64 i = first; i < end; i++) {
+		Benchmark_Entity *en = &d->entities[i];
+		if (!en->is_valid) continue;
+
+		Vector2 target = en->pos;
+		for (u32 j = 0; j < en->brain_iterations; j++) {
+			target = v2_add(v2_mulf(target, 0.999f), v2(0.001f, 0.002f));
+		}
+		en->velocity = v2_mulf(v2_sub(target, en->pos), 0.5f);
+		en->pos = v2_add(en->pos, v2_mulf(en->velocity, 1.0f/60.0f));
+	}
+}
+void benchmark_transform_quads(u64 first, u64 end, void *userdata) {
+	Benchmark_Parallel_Data *d = (Benchmark_Parallel_Data*)userdata;
+	for (u64 i = first*4; i < end*4; i++) {
+		Vector4 p = m4_transform(d->xform, v4(d->quads_in[i].x, d->quads_in[i].y, 0, 1));
+		d->quads_out[i] = p.xy;
+	}
+}
+void benchmark_entities_setup(u64 op_count, void *data) {
+	Benchmark_Parallel_Data *d = (Benchmark_Parallel_Data*)data;
+	memcpy(d->entities, d->initial_entities, op_count*sizeof(Benchmark_Entity));
+}
+void benchmark_entities_serial(u64 op_count, void *data) {
+	benchmark_update_entities(0, op_count, data);
+}
+void benchmark_entities_parallel(u64 op_count, void *data) {
+	parallel_for(0, op_count, 0, benchmark_update_entities, data);
+}
+void benchmark_quads_serial(u64 op_count, void *data) {
+	benchmark_transform_quads(0, op_count, data);
+}
+void benchmark_quads_parallel(u64 op_count, void *data) {
+	parallel_for(0, op_count, 0, benchmark_transform_quads, data);
+}
+
+///
+// Profiler
+
+#define BENCHMARK_TRACE_PATH "oogabooga_benchmark_trace.ogbtrace"
+#define BENCHMARK_TRACE_JSON_PATH "oogabooga_benchmark_trace.json"
+// Holding the lock keeps the flush thread out, so events stay in this threads ring
+void benchmark_profiler_record(u64 op_count, void *data) {
+	u64 start = rdtsc();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	for (u64 i = 0; i < op_count; i++) {
+		_profiler_report_time_cycles(STR("Benchmark scope"), 10+i, start+i);
+	}
+	spinlock_release(&_profiler_lock);
+}
+void benchmark_profiler_flush_setup(u64 op_count, void *data) {
+	profiler_flush();
+	benchmark_profiler_record(op_count, data);
+}
+void benchmark_profiler_flush(u64 op_count, void *data) {
+	profiler_flush();
+}
+// Record & write to disk, start & stop included
+void benchmark_profiler_stream(u64 op_count, void *data) {
+	assert(profiler_start_streaming(STR(BENCHMARK_TRACE_PATH)), "Could not start profiler streaming");
+	for (u64 i = 0; i < op_count; i++) {
+		_profiler_report_time_cycles(STR("Benchmark scope"), 10, rdtsc());
+	}
+	profiler_stop();
+}
+void benchmark_profiler_convert(u64 op_count, void *data) {
+	assert(profiler_convert_trace_to_json(STR(BENCHMARK_TRACE_PATH), STR(BENCHMARK_TRACE_JSON_PATH)), "Could not convert trace");
+}
+
+#if OOGABOOGA_HAS_GFX
+
+///
+// Batching
+
+#define BENCHMARK_BATCH_QUADS  16384
+#define BENCHMARK_BATCH_QUADS_LARGE 131072 // Above GFX_BATCH_PARALLEL_MIN_QUADS
+#define BENCHMARK_BATCH_IMAGES 40 // More than fit in one draw call
+typedef struct Benchmark_Batch_Data {
+	Gfx_Batch batch;
+	Draw_Quad *quads;
+	Draw_Quad *unsorted;
+	Gfx_Image images[BENCHMARK_BATCH_IMAGES];
+} Benchmark_Batch_Data;
+
+void benchmark_batch_setup(u64 op_count, void *data) {
+	Benchmark_Batch_Data *d = (Benchmark_Batch_Data*)data;
+	memcpy(d->quads, d->unsorted, op_count*sizeof(Draw_Quad));
+}
+void benchmark_draw_setup(u64 op_count, void *data) {
+	reset_draw_frame(&draw_frame);
+}
+void benchmark_draw_image(u64 op_count, void *data) {
+	Benchmark_Batch_Data *d = (Benchmark_Batch_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		Draw_Quad *q = draw_image(&d->images[i%BENCHMARK_BATCH_IMAGES], v2((f32)(i%64)*0.01f, 0), v2(0.01f, 0.01f), COLOR_WHITE);
+		q->z = (s32)(i%64);
+	}
+	benchmark_sink += draw_frame.num_quads;
+}
+void benchmark_draw_image_xform(u64 op_count, void *data) {
+	Benchmark_Batch_Data *d = (Benchmark_Batch_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		Matrix4 xform = m4_make_translation(v3((f32)(i%64)*0.01f, 0, 0));
+		xform = m4_rotate_z(xform, (f32)i*0.01f);
+		draw_image_xform(&d->images[i%BENCHMARK_BATCH_IMAGES], xform, v2(0.01f, 0.01f), COLOR_WHITE);
+	}
+	benchmark_sink += draw_frame.num_quads;
+}
+typedef struct Benchmark_Sprite_Data {
+	Draw_Sprite *sprites;
+	Gfx_Image image;
+} Benchmark_Sprite_Data;
+
+void benchmark_draw_sprites(u64 op_count, void *data) {
+	Benchmark_Sprite_Data *d = (Benchmark_Sprite_Data*)data;
+	benchmark_sink += draw_sprites(d->sprites, op_count);
+}
+void benchmark_draw_sprites_one_by_one(u64 op_count, void *data) {
+	Benchmark_Sprite_Data *d = (Benchmark_Sprite_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		Draw_Sprite *s = &d->sprites[i];
+		draw_image(s->image, s->position, s->size, s->color);
+	}
+	benchmark_sink += draw_frame.num_quads;
+}
+#define BENCHMARK_ATLAS_IMAGES 300
+typedef struct Benchmark_Atlas_Data {
+	Gfx_Batch batch;
+	Draw_Quad *separate; // Every image its own texture
+	Draw_Quad *atlased;
+	Gfx_Image separate_images[BENCHMARK_ATLAS_IMAGES];
+	Gfx_Image *atlased_images[BENCHMARK_ATLAS_IMAGES];
+} Benchmark_Atlas_Data;
+
+void benchmark_batch_build_separate_images(u64 op_count, void *data) {
+	Benchmark_Atlas_Data *d = (Benchmark_Atlas_Data*)data;
+	gfx_batch_build(&d->batch, d->separate, op_count, 0, false, 1280, 720);
+	benchmark_sink += d->batch.draw_call_count;
+}
+void benchmark_batch_build_atlased_images(u64 op_count, void *data) {
+	Benchmark_Atlas_Data *d = (Benchmark_Atlas_Data*)data;
+	gfx_batch_build(&d->batch, d->atlased, op_count, 0, false, 1280, 720);
+	benchmark_sink += d->batch.draw_call_count;
+}
+
+typedef struct Benchmark_Z_Sort_Data {
+	Gfx_Batch batch;
+	Draw_Quad *random;
+	Draw_Quad *layered;
+	Draw_Quad *in_order;
+} Benchmark_Z_Sort_Data;
+
+void benchmark_z_sort_random(u64 op_count, void *data) {
+	Benchmark_Z_Sort_Data *d = (Benchmark_Z_Sort_Data*)data;
+	benchmark_sink += gfx_batch_z_sort(&d->batch, d->random, op_count);
+}
+void benchmark_z_sort_layered(u64 op_count, void *data) {
+	Benchmark_Z_Sort_Data *d = (Benchmark_Z_Sort_Data*)data;
+	benchmark_sink += gfx_batch_z_sort(&d->batch, d->layered, op_count);
+}
+void benchmark_z_sort_in_order(u64 op_count, void *data) {
+	Benchmark_Z_Sort_Data *d = (Benchmark_Z_Sort_Data*)data;
+	benchmark_sink += gfx_batch_z_sort(&d->batch, d->in_order, op_count);
+}
+void benchmark_batch_build(u64 op_count, void *data) {
+	Benchmark_Batch_Data *d = (Benchmark_Batch_Data*)data;
+	gfx_batch_build(&d->batch, d->quads, op_count, 0, true, 1280, 720);
+	benchmark_sink += d->batch.instance_count + d->batch.draw_call_count;
+}
+
+#define BENCHMARK_TILE_FIELD_SIZE 256
+typedef struct Benchmark_Tile_Data {
+	Gfx_Batch batch;
+	Static_Batch tiles;
+	Gfx_Image image;
+} Benchmark_Tile_Data;
+
+void benchmark_draw_tile_field(Benchmark_Tile_Data *d) {
+	for (u64 y = 0; y < BENCHMARK_TILE_FIELD_SIZE; y++) {
+		for (u64 x = 0; x < BENCHMARK_TILE_FIELD_SIZE; x++) {
+			draw_image(&d->image, v2((f32)x*0.02f, (f32)y*0.02f), v2(0.02f, 0.02f), COLOR_WHITE);
+		}
+	}
+}
+// Camera in the middle of the field, about a quarter of it on screen
+void benchmark_tile_setup(u64 op_count, void *data) {
+	reset_draw_frame(&draw_frame);
+	draw_frame.view = m4_make_translation(v3(BENCHMARK_TILE_FIELD_SIZE*0.01f, BENCHMARK_TILE_FIELD_SIZE*0.01f, 0));
+}
+// One frame per run, drawing & batching what the renderer would upload
+void benchmark_tiles_immediate(u64 op_count, void *data) {
+	Benchmark_Tile_Data *d = (Benchmark_Tile_Data*)data;
+	benchmark_draw_tile_field(d);
+	gfx_batch_build(&d->batch, quad_buffer, draw_frame.num_quads, scissor_buffer, false, 1280, 720);
+	benchmark_sink += d->batch.instance_count;
+}
+void benchmark_tiles_retained(u64 op_count, void *data) {
+	Benchmark_Tile_Data *d = (Benchmark_Tile_Data*)data;
+	draw_static_batch(&d->tiles);
+	gfx_batch_build(&d->batch, quad_buffer, draw_frame.num_quads, scissor_buffer, false, 1280, 720);
+	benchmark_sink += d->batch.instance_count + draw_frame.static_batch_draw_count;
+}
+
+///
+// Text
+
+typedef struct Benchmark_Text_Data {
+	Gfx_Font *font;
+	string text;
+} Benchmark_Text_Data;
+
+bool benchmark_walk_glyphs_callback(Gfx_Glyph glyph, Gfx_Font_Atlas *atlas, float glyph_x, float glyph_y, void *ud) {
+	*(u64*)ud += 1;
+	return true;
+}
+void benchmark_walk_glyphs(u64 op_count, void *data) {
+	Benchmark_Text_Data *d = (Benchmark_Text_Data*)data;
+	u64 glyph_count = 0;
+	for (u64 i = 0; i < op_count; i++) {
+		walk_glyphs((Walk_Glyphs_Spec){d->font, d->text, 32, v2(1, 1), true, &glyph_count}, benchmark_walk_glyphs_callback);
+	}
+	benchmark_sink += glyph_count;
+}
+void benchmark_measure_text(u64 op_count, void *data) {
+	Benchmark_Text_Data *d = (Benchmark_Text_Data*)data;
+	f32 sum = 0;
+	for (u64 i = 0; i < op_count; i++) {
+		sum += measure_text(d->font, d->text, 32, v2(1, 1)).visual_size.x;
+	}
+	benchmark_sink += (u64)sum;
+}
+void benchmark_draw_text(u64 op_count, void *data) {
+	Benchmark_Text_Data *d = (Benchmark_Text_Data*)data;
+	for (u64 i = 0; i < op_count; i++) {
+		draw_text(d->font, d->text, 32, v2(-0.9f, (f32)(i%64)*0.02f-0.6f), v2(0.002f, 0.002f), COLOR_WHITE);
+	}
+	benchmark_sink += draw_frame.num_quads;
+}
+
+#endif // OOGABOOGA_HAS_GFX
+
+#ifndef OOGABOOGA_HEADLESS
+
+///
+// Audio
+
+#define BENCHMARK_AUDIO_FRAMES 4096
+typedef struct Benchmark_Audio_Data {
+	void *src;
+	void *dst;
+} Benchmark_Audio_Data;
+
+void benchmark_convert_frames(u64 op_count, void *data) {
+	Benchmark_Audio_Data *d = (Benchmark_Audio_Data*)data;
+	Audio_Format src_format = {AUDIO_BITS_16, 2, 44100};
+	Audio_Format dst_format = {AUDIO_BITS_32, 2, 48000};
+	benchmark_sink += convert_frames(d->dst, dst_format, d->src, src_format, op_count);
+}
+void benchmark_mix_frames(u64 op_count, void *data) {
+	Benchmark_Audio_Data *d = (Benchmark_Audio_Data*)data;
+	Audio_Format format = {AUDIO_BITS_32, 2, 48000};
+	mix_frames(d->dst, d->src, op_count, format);
+	benchmark_sink += *(u32*)d->dst;
+}
+
+#endif // NOT OOGABOOGA_HEADLESS
+
+///
+// Runner
+
+// For names that aren't literals, they are freed when the benchmarks are done
+string benchmark_name(string **names, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	string name = sprint_va_list(get_heap_allocator(), STR(fmt), args);
+	va_end(args);
+	growing_array_add((void**)names, &name);
+	return name;
+}
+
+void benchmark_report(Benchmark_Result **results, Benchmark_Result r) {
+	print("%s: min %.2f ns, median %.2f ns, stddev %.2f ns", r.name, r.min_ns, r.median_ns, r.stddev_ns);
+	if (r.bytes_per_op > 0) print(", %.1f bytes", r.bytes_per_op);
+	print("\n");
+	growing_array_add((void**)results, &r);
+}
+
+bool benchmarks_write_json(Benchmark_Result *results, string path) {
+	String_Builder json;
+	string_builder_init(&json, get_heap_allocator());
+
+	string_builder_print(&json, "{\"version\":%d,\"cycles_per_second\":%llu,\"runs\":%d,\"benchmarks\":[\n", BENCHMARK_JSON_VERSION, os.cycles_per_second, BENCHMARK_RUNS);
+	u64 count = growing_array_get_valid_count(results);
+	for (u64 i = 0; i < count; i++) {
+		Benchmark_Result r = results[i];
+		string_builder_print(&json, "{\"name\":\"%s\",\"ops\":%llu,\"min_ns\":%.3f,\"median_ns\":%.3f,\"mean_ns\":%.3f,\"stddev_ns\":%.3f,\"bytes_per_op\":%.3f}%cs\n",
+			r.name, r.ops_per_run, r.min_ns, r.median_ns, r.mean_ns, r.stddev_ns, r.bytes_per_op, i+1 < count ? "," : "");
+	}
+	string_builder_print(&json, "]}\n");
+
+	bool ok = os_write_entire_file(path, json.result);
+	dealloc(get_heap_allocator(), json.buffer);
+	return ok;
+}
+
+void oogabooga_run_benchmarks(string output_path) {
+	// Same data every time
+	u64 seed_before = seed_for_random;
+	seed_for_random = 69;
+
+	Benchmark_Result *results;
+	growing_array_init((void**)&results, sizeof(Benchmark_Result), get_heap_allocator());
+	string *names;
+	growing_array_init((void**)&names, sizeof(string), get_heap_allocator());
+
+	print("Running benchmarks...\n");
+
+	benchmark_report(&results, benchmark_run(STR("heap alloc+dealloc 64b"), 10000, 0, benchmark_heap_64, 0));
+	benchmark_report(&results, benchmark_run(STR("heap alloc+dealloc 4kb"), 10000, 0, benchmark_heap_4k, 0));
+	void **pointers = alloc(get_heap_allocator(), 1000*sizeof(void*));
+	benchmark_report(&results, benchmark_run(STR("heap alloc+dealloc mixed sizes"), 1000, 0, benchmark_heap_mixed, pointers));
+	dealloc(get_heap_allocator(), pointers);
+	benchmark_report(&results, benchmark_run(STR("talloc 64b"), 10000, benchmark_temp_reset, benchmark_talloc_64, 0));
+
+	{
+		u64 key_count = 10000;
+		Benchmark_Hash_Data d;
+		d.table = make_hash_table(u64, u64, get_heap_allocator());
+		d.keys = alloc(get_heap_allocator(), key_count*sizeof(u64));
+		for (u64 i = 0; i < key_count; i++) d.keys[i] = get_random() & ~1ull;
+		benchmark_report(&results, benchmark_run(STR("hash_table_set u64"), key_count, benchmark_hash_reset, benchmark_hash_set, &d));
+		benchmark_hash_fill(key_count, &d);
+		benchmark_report(&results, benchmark_run(STR("hash_table_find u64 hit"), key_count, 0, benchmark_hash_find_hit, &d));
+		benchmark_report(&results, benchmark_run(STR("hash_table_find u64 miss"), key_count, 0, benchmark_hash_find_miss, &d));
+		hash_table_destroy(&d.table);
+		dealloc(get_heap_allocator(), d.keys);
+	}
+
+	{
+		Benchmark_String_Data d;
+		String_Builder text;
+		string_builder_init(&text, get_heap_allocator());
+		for (u64 i = 0; i < 32; i++) string_builder_append(&text, STR("ooga booga unga bunga bonga "));
+		string_builder_append(&text, STR("needle"));
+		d.text = text.result;
+		d.needle = STR("needle");
+		d.a = STR("This is a string of 64 characters which we compare & concat!!!!");
+		d.b = string_copy(d.a, get_heap_allocator());
+		benchmark_report(&results, benchmark_run(STR("strings_match 64 chars"), 10000, 0, benchmark_strings_match, &d));
+		benchmark_report(&results, benchmark_run(STR("string_find_from_left 1kb"), 1000, 0, benchmark_string_find, &d));
+		benchmark_report(&results, benchmark_run(STR("string_concat 64+64 temp"), 10000, benchmark_temp_reset, benchmark_string_concat, &d));
+		benchmark_report(&results, benchmark_run(STR("string_replace_all 1kb temp"), 100, benchmark_temp_reset, benchmark_string_replace_all, &d));
+		dealloc_string(get_heap_allocator(), d.b);
+		dealloc(get_heap_allocator(), text.buffer);
+	}
+
+	benchmark_report(&results, benchmark_run(STR("tprint 3 args"), 10000, benchmark_temp_reset, benchmark_tprint, 0));
+	{
+		String_Builder sb;
+		string_builder_init_reserve(&sb, 1024*1024, get_heap_allocator());
+		benchmark_report(&results, benchmark_run(STR("string_builder_print 2 args"), 10000, 0, benchmark_string_builder_print, &sb));
+		dealloc(get_heap_allocator(), sb.buffer);
+	}
+
+	{
+		u64 item_count = 65536;
+		Benchmark_Sort_Data d;
+		d.items    = alloc(get_heap_allocator(), item_count*sizeof(Benchmark_Sort_Item));
+		d.help     = alloc(get_heap_allocator(), item_count*sizeof(Benchmark_Sort_Item));
+		d.unsorted = alloc(get_heap_allocator(), item_count*sizeof(Benchmark_Sort_Item));
+		for (u64 i = 0; i < item_count; i++) {
+			d.unsorted[i].key = get_random() & ((1ull << 21)-1);
+			d.unsorted[i].payload = i;
+		}
+		benchmark_report(&results, benchmark_run(STR("radix_sort 64k items 21 bits (per item)"), item_count, benchmark_sort_setup, benchmark_radix_sort, &d));
+		dealloc(get_heap_allocator(), d.items);
+		dealloc(get_heap_allocator(), d.help);
+		dealloc(get_heap_allocator(), d.unsorted);
+	}
+
+	{
+		Matrix4 *matrices = alloc(get_heap_allocator(), BENCHMARK_MATRIX_COUNT*sizeof(Matrix4));
+		for (u64 i = 0; i < BENCHMARK_MATRIX_COUNT; i++) {
+			Matrix4 m = m4_make_translation(v3(get_random_float32(), get_random_float32(), 0));
+			m = m4_rotate_z(m, get_random_float32()*6.28f);
+			matrices[i] = m4_scale(m, v3(1.0f+get_random_float32(), 1.0f+get_random_float32(), 1));
+		}
+		benchmark_report(&results, benchmark_run(STR("m4_mul"), 10000, 0, benchmark_m4_mul, matrices));
+		benchmark_report(&results, benchmark_run(STR("m4_inverse"), 10000, 0, benchmark_m4_inverse, matrices));
+		dealloc(get_heap_allocator(), matrices);
+	}
+
+	{
+		// Same fan-out workload on 1..N workers, the calling thread is worker 0
+		bool was_initted = job_system.initted;
+		if (was_initted) job_system_shutdown();
+		u64 max_workers = max(os.number_of_logical_processors, 1);
+		Benchmark_Job_Data d = {0};
+		for (u64 worker_count = 1; true; worker_count = min(worker_count*2, max_workers)) {
+			job_system_init(worker_count);
+			string name = benchmark_name(&names, "jobs fan-out 64x64 %llu workers (per job)", worker_count);
+			benchmark_report(&results, benchmark_run(name, 64*BENCHMARK_JOB_CHILD_COUNT, 0, benchmark_jobs_fan_out, &d));
+			job_system_shutdown();
+			if (worker_count == max_workers) break;
+		}
+		if (was_initted) job_system_init(0);
+	}
+
+	{
+		// Contended. Ticket locks degrade badly when the next in line isn't scheduled, so only
+		// up to the core count, and 100 threads for the rest.
+		struct { Benchmark_Lock_Kind kind; const char *name; bool oversubscribe; } locks[] = {
+			{BENCHMARK_LOCK_SPINLOCK,    "Spinlock",       true},
+			{BENCHMARK_LOCK_TICKET_LOCK, "Ticket_Lock",    false},
+			{BENCHMARK_LOCK_NAIVE,       "naive cas spin", false},
+			{BENCHMARK_LOCK_MUTEX,       "Mutex",          true},
+			{BENCHMARK_LOCK_OS_MUTEX,    "OS mutex",       true},
+		};
+		Benchmark_Lock_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Lock_Data));
+		memset(d, 0, sizeof(*d));
+		spinlock_init(&d->spinlock);
+		mutex_init(&d->mutex);
+		d->os_mutex = os_make_mutex();
+		u64 max_threads = min(max(os.number_of_logical_processors, 1), BENCHMARK_MAX_THREADS);
+		for (u64 thread_count = 1; true; thread_count = min(thread_count*2, max_threads)) {
+			for (u64 i = 0; i < sizeof(locks)/sizeof(locks[0]); i++) {
+				d->kind = locks[i].kind;
+				benchmark_threads_start(&d->threads, thread_count, benchmark_lock_thread, d);
+				string name = benchmark_name(&names, "%cs %llu threads (per lock)", locks[i].name, thread_count);
+				benchmark_report(&results, benchmark_run(name, thread_count*10000, benchmark_lock_setup, benchmark_lock_contended, d));
+				benchmark_threads_stop(&d->threads);
+			}
+			if (thread_count == max_threads) break;
+		}
+		for (u64 i = 0; i < sizeof(locks)/sizeof(locks[0]); i++) {
+			if (!locks[i].oversubscribe) continue;
+			d->kind = locks[i].kind;
+			benchmark_threads_start(&d->threads, 100, benchmark_lock_thread, d);
+			string name = benchmark_name(&names, "%cs 100 threads (per lock)", locks[i].name);
+			benchmark_report(&results, benchmark_run(name, 100*1000, benchmark_lock_setup, benchmark_lock_contended, d));
+			benchmark_threads_stop(&d->threads);
+		}
+		mutex_destroy(&d->mutex);
+		os_destroy_mutex(d->os_mutex);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		Benchmark_Semaphore_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Semaphore_Data));
+		memset(d, 0, sizeof(*d));
+		binary_semaphore_init(&d->ping, false);
+		binary_semaphore_init(&d->pong, false);
+		benchmark_threads_start(&d->threads, 1, benchmark_semaphore_ponger, d);
+		benchmark_report(&results, benchmark_run(STR("Binary_Semaphore ping pong (per round trip)"), 1000, 0, benchmark_semaphore_ping_pong, d));
+		benchmark_threads_stop(&d->threads);
+		binary_semaphore_destroy(&d->ping);
+		binary_semaphore_destroy(&d->pong);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		u64 item_count = 1024*256;
+		Benchmark_Queue_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Queue_Data));
+		memset(d, 0, sizeof(*d));
+		spsc_queue_init(&d->spsc, sizeof(u64), 1024, get_heap_allocator());
+		mpmc_queue_init(&d->mpmc, sizeof(u64), 1024, get_heap_allocator());
+		benchmark_threads_start(&d->threads, 1, benchmark_queue_spsc_producer, d);
+		d->batched = false;
+		benchmark_report(&results, benchmark_run(STR("Spsc_Queue (per item)"), item_count, 0, benchmark_queue_spsc, d));
+		d->batched = true;
+		benchmark_report(&results, benchmark_run(STR("Spsc_Queue batches of 64 (per item)"), item_count, 0, benchmark_queue_spsc, d));
+		benchmark_threads_stop(&d->threads);
+		// Producers & consumers both this many, so up to half the cores
+		u64 max_threads = min(max(os.number_of_logical_processors/2, 1), BENCHMARK_MAX_THREADS/2);
+		for (u64 thread_count = 1; true; thread_count = min(thread_count*2, max_threads)) {
+			d->producer_count = thread_count;
+			benchmark_threads_start(&d->threads, thread_count*2, benchmark_queue_mpmc_thread, d);
+			d->batched = false;
+			benchmark_report(&results, benchmark_run(benchmark_name(&names, "Mpmc_Queue %llu producers & consumers (per item)", thread_count), item_count, 0, benchmark_queue_mpmc, d));
+			d->batched = true;
+			benchmark_report(&results, benchmark_run(benchmark_name(&names, "Mpmc_Queue %llu producers & consumers batches of 64 (per item)", thread_count), item_count, 0, benchmark_queue_mpmc, d));
+			benchmark_threads_stop(&d->threads);
+			if (thread_count == max_threads) break;
+		}
+		spsc_queue_deinit(&d->spsc);
+		mpmc_queue_deinit(&d->mpmc);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		// On whatever job system the program has, started lazily if it isn't yet
+		Benchmark_Parallel_Data d;
+		d.entities         = alloc(get_heap_allocator(), BENCHMARK_ENTITY_COUNT*sizeof(Benchmark_Entity));
+		d.initial_entities = alloc(get_heap_allocator(), BENCHMARK_ENTITY_COUNT*sizeof(Benchmark_Entity));
+		for (u64 i = 0; i < BENCHMARK_ENTITY_COUNT; i++) {
+			Benchmark_Entity *en = &d.initial_entities[i];
+			en->pos = v2((f32)(i%100), (f32)(i/100));
+			en->velocity = v2(0, 0);
+			en->brain_iterations = (i % 64 == 0) ? 2000 : 10;
+			en->is_valid = (i % 3) != 0;
+		}
+		d.quads_in  = alloc(get_heap_allocator(), 4*BENCHMARK_QUAD_COUNT*sizeof(Vector2));
+		d.quads_out = alloc(get_heap_allocator(), 4*BENCHMARK_QUAD_COUNT*sizeof(Vector2));
+		d.xform = m4_mul(m4_make_scale(v3(2, 2, 1)), m4_make_translation(v3(10, 20, 0)));
+		for (u64 i = 0; i < 4*BENCHMARK_QUAD_COUNT; i++) {
+			d.quads_in[i] = v2((f32)(i%1000), (f32)(i/1000));
+		}
+		benchmark_report(&results, benchmark_run(STR("entity update serial (per entity)"), BENCHMARK_ENTITY_COUNT, benchmark_entities_setup, benchmark_entities_serial, &d));
+		Benchmark_Result r = benchmark_run(STR(""), BENCHMARK_ENTITY_COUNT, benchmark_entities_setup, benchmark_entities_parallel, &d);
+		r.name = benchmark_name(&names, "entity update parallel_for %llu workers (per entity)", job_system_get_worker_count());
+		benchmark_report(&results, r);
+		benchmark_report(&results, benchmark_run(STR("quad transform serial (per quad)"), BENCHMARK_QUAD_COUNT, 0, benchmark_quads_serial, &d));
+		r = benchmark_run(STR(""), BENCHMARK_QUAD_COUNT, 0, benchmark_quads_parallel, &d);
+		r.name = benchmark_name(&names, "quad transform parallel_for %llu workers (per quad)", job_system_get_worker_count());
+		benchmark_report(&results, r);
+		dealloc(get_heap_allocator(), d.entities);
+		dealloc(get_heap_allocator(), d.initial_entities);
+		dealloc(get_heap_allocator(), d.quads_in);
+		dealloc(get_heap_allocator(), d.quads_out);
+	}
+
+	{
+		// Don't leave our events in the programs trace
+		profiler_flush();
+		spinlock_acquire_or_wait(&_profiler_lock);
+		u64 output_count_before = _profile_output.count;
+		spinlock_release(&_profiler_lock);
+
+		u64 event_count = PROFILER_EVENTS_PER_THREAD/2;
+		benchmark_report(&results, benchmark_run(STR("profiler record scope"), event_count, benchmark_profiler_flush, benchmark_profiler_record, 0));
+		benchmark_report(&results, benchmark_run(STR("profiler flush (per event)"), event_count, benchmark_profiler_flush_setup, benchmark_profiler_flush, 0));
+
+		spinlock_acquire_or_wait(&_profiler_lock);
+		_profile_output.count = output_count_before;
+		spinlock_release(&_profiler_lock);
+
+		// Sizes are of the last run's trace
+		string trace;
+		Benchmark_Result r = benchmark_run(STR("profiler streaming (per event)"), event_count*4, 0, benchmark_profiler_stream, 0);
+		assert(os_read_entire_file(STR(BENCHMARK_TRACE_PATH), &trace, get_heap_allocator()), "Could not read benchmark trace");
+		r.bytes_per_op = (f64)trace.count/r.ops_per_run;
+		benchmark_report(&results, r);
+		dealloc(get_heap_allocator(), trace.data);
+
+		r = benchmark_run(STR("profiler_convert_trace_to_json (per event)"), event_count*4, 0, benchmark_profiler_convert, 0);
+		assert(os_read_entire_file(STR(BENCHMARK_TRACE_JSON_PATH), &trace, get_heap_allocator()), "Could not read benchmark json trace");
+		r.bytes_per_op = (f64)trace.count/r.ops_per_run;
+		benchmark_report(&results, r);
+		dealloc(get_heap_allocator(), trace.data);
+
+		os_file_delete(STR(BENCHMARK_TRACE_PATH));
+		os_file_delete(STR(BENCHMARK_TRACE_JSON_PATH));
+	}
+
+#if OOGABOOGA_HAS_GFX
+	{
+		// Images are never sampled when batching, fake handles are enough
+		Benchmark_Batch_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Batch_Data));
+		*d = (Benchmark_Batch_Data){0};
+		d->quads = alloc(get_heap_allocator(), BENCHMARK_BATCH_QUADS_LARGE*sizeof(Draw_Quad));
+		d->unsorted = alloc(get_heap_allocator(), BENCHMARK_BATCH_QUADS_LARGE*sizeof(Draw_Quad));
+		for (u64 i = 0; i < BENCHMARK_BATCH_IMAGES; i++) {
+			d->images[i].gfx_handle = (Gfx_Handle)(i+1);
+		}
+		for (u64 i = 0; i < BENCHMARK_BATCH_QUADS_LARGE; i++) {
+			Draw_Quad q = ZERO(Draw_Quad);
+			Vector2 p = v2(get_random_float32()*2-1, get_random_float32()*2-1);
+			q.bottom_left  = p;
+			q.top_left     = v2(p.x, p.y+0.01f);
+			q.top_right    = v2(p.x+0.01f, p.y+0.01f);
+			q.bottom_right = v2(p.x+0.01f, p.y);
+			q.color = COLOR_WHITE;
+			q.uv = v4(0, 0, 1, 1);
+			q.z = (s32)(get_random() % 64);
+			q.type = (i % 4 == 0) ? QUAD_TYPE_TEXT : QUAD_TYPE_REGULAR;
+			if (i % 2 == 0) q.image = &d->images[get_random() % BENCHMARK_BATCH_IMAGES];
+			d->unsorted[i] = q;
+		}
+		benchmark_report(&results, benchmark_run(STR("draw_image 16k quads (per quad)"), BENCHMARK_BATCH_QUADS, benchmark_draw_setup, benchmark_draw_image, d));
+		benchmark_report(&results, benchmark_run(STR("draw_image_xform 16k quads (per quad)"), BENCHMARK_BATCH_QUADS, benchmark_draw_setup, benchmark_draw_image_xform, d));
+		reset_draw_frame(&draw_frame);
+		benchmark_report(&results, benchmark_run(STR("gfx_batch_build 16k quads z sorted (per quad)"), BENCHMARK_BATCH_QUADS, benchmark_batch_setup, benchmark_batch_build, d));
+		benchmark_report(&results, benchmark_run(STR("gfx_batch_build 128k quads z sorted (per quad)"), BENCHMARK_BATCH_QUADS_LARGE, benchmark_batch_setup, benchmark_batch_build, d));
+		gfx_batch_destroy(&d->batch);
+		dealloc(get_heap_allocator(), d->quads);
+		dealloc(get_heap_allocator(), d->unsorted);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		// Sprites picked at random from 300 small images
+		Benchmark_Atlas_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Atlas_Data));
+		*d = ZERO(Benchmark_Atlas_Data);
+		d->separate = alloc(get_heap_allocator(), BENCHMARK_BATCH_QUADS*sizeof(Draw_Quad));
+		d->atlased  = alloc(get_heap_allocator(), BENCHMARK_BATCH_QUADS*sizeof(Draw_Quad));
+		for (u64 i = 0; i < BENCHMARK_ATLAS_IMAGES; i++) {
+			d->separate_images[i].gfx_handle = (Gfx_Handle)(i+1);
+			d->atlased_images[i] = make_image(32, 32, 4, 0, get_heap_allocator());
+		}
+		for (u64 i = 0; i < BENCHMARK_BATCH_QUADS; i++) {
+			u64 image = get_random() % BENCHMARK_ATLAS_IMAGES;
+			Draw_Quad q = ZERO(Draw_Quad);
+			q.top_left  = v2(0, 0.01f);
+			q.top_right = v2(0.01f, 0.01f);
+			q.bottom_right = v2(0.01f, 0);
+			q.color = COLOR_WHITE;
+			q.uv = v4(0, 0, 1, 1);
+			q.image = &d->separate_images[image];
+			d->separate[i] = q;
+			q.image = d->atlased_images[image];
+			d->atlased[i] = q;
+		}
+		benchmark_report(&results, benchmark_run(STR("gfx_batch_build 16k quads 300 separate images (per quad)"), BENCHMARK_BATCH_QUADS, 0, benchmark_batch_build_separate_images, d));
+		u64 separate_draw_calls = d->batch.draw_call_count;
+		benchmark_report(&results, benchmark_run(STR("gfx_batch_build 16k quads 300 atlased images (per quad)"), BENCHMARK_BATCH_QUADS, 0, benchmark_batch_build_atlased_images, d));
+		print("    draw calls: %llu with separate images, %llu atlased\n", separate_draw_calls, d->batch.draw_call_count);
+		gfx_batch_destroy(&d->batch);
+		for (u64 i = 0; i < BENCHMARK_ATLAS_IMAGES; i++) delete_image(d->atlased_images[i]);
+		dealloc(get_heap_allocator(), d->separate);
+		dealloc(get_heap_allocator(), d->atlased);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		u64 quad_count = 1000000;
+		Benchmark_Z_Sort_Data d = ZERO(Benchmark_Z_Sort_Data);
+		d.random   = alloc(get_heap_allocator(), quad_count*sizeof(Draw_Quad));
+		d.layered  = alloc(get_heap_allocator(), quad_count*sizeof(Draw_Quad));
+		d.in_order = alloc(get_heap_allocator(), quad_count*sizeof(Draw_Quad));
+		for (u64 i = 0; i < quad_count; i++) {
+			d.random[i].z   = (s32)get_random_int_in_range(-MAX_Z+1, MAX_Z);
+			d.layered[i].z  = (s32)get_random_int_in_range(0, 15);
+			d.in_order[i].z = (s32)(i/1000);
+		}
+		benchmark_report(&results, benchmark_run(STR("z sort 10k quads random z (per quad)"), 10000, 0, benchmark_z_sort_random, &d));
+		benchmark_report(&results, benchmark_run(STR("z sort 100k quads random z (per quad)"), 100000, 0, benchmark_z_sort_random, &d));
+		benchmark_report(&results, benchmark_run(STR("z sort 1M quads random z (per quad)"), quad_count, 0, benchmark_z_sort_random, &d));
+		benchmark_report(&results, benchmark_run(STR("z sort 1M quads 16 layers (per quad)"), quad_count, 0, benchmark_z_sort_layered, &d));
+		benchmark_report(&results, benchmark_run(STR("z sort 1M quads in order (per quad)"), quad_count, 0, benchmark_z_sort_in_order, &d));
+		gfx_batch_destroy(&d.batch);
+		dealloc(get_heap_allocator(), d.random);
+		dealloc(get_heap_allocator(), d.layered);
+		dealloc(get_heap_allocator(), d.in_order);
+	}
+
+	{
+		// Some of them off screen so culling has something to do
+		Benchmark_Sprite_Data d = ZERO(Benchmark_Sprite_Data);
+		d.image.gfx_handle = (Gfx_Handle)1;
+		u64 sprite_count = 100000;
+		d.sprites = alloc(get_heap_allocator(), sprite_count*sizeof(Draw_Sprite));
+		for (u64 i = 0; i < sprite_count; i++) {
+			d.sprites[i].position = v2(get_random_float32()*5-2.5f, get_random_float32()*3-1.5f);
+			d.sprites[i].size = v2(0.05f, 0.05f);
+			d.sprites[i].color = COLOR_WHITE;
+			d.sprites[i].image = &d.image;
+		}
+		benchmark_report(&results, benchmark_run(STR("draw_image 10k sprites (per sprite)"), 10000, benchmark_draw_setup, benchmark_draw_sprites_one_by_one, &d));
+		benchmark_report(&results, benchmark_run(STR("draw_sprites 10k sprites (per sprite)"), 10000, benchmark_draw_setup, benchmark_draw_sprites, &d));
+		benchmark_report(&results, benchmark_run(STR("draw_image 100k sprites (per sprite)"), sprite_count, benchmark_draw_setup, benchmark_draw_sprites_one_by_one, &d));
+		benchmark_report(&results, benchmark_run(STR("draw_sprites 100k sprites (per sprite)"), sprite_count, benchmark_draw_setup, benchmark_draw_sprites, &d));
+		reset_draw_frame(&draw_frame);
+		dealloc(get_heap_allocator(), d.sprites);
+	}
+
+	{
+		Benchmark_Tile_Data *d = alloc(get_heap_allocator(), sizeof(Benchmark_Tile_Data));
+		*d = ZERO(Benchmark_Tile_Data);
+		d->image.gfx_handle = (Gfx_Handle)1;
+		reset_draw_frame(&draw_frame);
+		static_batch_begin(&d->tiles);
+		benchmark_draw_tile_field(d);
+		static_batch_end(&d->tiles);
+		benchmark_report(&results, benchmark_run(STR("256x256 tiles immediate (per frame)"), 1, benchmark_tile_setup, benchmark_tiles_immediate, d));
+		u64 immediate_upload = d->batch.instance_count*sizeof(Gfx_Quad_Instance);
+		benchmark_report(&results, benchmark_run(STR("256x256 tiles static batch (per frame)"), 1, benchmark_tile_setup, benchmark_tiles_retained, d));
+		print("    upload per frame: %llu KB immediate, 0 with the static batch (%llu KB once)\n", immediate_upload/1024, d->tiles.batch.instance_count*sizeof(Gfx_Quad_Instance)/1024);
+		reset_draw_frame(&draw_frame);
+		static_batch_destroy(&d->tiles);
+		gfx_batch_destroy(&d->batch);
+		dealloc(get_heap_allocator(), d);
+	}
+
+	{
+		Benchmark_Text_Data d;
+		d.font = load_font_from_disk(STR("C:/windows/fonts/arial.ttf"), get_heap_allocator());
+		d.text = STR("The quick brown fox jumps over the lazy dog, 0123456789 times!");
+		if (d.font) {
+			benchmark_report(&results, benchmark_run(STR("walk_glyphs 62 chars"), 1000, 0, benchmark_walk_glyphs, &d));
+			benchmark_report(&results, benchmark_run(STR("measure_text 62 chars"), 1000, 0, benchmark_measure_text, &d));
+			benchmark_report(&results, benchmark_run(STR("draw_text 62 chars"), 256, benchmark_draw_setup, benchmark_draw_text, &d));
+			reset_draw_frame(&draw_frame);
+			destroy_font(d.font);
+		} else {
+			log_warning("Could not load arial.ttf, skipping text benchmarks");
+		}
+	}
+#endif
+
+#ifndef OOGABOOGA_HEADLESS
+	{
+		Benchmark_Audio_Data d;
+		u64 size = BENCHMARK_AUDIO_FRAMES*2*sizeof(f32)*2; // Room for resampling
+		d.src = alloc(get_heap_allocator(), size);
+		d.dst = alloc(get_heap_allocator(), size);
+		for (u64 i = 0; i < size/sizeof(s16); i++) ((s16*)d.src)[i] = (s16)(get_random() & 0x7fff);
+		benchmark_report(&results, benchmark_run(STR("convert_frames s16 44.1k -> f32 48k (per frame)"), BENCHMARK_AUDIO_FRAMES, 0, benchmark_convert_frames, &d));
+		for (u64 i = 0; i < size/sizeof(f32); i++) ((f32*)d.src)[i] = get_random_float32()*0.5f;
+		benchmark_report(&results, benchmark_run(STR("mix_frames f32 stereo (per frame)"), BENCHMARK_AUDIO_FRAMES, 0, benchmark_mix_frames, &d));
+		dealloc(get_heap_allocator(), d.src);
+		dealloc(get_heap_allocator(), d.dst);
+	}
+#endif
+
+	if (benchmarks_write_json(results, output_path)) {
+		print("Wrote benchmark results to %s\n", output_path);
+	} else {
+		log_error("Could not write benchmark results to '%s'", output_path);
+	}
+
+	growing_array_deinit((void**)&results);
+	for (u64 i = 0; i < growing_array_get_valid_count(names); i++) dealloc_string(get_heap_allocator(), names[i]);
+	growing_array_deinit((void**)&names);
+	seed_for_random = seed_before;
+}
@@ -1,5 +1,6 @@
 
 typedef struct Spinlock Spinlock;
+typedef struct Ticket_Lock Ticket_Lock;
 typedef struct Mutex Mutex;
 typedef struct Binary_Semaphore Binary_Semaphore;
 
@@ -9,13 +10,48 @@ inline bool compare_and_swap_16(uint16_t *a, uint16_t b, uint16_t old);
 inline bool compare_and_swap_32(uint32_t *a, uint32_t b, uint32_t old);
 inline bool compare_and_swap_64(uint64_t *a, uint64_t b, uint64_t old);
 inline bool compare_and_swap_bool(bool *a, bool b, bool old);
+inline bool compare_and_swap_pointer(void *volatile *a, void *b, void *old);
+
+///
+// Atomics (implemented per compiler in cpu.c)
+// All read-modify-write operations are sequentially consistent (they're all locked
+// instructions on x86 anyway) and return the value from before the operation.
+// Loads & stores take a Memory_Order so you only pay for the ordering you need:
+//
+//	atomic_store_32(&data_ready, 1, MEMORY_ORDER_RELEASE); // Everything written before is visible ...
+//	if (atomic_load_32(&data_ready, MEMORY_ORDER_ACQUIRE)) // ... to whoever sees data_ready == 1
+//
+// Same procedures exist for 8, 16, 32 & 64 bits:
+inline u32  atomic_load_32     (volatile u32 *a, Memory_Order order);
+inline void atomic_store_32    (volatile u32 *a, u32 v, Memory_Order order);
+inline u32  atomic_exchange_32 (volatile u32 *a, u32 v);
+inline u32  atomic_fetch_add_32(volatile u32 *a, u32 v);
+inline u32  atomic_fetch_sub_32(volatile u32 *a, u32 v);
+inline u32  atomic_fetch_and_32(volatile u32 *a, u32 v);
+inline u32  atomic_fetch_or_32 (volatile u32 *a, u32 v);
+inline u32  atomic_fetch_xor_32(volatile u32 *a, u32 v);
+
+inline void* atomic_load_pointer    (void *volatile *a, Memory_Order order);
+inline void  atomic_store_pointer   (void *volatile *a, void *v, Memory_Order order);
+inline void* atomic_exchange_pointer(void *volatile *a, void *v);
+
+// Use in spin loops
+inline void cpu_pause();
+
+#define CACHE_LINE_SIZE 64
 
 ///
 // Spinlock "primitive"
 // Like a mutex but it eats up the entire core while waiting.
 // Beneficial if contention is low or sync speed is important
+// Padded to a cache line so whatever is next to it doesn't get invalidated every time the
+// lock is touched. For a global you also want to alignat(CACHE_LINE_SIZE) it.
+// Waiters back off exponentially (in pause instructions) so they don't all jump on the
+// lock at the same time when it's released.
+#define SPINLOCK_MAX_BACKOFF 1024
 typedef struct Spinlock {
 	bool locked;
+	u8 _padding[CACHE_LINE_SIZE-sizeof(bool)];
 } Spinlock;
 
 void ogb_instance
@@ -31,20 +67,46 @@ spinlock_acquire_or_wait_timeout(Spinlock* l, f64 timeout_seconds);
 void ogb_instance
 spinlock_release(Spinlock* l);
 
+///
+// Ticket lock
+// Fair spinlock: threads get the lock in the order they started waiting, so no thread can
+// get starved by others grabbing it over and over (which a regular spinlock allows).
+// Slightly slower than Spinlock when uncontended.
+// Zero initialized is a valid unlocked Ticket_Lock.
+#define TICKET_LOCK_YIELD_AFTER_PAUSES 4096
+typedef struct Ticket_Lock {
+	volatile u32 next_ticket;
+	volatile u32 now_serving;
+	u8 _padding[CACHE_LINE_SIZE-sizeof(u32)*2];
+} Ticket_Lock;
+
+void ogb_instance
+ticket_lock_init(Ticket_Lock *l);
+
+void ogb_instance
+ticket_lock_acquire_or_wait(Ticket_Lock *l);
+
+void ogb_instance
+ticket_lock_release(Ticket_Lock *l);
+
 
 ///
-// High-level mutex primitive (short spinlock then OS mutex lock)
-// Just spins for a few (configurable) microseconds with a spinlock,
-// and if acquiring fails it falls back to a OS mutex.
-#define MUTEX_DEFAULT_SPIN_TIME_MICROSECONDS 100
+// High-level mutex primitive (single word, futex style)
+// Spins for a little while in case the owner is about to release, and if that fails the
+// thread sleeps in the OS until the owner wakes it up in mutex_release.
+// How long it spins adapts to how long it usually had to spin before getting the lock.
+// A zero initialized Mutex is a valid unlocked mutex.
+#define MUTEX_MAX_SPIN_COUNT 1000
 typedef struct Mutex {
-	Spinlock spinlock;
-	f64 spin_time_microseconds;
-	Mutex_Handle os_handle;
-	volatile bool spinlock_acquired;
+	volatile u32 state; // MUTEX_STATE_*
+	volatile u32 spin_count;
 	volatile u64 acquiring_thread;
 } Mutex;
 
+#define MUTEX_STATE_UNLOCKED  0
+#define MUTEX_STATE_LOCKED    1
+#define MUTEX_STATE_CONTENDED 2 // Locked and there might be threads sleeping on it
+
 void ogb_instance
 mutex_init(Mutex *m);
 
@@ -54,15 +116,53 @@ mutex_destroy(Mutex *m);
 void ogb_instance
 mutex_acquire_or_wait(Mutex *m);
 
+// Returns false if the mutex is already acquired
+bool ogb_instance
+mutex_try_acquire(Mutex *m);
+
 void ogb_instance
 mutex_release(Mutex *m);
 
 
+///
+// Condition variable
+// Always used together with a Mutex which protects whatever condition you are waiting for:
+//
+//	mutex_acquire_or_wait(&m);
+//	while (!thing_is_ready) condition_variable_wait(&cv, &m);
+//	mutex_release(&m);
+//
+typedef struct Condition_Variable {
+	volatile u32 sequence;
+} Condition_Variable;
+
+void ogb_instance
+condition_variable_init(Condition_Variable *cv);
+
+// m must be acquired. It is released while sleeping and acquired again before this returns.
+// Might return without a signal, so always check your condition again.
+void ogb_instance
+condition_variable_wait(Condition_Variable *cv, Mutex *m);
+
+// Returns false if timeout was reached
+bool ogb_instance
+condition_variable_wait_timeout(Condition_Variable *cv, Mutex *m, f64 timeout_seconds);
+
+// Wakes one waiting thread
+void ogb_instance
+condition_variable_signal(Condition_Variable *cv);
+
+// Wakes all waiting threads
+void ogb_instance
+condition_variable_broadcast(Condition_Variable *cv);
+
+
 ///
 // Binary semaphore
+// Waiters sleep until signaled. One signal lets one waiter through.
 typedef struct Binary_Semaphore {
-    bool signaled;
-    Mutex mutex;
+    volatile u32 signaled;
+    volatile u32 waiter_count;
 } Binary_Semaphore;
 
 void ogb_instance
@@ -84,115 +184,186 @@ void spinlock_init(Spinlock *l) {
 	memset(l, 0, sizeof(*l));
 }
 void spinlock_acquire_or_wait(Spinlock* l) {
+	u32 backoff = 1;
 	while (true) {
-        bool expected = false;
-        MEMORY_BARRIER;
-        if (compare_and_swap_bool(&l->locked, true, expected)) {
-        	MEMORY_BARRIER;
+        // Test before test-and-set, a failing locked instruction still steals the cache
+        // line from the owner.
+        if (!atomic_load_8((volatile u8*)&l->locked, MEMORY_ORDER_RELAXED)
+         && compare_and_swap_bool(&l->locked, true, false)) {
             return;
         }
-        while (l->locked) {
-            // spinny boi
-            MEMORY_BARRIER;
-        }
-        MEMORY_BARRIER;
+        // spinny boi
+        for (u32 i = 0; i < backoff; i++) cpu_pause();
+        backoff = min(backoff*2, SPINLOCK_MAX_BACKOFF);
     }
 }
 // Returns true on aquired, false if timeout seconds reached
 bool spinlock_acquire_or_wait_timeout(Spinlock* l, f64 timeout_seconds) {
     f64 start = os_get_current_time_in_seconds();
+	u32 backoff = 1;
 	while (true) {
-        bool expected = false;
-        MEMORY_BARRIER;
-        if (compare_and_swap_bool(&l->locked, true, expected)) {
-        	MEMORY_BARRIER;
+        if (!atomic_load_8((volatile u8*)&l->locked, MEMORY_ORDER_RELAXED)
+         && compare_and_swap_bool(&l->locked, true, false)) {
             return true;
         }
-        while (l->locked) {
-            // spinny boi
-            if ((os_get_current_time_in_seconds()-start) >= timeout_seconds) return false;
-            MEMORY_BARRIER;
-        }
+        // spinny boi
+        if ((os_get_current_time_in_seconds()-start) >= timeout_seconds) return false;
+        for (u32 i = 0; i < backoff; i++) cpu_pause();
+        backoff = min(backoff*2, SPINLOCK_MAX_BACKOFF);
     }
     return true;
 }
 void spinlock_release(Spinlock* l) {
-	bool expected = true;
-    MEMORY_BARRIER;
-    bool success = compare_and_swap_bool(&l->locked, false, expected);
-    MEMORY_BARRIER;
-    assert(success, "This thread should have acquired the spinlock but compare_and_swap failed");
+    assert(l->locked, "Tried to release a spinlock which is not acquired");
+    // A release store is enough, no need for a locked instruction
+    atomic_store_8((volatile u8*)&l->locked, false, MEMORY_ORDER_RELEASE);
+}
+
+///
+// Ticket lock
+
+void ticket_lock_init(Ticket_Lock *l) {
+	memset(l, 0, sizeof(*l));
+}
+void ticket_lock_acquire_or_wait(Ticket_Lock *l) {
+	u32 ticket = atomic_fetch_add_32(&l->next_ticket, 1);
+	u64 pause_count = 0;
+	while (true) {
+		u32 serving = atomic_load_32(&l->now_serving, MEMORY_ORDER_ACQUIRE);
+		if (serving == ticket) return;
+		
+		// We know how many are ahead of us, so back off proportionally to that
+		u32 ahead = ticket-serving;
+		for (u32 i = 0; i < ahead*32; i++) cpu_pause();
+		pause_count += ahead*32;
+		
+		// Only the thread with the next ticket can make progress, if that thread isn't
+		// running (more threads than cores) we need to give it the core.
+		if (pause_count > TICKET_LOCK_YIELD_AFTER_PAUSES) os_yield_thread();
+	}
+}
+void ticket_lock_release(Ticket_Lock *l) {
+	u32 serving = atomic_load_32(&l->now_serving, MEMORY_ORDER_RELAXED);
+	assert(serving != atomic_load_32(&l->next_ticket, MEMORY_ORDER_RELAXED), "Tried to release a ticket lock which is not acquired");
+	atomic_store_32(&l->now_serving, serving+1, MEMORY_ORDER_RELEASE);
 }
 
 
 ///
-// High-level mutex primitive (short spinlock then OS mutex lock)
+// High-level mutex primitive (single word, futex style)
 
 void mutex_init(Mutex *m) {
-	spinlock_init(&m->spinlock);
-	m->spin_time_microseconds = MUTEX_DEFAULT_SPIN_TIME_MICROSECONDS;
-	m->os_handle = os_make_mutex();
-	m->spinlock_acquired = false;
-	m->acquiring_thread = 0;
+	memset(m, 0, sizeof(*m));
 }
 void mutex_destroy(Mutex *m) {
-	os_destroy_mutex(m->os_handle);
+	assert(m->state == MUTEX_STATE_UNLOCKED, "Destroying a mutex which is still acquired");
+}
+bool mutex_try_acquire(Mutex *m) {
+	if (!compare_and_swap_32((u32*)&m->state, MUTEX_STATE_LOCKED, MUTEX_STATE_UNLOCKED)) return false;
+	
+	assert(!m->acquiring_thread, "Internal sync error in Mutex: Multiple threads acquired");
+	m->acquiring_thread = context.thread_id;
+	MEMORY_BARRIER;
+	return true;
 }
 void mutex_acquire_or_wait(Mutex *m) {
-	if (spinlock_acquire_or_wait_timeout(&m->spinlock, m->spin_time_microseconds / 1000000.0)) {
-        assert(!m->spinlock_acquired, "Internal sync error in Mutex");
-    	m->spinlock_acquired = true;
-    	MEMORY_BARRIER;
-    }
-    os_lock_mutex(m->os_handle);
-    
-    assert(!m->acquiring_thread, "Internal sync error in Mutex: Multiple threads acquired");
-    m->acquiring_thread = context.thread_id;
-    MEMORY_BARRIER;
+	if (mutex_try_acquire(m)) return;
+	
+	// Spin for a bit in case the owner is just about done.
+	// We spin up to twice as long as it usually took, so it adapts to how the mutex is used.
+	u32 spin_count = m->spin_count;
+	u32 max_spins = min(MUTEX_MAX_SPIN_COUNT, spin_count*2+10);
+	for (u32 i = 0; i < max_spins; i++) {
+		cpu_pause();
+		if (atomic_load_32(&m->state, MEMORY_ORDER_RELAXED) == MUTEX_STATE_UNLOCKED && mutex_try_acquire(m)) {
+			m->spin_count = spin_count + ((s32)i-(s32)spin_count)/8;
+			return;
+		}
+	}
+	m->spin_count = spin_count + ((s32)max_spins-(s32)spin_count)/8;
+	
+	// Mark it as contended so the owner knows to wake us, then sleep until it's unlocked.
+	// We can't know if we were the only sleeper, so we take it as contended too.
+	while (atomic_exchange_32(&m->state, MUTEX_STATE_CONTENDED) != MUTEX_STATE_UNLOCKED) {
+		os_wait_on_address(&m->state, MUTEX_STATE_CONTENDED, OS_WAIT_INFINITE);
+	}
+	
+	assert(!m->acquiring_thread, "Internal sync error in Mutex: Multiple threads acquired");
+	m->acquiring_thread = context.thread_id;
+	MEMORY_BARRIER;
 }
 void mutex_release(Mutex *m) {
 	assert(m->acquiring_thread != 0, "Tried to release a mutex which is not acquired");
 	assert(m->acquiring_thread == context.thread_id, "Non-owning thread tried to release mutex");
 	m->acquiring_thread = 0;
 	MEMORY_BARRIER;
-	bool was_spinlock_acquired = m->spinlock_acquired;
-	m->spinlock_acquired = false;
-	MEMORY_BARRIER;
-	os_unlock_mutex(m->os_handle);
-	MEMORY_BARRIER;
-	if (was_spinlock_acquired) {
-		spinlock_release(&m->spinlock);
-		MEMORY_BARRIER;
-	}
-	MEMORY_BARRIER;
+	
+	u32 old = atomic_exchange_32(&m->state, MUTEX_STATE_UNLOCKED);
+	assert(old != MUTEX_STATE_UNLOCKED, "Internal sync error in Mutex: released while unlocked");
+	
+	// Only pay for the wake if someone might be sleeping
+	if (old == MUTEX_STATE_CONTENDED) os_wake_one_on_address(&m->state);
+}
+
+
+///
+// Condition variable
+
+void condition_variable_init(Condition_Variable *cv) {
+	cv->sequence = 0;
+}
+bool condition_variable_wait_timeout(Condition_Variable *cv, Mutex *m, f64 timeout_seconds) {
+	// If someone signals between us releasing the mutex and going to sleep, the sequence
+	// has changed and the wait returns immediately, so the signal can't get lost.
+	u32 sequence = atomic_load_32(&cv->sequence, MEMORY_ORDER_ACQUIRE);
+	
+	mutex_release(m);
+	
+	u32 timeout_ms = OS_WAIT_INFINITE;
+	if (timeout_seconds >= 0) timeout_ms = (u32)min(timeout_seconds*1000.0, (f64)(OS_WAIT_INFINITE-1));
+	bool woken = os_wait_on_address(&cv->sequence, sequence, timeout_ms);
+	
+	mutex_acquire_or_wait(m);
+	
+	return woken;
+}
+void condition_variable_wait(Condition_Variable *cv, Mutex *m) {
+	condition_variable_wait_timeout(cv, m, -1);
+}
+void condition_variable_signal(Condition_Variable *cv) {
+	atomic_fetch_add_32(&cv->sequence, 1);
+	os_wake_one_on_address(&cv->sequence);
+}
+void condition_variable_broadcast(Condition_Variable *cv) {
+	atomic_fetch_add_32(&cv->sequence, 1);
+	os_wake_all_on_address(&cv->sequence);
 }
 
 
+///
+// Binary semaphore
 
 void binary_semaphore_init(Binary_Semaphore *sem, bool initial_state) {
-    sem->signaled = initial_state;
-    mutex_init(&sem->mutex);
+    sem->signaled = initial_state ? 1 : 0;
+    sem->waiter_count = 0;
 }
 
 void binary_semaphore_destroy(Binary_Semaphore *sem) {
-    mutex_destroy(&sem->mutex);
+    assert(sem->waiter_count == 0, "Destroying a semaphore which has waiting threads");
 }
 
 void binary_semaphore_wait(Binary_Semaphore *sem) {
-    mutex_acquire_or_wait(&sem->mutex);
-    while (!sem->signaled) {
-        mutex_release(&sem->mutex);
-        os_yield_thread();
-        mutex_acquire_or_wait(&sem->mutex);
+    while (!compare_and_swap_32((u32*)&sem->signaled, 0, 1)) {
+        atomic_fetch_add_32(&sem->waiter_count, 1);
+        os_wait_on_address(&sem->signaled, 0, OS_WAIT_INFINITE);
+        atomic_fetch_sub_32(&sem->waiter_count, 1);
     }
-    sem->signaled = false;
-    mutex_release(&sem->mutex);
 }
 
 void binary_semaphore_signal(Binary_Semaphore *sem) {
-    mutex_acquire_or_wait(&sem->mutex);
-    sem->signaled = true;
-    mutex_release(&sem->mutex);
+    atomic_exchange_32(&sem->signaled, 1);
+    // The exchange is a full barrier so we can't miss a waiter that saw signaled == 0
+    if (atomic_load_32(&sem->waiter_count, MEMORY_ORDER_RELAXED) > 0) os_wake_one_on_address(&sem->signaled);
 }
 
 #endif
\ No newline at end of file
@@ -18,11 +18,24 @@ typedef struct Cpu_Capabilities {
 	bool avx2;
 	bool avx512;
 	
+	bool invariant_tsc; // rdtsc ticks at a constant rate regardless of power states
+	
 } Cpu_Capabilities;
 
 // I think this is the standard? (sse1)
 #define COMPILER_CAN_DO_SSE 1
 
+// Ordering for atomic loads & stores (see concurrency.c).
+// Values match the gcc/clang __ATOMIC_* constants so they can be passed straight through.
+// Loads can be RELAXED, ACQUIRE or SEQ_CST. Stores can be RELAXED, RELEASE or SEQ_CST.
+typedef enum Memory_Order {
+	MEMORY_ORDER_RELAXED = 0,
+	MEMORY_ORDER_ACQUIRE = 2,
+	MEMORY_ORDER_RELEASE = 3,
+	MEMORY_ORDER_ACQ_REL = 4,
+	MEMORY_ORDER_SEQ_CST = 5,
+} Memory_Order;
+
 ///
 // Compiler specific stuff
 #if COMPILER_MVSC
@@ -103,8 +116,78 @@ typedef struct Cpu_Capabilities {
 	compare_and_swap_bool(bool *a, bool b, bool old) {
 	    return compare_and_swap_8((uint8_t*)a, (uint8_t)b, (uint8_t)old);
 	}
+
+	#pragma intrinsic(_mm_pause)
+	// Tells the cpu we're in a spin loop (saves power, lets the other hyperthread run)
+	inline void 
+	cpu_pause() {
+		_mm_pause();
+	}
+	
+	// On x86 plain loads already have acquire and plain stores have release semantics,
+	// so we only need to stop the compiler. Seq cst stores need a locked instruction.
+	inline u8 atomic_load_8(volatile u8 *a, Memory_Order order) { u8 v = *a; _ReadWriteBarrier(); return v; }
+	inline void atomic_store_8(volatile u8 *a, u8 v, Memory_Order order) {
+		if (order == MEMORY_ORDER_SEQ_CST) _InterlockedExchange8((volatile char*)a, (char)v);
+		else { _ReadWriteBarrier(); *a = v; }
+	}
+	inline u8 atomic_exchange_8 (volatile u8 *a, u8 v) { return (u8)_InterlockedExchange8((volatile char*)a, (char)v); }
+	inline u8 atomic_fetch_add_8(volatile u8 *a, u8 v) { return (u8)_InterlockedExchangeAdd8((volatile char*)a, (char)v); }
+	inline u8 atomic_fetch_sub_8(volatile u8 *a, u8 v) { return (u8)_InterlockedExchangeAdd8((volatile char*)a, -(char)v); }
+	inline u8 atomic_fetch_and_8(volatile u8 *a, u8 v) { return (u8)_InterlockedAnd8((volatile char*)a, (char)v); }
+	inline u8 atomic_fetch_or_8 (volatile u8 *a, u8 v) { return (u8)_InterlockedOr8((volatile char*)a, (char)v); }
+	inline u8 atomic_fetch_xor_8(volatile u8 *a, u8 v) { return (u8)_InterlockedXor8((volatile char*)a, (char)v); }
+	
+	inline u16 atomic_load_16(volatile u16 *a, Memory_Order order) { u16 v = *a; _ReadWriteBarrier(); return v; }
+	inline void atomic_store_16(volatile u16 *a, u16 v, Memory_Order order) {
+		if (order == MEMORY_ORDER_SEQ_CST) _InterlockedExchange16((volatile short*)a, (short)v);
+		else { _ReadWriteBarrier(); *a = v; }
+	}
+	inline u16 atomic_exchange_16 (volatile u16 *a, u16 v) { return (u16)_InterlockedExchange16((volatile short*)a, (short)v); }
+	inline u16 atomic_fetch_add_16(volatile u16 *a, u16 v) { return (u16)_InterlockedExchangeAdd16((volatile short*)a, (short)v); }
+	inline u16 atomic_fetch_sub_16(volatile u16 *a, u16 v) { return (u16)_InterlockedExchangeAdd16((volatile short*)a, -(short)v); }
+	inline u16 atomic_fetch_and_16(volatile u16 *a, u16 v) { return (u16)_InterlockedAnd16((volatile short*)a, (short)v); }
+	inline u16 atomic_fetch_or_16 (volatile u16 *a, u16 v) { return (u16)_InterlockedOr16((volatile short*)a, (short)v); }
+	inline u16 atomic_fetch_xor_16(volatile u16 *a, u16 v) { return (u16)_InterlockedXor16((volatile short*)a, (short)v); }
+	
+	inline u32 atomic_load_32(volatile u32 *a, Memory_Order order) { u32 v = *a; _ReadWriteBarrier(); return v; }
+	inline void atomic_store_32(volatile u32 *a, u32 v, Memory_Order order) {
+		if (order == MEMORY_ORDER_SEQ_CST) _InterlockedExchange((volatile long*)a, (long)v);
+		else { _ReadWriteBarrier(); *a = v; }
+	}
+	inline u32 atomic_exchange_32 (volatile u32 *a, u32 v) { return (u32)_InterlockedExchange((volatile long*)a, (long)v); }
+	inline u32 atomic_fetch_add_32(volatile u32 *a, u32 v) { return (u32)_InterlockedExchangeAdd((volatile long*)a, (long)v); }
+	inline u32 atomic_fetch_sub_32(volatile u32 *a, u32 v) { return (u32)_InterlockedExchangeAdd((volatile long*)a, -(long)v); }
+	inline u32 atomic_fetch_and_32(volatile u32 *a, u32 v) { return (u32)_InterlockedAnd((volatile long*)a, (long)v); }
+	inline u32 atomic_fetch_or_32 (volatile u32 *a, u32 v) { return (u32)_InterlockedOr((volatile long*)a, (long)v); }
+	inline u32 atomic_fetch_xor_32(volatile u32 *a, u32 v) { return (u32)_InterlockedXor((volatile long*)a, (long)v); }
+	
+	inline u64 atomic_load_64(volatile u64 *a, Memory_Order order) { u64 v = *a; _ReadWriteBarrier(); return v; }
+	inline void atomic_store_64(volatile u64 *a, u64 v, Memory_Order order) {
+		if (order == MEMORY_ORDER_SEQ_CST) _InterlockedExchange64((volatile long long*)a, (long long)v);
+		else { _ReadWriteBarrier(); *a = v; }
+	}
+	inline u64 atomic_exchange_64 (volatile u64 *a, u64 v) { return (u64)_InterlockedExchange64((volatile long long*)a, (long long)v); }
+	inline u64 atomic_fetch_add_64(volatile u64 *a, u64 v) { return (u64)_InterlockedExchangeAdd64((volatile long long*)a, (long long)v); }
+	inline u64 atomic_fetch_sub_64(volatile u64 *a, u64 v) { return (u64)_InterlockedExchangeAdd64((volatile long long*)a, -(long long)v); }
+	inline u64 atomic_fetch_and_64(volatile u64 *a, u64 v) { return (u64)_InterlockedAnd64((volatile long long*)a, (long long)v); }
+	inline u64 atomic_fetch_or_64 (volatile u64 *a, u64 v) { return (u64)_InterlockedOr64((volatile long long*)a, (long long)v); }
+	inline u64 atomic_fetch_xor_64(volatile u64 *a, u64 v) { return (u64)_InterlockedXor64((volatile long long*)a, (long long)v); }
+	
+	inline void* atomic_load_pointer(void *volatile *a, Memory_Order order) { void *v = *a; _ReadWriteBarrier(); return v; }
+	inline void atomic_store_pointer(void *volatile *a, void *v, Memory_Order order) {
+		if (order == MEMORY_ORDER_SEQ_CST) _InterlockedExchangePointer(a, v);
+		else { _ReadWriteBarrier(); *a = v; }
+	}
+	inline void* atomic_exchange_pointer(void *volatile *a, void *v) { return _InterlockedExchangePointer(a, v); }
+	inline bool 
+	compare_and_swap_pointer(void *volatile *a, void *b, void *old) {
+	    return _InterlockedCompareExchangePointer(a, b, old) == old;
+	}
 	
 	#define MEMORY_BARRIER _ReadWriteBarrier()
+	// Also stops the cpu from reordering stores with later loads (store->load)
+	#define FULL_MEMORY_BARRIER _mm_mfence()
 	
 	#define thread_local __declspec(thread)
 	
@@ -222,8 +305,60 @@ typedef struct Cpu_Capabilities {
 	compare_and_swap_bool(bool *a, bool b, bool old) {
 	    return compare_and_swap_8((uint8_t*)a, (uint8_t)b, (uint8_t)old);
 	}
+
+	// Tells the cpu we're in a spin loop (saves power, lets the other hyperthread run)
+	inline void 
+	cpu_pause() {
+		__asm__ __volatile__("pause" ::: "memory");
+	}
+	
+	inline u8 atomic_load_8(volatile u8 *a, Memory_Order order) { return __atomic_load_n(a, order); }
+	inline void atomic_store_8(volatile u8 *a, u8 v, Memory_Order order) { __atomic_store_n(a, v, order); }
+	inline u8 atomic_exchange_8 (volatile u8 *a, u8 v) { return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST); }
+	inline u8 atomic_fetch_add_8(volatile u8 *a, u8 v) { return __atomic_fetch_add(a, v, __ATOMIC_SEQ_CST); }
+	inline u8 atomic_fetch_sub_8(volatile u8 *a, u8 v) { return __atomic_fetch_sub(a, v, __ATOMIC_SEQ_CST); }
+	inline u8 atomic_fetch_and_8(volatile u8 *a, u8 v) { return __atomic_fetch_and(a, v, __ATOMIC_SEQ_CST); }
+	inline u8 atomic_fetch_or_8 (volatile u8 *a, u8 v) { return __atomic_fetch_or(a, v, __ATOMIC_SEQ_CST); }
+	inline u8 atomic_fetch_xor_8(volatile u8 *a, u8 v) { return __atomic_fetch_xor(a, v, __ATOMIC_SEQ_CST); }
+	
+	inline u16 atomic_load_16(volatile u16 *a, Memory_Order order) { return __atomic_load_n(a, order); }
+	inline void atomic_store_16(volatile u16 *a, u16 v, Memory_Order order) { __atomic_store_n(a, v, order); }
+	inline u16 atomic_exchange_16 (volatile u16 *a, u16 v) { return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST); }
+	inline u16 atomic_fetch_add_16(volatile u16 *a, u16 v) { return __atomic_fetch_add(a, v, __ATOMIC_SEQ_CST); }
+	inline u16 atomic_fetch_sub_16(volatile u16 *a, u16 v) { return __atomic_fetch_sub(a, v, __ATOMIC_SEQ_CST); }
+	inline u16 atomic_fetch_and_16(volatile u16 *a, u16 v) { return __atomic_fetch_and(a, v, __ATOMIC_SEQ_CST); }
+	inline u16 atomic_fetch_or_16 (volatile u16 *a, u16 v) { return __atomic_fetch_or(a, v, __ATOMIC_SEQ_CST); }
+	inline u16 atomic_fetch_xor_16(volatile u16 *a, u16 v) { return __atomic_fetch_xor(a, v, __ATOMIC_SEQ_CST); }
+	
+	inline u32 atomic_load_32(volatile u32 *a, Memory_Order order) { return __atomic_load_n(a, order); }
+	inline void atomic_store_32(volatile u32 *a, u32 v, Memory_Order order) { __atomic_store_n(a, v, order); }
+	inline u32 atomic_exchange_32 (volatile u32 *a, u32 v) { return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST); }
+	inline u32 atomic_fetch_add_32(volatile u32 *a, u32 v) { return __atomic_fetch_add(a, v, __ATOMIC_SEQ_CST); }
+	inline u32 atomic_fetch_sub_32(volatile u32 *a, u32 v) { return __atomic_fetch_sub(a, v, __ATOMIC_SEQ_CST); }
+	inline u32 atomic_fetch_and_32(volatile u32 *a, u32 v) { return __atomic_fetch_and(a, v, __ATOMIC_SEQ_CST); }
+	inline u32 atomic_fetch_or_32 (volatile u32 *a, u32 v) { return __atomic_fetch_or(a, v, __ATOMIC_SEQ_CST); }
+	inline u32 atomic_fetch_xor_32(volatile u32 *a, u32 v) { return __atomic_fetch_xor(a, v, __ATOMIC_SEQ_CST); }
+	
+	inline u64 atomic_load_64(volatile u64 *a, Memory_Order order) { return __atomic_load_n(a, order); }
+	inline void atomic_store_64(volatile u64 *a, u64 v, Memory_Order order) { __atomic_store_n(a, v, order); }
+	inline u64 atomic_exchange_64 (volatile u64 *a, u64 v) { return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST); }
+	inline u64 atomic_fetch_add_64(volatile u64 *a, u64 v) { return __atomic_fetch_add(a, v, __ATOMIC_SEQ_CST); }
+	inline u64 atomic_fetch_sub_64(volatile u64 *a, u64 v) { return __atomic_fetch_sub(a, v, __ATOMIC_SEQ_CST); }
+	inline u64 atomic_fetch_and_64(volatile u64 *a, u64 v) { return __atomic_fetch_and(a, v, __ATOMIC_SEQ_CST); }
+	inline u64 atomic_fetch_or_64 (volatile u64 *a, u64 v) { return __atomic_fetch_or(a, v, __ATOMIC_SEQ_CST); }
+	inline u64 atomic_fetch_xor_64(volatile u64 *a, u64 v) { return __atomic_fetch_xor(a, v, __ATOMIC_SEQ_CST); }
+	
+	inline void* atomic_load_pointer(void *volatile *a, Memory_Order order) { return __atomic_load_n(a, order); }
+	inline void atomic_store_pointer(void *volatile *a, void *v, Memory_Order order) { __atomic_store_n(a, v, order); }
+	inline void* atomic_exchange_pointer(void *volatile *a, void *v) { return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST); }
+	inline bool 
+	compare_and_swap_pointer(void *volatile *a, void *b, void *old) {
+	    return __atomic_compare_exchange_n(a, &old, b, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	}
 	
 	#define MEMORY_BARRIER __asm__ __volatile__("" ::: "memory")
+	// Also stops the cpu from reordering stores with later loads (store->load)
+	#define FULL_MEMORY_BARRIER __asm__ __volatile__("mfence" ::: "memory")
 	
 	#define thread_local __thread
 	
@@ -250,6 +385,7 @@ typedef struct Cpu_Capabilities {
     #define deprecated(msg) 
     
     #define MEMORY_BARRIER
+    #define FULL_MEMORY_BARRIER
     
     #warning "Compiler is not explicitly supported, some things will probably not work as expected"
 #endif
@@ -276,6 +412,12 @@ query_cpu_capabilities() {
     result.avx2 = (ext_info.ebx & (1 << 5)) != 0;
     
     result.avx512 = (ext_info.ebx & (1 << 16)) != 0;
+    
+    Cpu_Info_X86 max_ext_info = cpuid(0x80000000);
+    if (max_ext_info.eax >= 0x80000007) {
+    	Cpu_Info_X86 power_info = cpuid(0x80000007);
+    	result.invariant_tsc = (power_info.edx & (1 << 8)) != 0;
+    }
 
     return result;
 }
@@ -11,36 +11,44 @@
 	Draw_Quad *draw_circle_xform(Matrix4 xform, Vector2 size, Vector4 color);
 	Draw_Quad *draw_image(Gfx_Image *image, Vector2 position, Vector2 size, Vector4 color);
 	Draw_Quad *draw_image_xform(Gfx_Image *image, Matrix4 xform, Vector2 size, Vector4 color);
+	Matrix4 get_world_to_clip();
 	Draw_Quad *draw_quad_projected(Draw_Quad quad, Matrix4 world_to_clip);
 	Draw_Quad *draw_quad(Draw_Quad quad);
 	Draw_Quad *draw_quad_xform(Draw_Quad quad, Matrix4 xform);
+	u64 draw_quads(Draw_Quad *quads, u64 count);
+	u64 draw_sprites(Draw_Sprite *sprites, u64 count);
 	bool draw_text_callback(Gfx_Glyph glyph, Gfx_Font_Atlas *atlas, float glyph_x, float glyph_y, void *ud);
 	void draw_text_xform(Gfx_Font *font, string text, u32 raster_height, Matrix4 xform, Vector2 scale, Vector4 color);
 	void draw_text(Gfx_Font *font, string text, u32 raster_height, Vector2 position, Vector2 scale, Vector4 color);
 	Gfx_Text_Metrics draw_text_and_measure(Gfx_Font *font, string text, u32 raster_height, Vector2 position, Vector2 scale, Vector4 color);
 	void draw_line(Vector2 p0, Vector2 p1, float line_width, Vector4 color);
+	
+	See static_batch.c for recording quads once and drawing them every frame with draw_static_batch().
 */
 
 // We use radix sort so the exact bit count is of importance
 #define MAX_Z_BITS 21
 #define MAX_Z ((1 << MAX_Z_BITS)/2)
 #define Z_STACK_MAX 4096
-#define SCISSOR_STACK_MAX 4096
+#define SCISSOR_STACK_MAX 4096 // How deep scissors can be pushed
+#define MAX_SCISSOR_RECTS 65535 // Pushed per frame, Draw_Quad.scissor is a u16 index+1
+#define MAX_STATIC_BATCH_DRAWS 256
 
+// Kept small since every quad is copied into the quad buffer and read again when batching.
+// 96 bytes with one userdata.
 typedef struct Draw_Quad {
 	// BEWARE !! These are in ndc
 	Vector2 bottom_left, top_left, top_right, bottom_right;
 	// r, g, b, a
 	Vector4 color;
+	// x1, y1, x2, y2
+	Vector4 uv;
 	Gfx_Image *image;
-	Gfx_Filter_Mode image_min_filter;
-	Gfx_Filter_Mode image_mag_filter;
 	s32 z;
+	u16 scissor; // Index+1 into scissor_buffer, 0 is no scissor
 	u8 type;
-	bool has_scissor;
-	// x1, y1, x2, y2
-	Vector4 uv;
-	Vector4 scissor;
+	u8 image_min_filter : 4; // Gfx_Filter_Mode
+	u8 image_mag_filter : 4; // Gfx_Filter_Mode
 	
 	Vector4 userdata[VERTEX_2D_USER_DATA_COUNT]; // #Volatile do NOT change this to a pointer
 	
@@ -48,6 +56,13 @@ typedef struct Draw_Quad {
 
 
 
+// See static_batch.c
+typedef struct Static_Batch Static_Batch;
+typedef struct Static_Batch_Draw {
+	Static_Batch *batch;
+	Matrix4 world_to_clip;
+} Static_Batch_Draw;
+
 typedef struct Draw_Frame {
 	u64 num_quads;
 	
@@ -58,17 +73,42 @@ typedef struct Draw_Frame {
 	s32 z_stack[Z_STACK_MAX];
 	u64 z_count;
 
-	Vector4 scissor_stack[SCISSOR_STACK_MAX];
-	u64 scissor_count;
+	// Every scissor pushed this frame is in scissor_buffer, quads refer to them by index
+	u64 scissor_rect_count;
+	u16 scissor_stack[SCISSOR_STACK_MAX]; // Indices into scissor_buffer
+	u64 scissor_stack_depth;
 	
 	void *cbuffer;
 	
+	// Drawn under the quads, in the order they were drawn
+	Static_Batch_Draw static_batch_draws[MAX_STATIC_BATCH_DRAWS];
+	u64 static_batch_draw_count;
+	
+	// readonly, see get_world_to_clip()
+	Matrix4 _world_to_clip;
+	Matrix4 _world_to_clip_projection;
+	Matrix4 _world_to_clip_view;
+	bool _world_to_clip_valid;
+	
+	// Set while recording a static batch, which is kept in world space and culled as a whole
+	bool _disable_culling;
+	
 } Draw_Frame;
 
+// For draw_sprites(), an axis aligned draw_image() (or draw_rect() if image is 0)
+typedef struct Draw_Sprite {
+	Vector2 position;
+	Vector2 size;
+	Vector4 color;
+	Gfx_Image *image;
+} Draw_Sprite;
+
 // #Cleanup this should be in Draw_Frame
 // #Global
 ogb_instance Draw_Quad *quad_buffer;
 ogb_instance u64 allocated_quads;
+ogb_instance Vector4 *scissor_buffer;
+ogb_instance u64 allocated_scissors;
 // This frame is passed to the platform layer and rendered in os_update.
 // Resets every frame.
 ogb_instance Draw_Frame draw_frame;
@@ -76,6 +116,8 @@ ogb_instance Draw_Frame draw_frame;
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 Draw_Quad *quad_buffer;
 u64 allocated_quads;
+Vector4 *scissor_buffer;
+u64 allocated_scissors;
 Draw_Frame draw_frame = ZERO(Draw_Frame);
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
 
@@ -100,52 +142,101 @@ void pop_z_layer() {
 }
 
 void push_window_scissor(Vector2 min, Vector2 max) {
-	assert(draw_frame.scissor_count < SCISSOR_STACK_MAX, "Too many scissors pushed. You can pop with pop_window_scissor() when you are done drawing to it.");
+	assert(draw_frame.scissor_stack_depth < SCISSOR_STACK_MAX, "Too many scissors pushed. You can pop with pop_window_scissor() when you are done drawing to it.");
+	
+	Vector4 rect = v4(min.x, min.y, max.x, max.y);
 	
-	draw_frame.scissor_stack[draw_frame.scissor_count] = v4(min.x, min.y, max.x, max.y);
-	draw_frame.scissor_count += 1;
+	// UI code tends to push the same rect over and over
+	u64 count = draw_frame.scissor_rect_count;
+	if (count > 0 && bytes_match(&scissor_buffer[count-1], &rect, sizeof(Vector4))) {
+		draw_frame.scissor_stack[draw_frame.scissor_stack_depth] = (u16)(count-1);
+		draw_frame.scissor_stack_depth += 1;
+		return;
+	}
+	
+	assert(count < MAX_SCISSOR_RECTS, "Too many different scissors pushed this frame, max is %d.", MAX_SCISSOR_RECTS);
+	if (count >= allocated_scissors) {
+		// #Memory
+		u64 new_count = min(max(allocated_scissors*2, 64), MAX_SCISSOR_RECTS);
+		Vector4 *new_buffer = alloc(get_heap_allocator(), new_count*sizeof(Vector4));
+		if (scissor_buffer) {
+			memcpy(new_buffer, scissor_buffer, count*sizeof(Vector4));
+			dealloc(get_heap_allocator(), scissor_buffer);
+		}
+		scissor_buffer = new_buffer;
+		allocated_scissors = new_count;
+	}
+	
+	scissor_buffer[count] = rect;
+	draw_frame.scissor_stack[draw_frame.scissor_stack_depth] = (u16)count;
+	draw_frame.scissor_rect_count += 1;
+	draw_frame.scissor_stack_depth += 1;
 }
 void pop_window_scissor() {
-	assert(draw_frame.scissor_count > 0, "No scissors to pop!");
-	draw_frame.scissor_count -= 1;
+	assert(draw_frame.scissor_stack_depth > 0, "No scissors to pop!");
+	draw_frame.scissor_stack_depth -= 1;
 }
 
-Draw_Quad _nil_quad = {0};
-Draw_Quad *draw_quad_projected(Draw_Quad quad, Matrix4 world_to_clip) {
-	quad.bottom_left  = m4_transform(world_to_clip, v4(v2_expand(quad.bottom_left), 0, 1)).xy;
-	quad.top_left     = m4_transform(world_to_clip, v4(v2_expand(quad.top_left), 0, 1)).xy;
-	quad.top_right    = m4_transform(world_to_clip, v4(v2_expand(quad.top_right), 0, 1)).xy;
-	quad.bottom_right = m4_transform(world_to_clip, v4(v2_expand(quad.bottom_right), 0, 1)).xy;
-	
-	bool should_cull = 
-	    (quad.bottom_left.x < -1 && quad.top_left.x < -1 && quad.top_right.x < -1 && quad.bottom_right.x < -1) ||
-	    (quad.bottom_left.x > 1 && quad.top_left.x > 1 && quad.top_right.x > 1 && quad.bottom_right.x > 1) ||
-	    (quad.bottom_left.y < -1 && quad.top_left.y < -1 && quad.top_right.y < -1 && quad.bottom_right.y < -1) ||
-	    (quad.bottom_left.y > 1 && quad.top_left.y > 1 && quad.top_right.y > 1 && quad.bottom_right.y > 1);
+// projection*inverse(view). Cached until draw_frame.projection or draw_frame.view changes, so
+// drawing doesn't invert the view for every quad.
+Matrix4 get_world_to_clip() {
+	if (!draw_frame._world_to_clip_valid
+	 || !bytes_match(&draw_frame.projection, &draw_frame._world_to_clip_projection, sizeof(Matrix4))
+	 || !bytes_match(&draw_frame.view, &draw_frame._world_to_clip_view, sizeof(Matrix4))) {
+		draw_frame._world_to_clip = m4_mul(draw_frame.projection, m4_inverse(draw_frame.view));
+		draw_frame._world_to_clip_projection = draw_frame.projection;
+		draw_frame._world_to_clip_view = draw_frame.view;
+		draw_frame._world_to_clip_valid = true;
+	}
+	return draw_frame._world_to_clip;
+}
 
-	if (should_cull) {
-		return &_nil_quad;
+// Projects the corners of the quad to clip space with the x & y rows of world_to_clip (z is 0).
+// Returns false if the quad ends up entirely outside of clip space.
+inline bool _project_quad_corners(Draw_Quad *q, Matrix4 world_to_clip) {
+#if ENABLE_SIMD
+	// All 4 corners at once, corners are laid out bl, tl, tr, br in the quad
+	__m128 a  = _mm_loadu_ps(&q->bottom_left.x); // blx bly tlx tly
+	__m128 b  = _mm_loadu_ps(&q->top_right.x);   // trx try brx bry
+	__m128 xs = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 ys = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+	
+	__m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(world_to_clip.m[0][0])), _mm_mul_ps(ys, _mm_set1_ps(world_to_clip.m[0][1]))), _mm_set1_ps(world_to_clip.m[0][3]));
+	__m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(world_to_clip.m[1][0])), _mm_mul_ps(ys, _mm_set1_ps(world_to_clip.m[1][1]))), _mm_set1_ps(world_to_clip.m[1][3]));
+	
+	__m128 low  = _mm_set1_ps(-1.0f);
+	__m128 high = _mm_set1_ps( 1.0f);
+	if ((_mm_movemask_ps(_mm_cmplt_ps(px, low))  == 0xF ||
+	     _mm_movemask_ps(_mm_cmpgt_ps(px, high)) == 0xF ||
+	     _mm_movemask_ps(_mm_cmplt_ps(py, low))  == 0xF ||
+	     _mm_movemask_ps(_mm_cmpgt_ps(py, high)) == 0xF) && !draw_frame._disable_culling) {
+		return false;
 	}
 	
-	quad.image_min_filter = GFX_FILTER_MODE_NEAREST;
-	quad.image_mag_filter = GFX_FILTER_MODE_NEAREST;
-	
-	
-	quad.z = 0;
-	if (draw_frame.z_count > 0)  quad.z = draw_frame.z_stack[draw_frame.z_count-1];
-	
-	quad.has_scissor = false;
-	if (draw_frame.scissor_count > 0) {
-		quad.scissor = draw_frame.scissor_stack[draw_frame.scissor_count-1];
-		quad.has_scissor = true;
-	}
+	_mm_storeu_ps(&q->bottom_left.x, _mm_unpacklo_ps(px, py));
+	_mm_storeu_ps(&q->top_right.x,   _mm_unpackhi_ps(px, py));
+	return true;
+#else
+	q->bottom_left  = m4_transform(world_to_clip, v4(v2_expand(q->bottom_left), 0, 1)).xy;
+	q->top_left     = m4_transform(world_to_clip, v4(v2_expand(q->top_left), 0, 1)).xy;
+	q->top_right    = m4_transform(world_to_clip, v4(v2_expand(q->top_right), 0, 1)).xy;
+	q->bottom_right = m4_transform(world_to_clip, v4(v2_expand(q->bottom_right), 0, 1)).xy;
 	
-	memset(quad.userdata, 0, sizeof(quad.userdata));
+	bool should_cull = 
+	    (q->bottom_left.x < -1 && q->top_left.x < -1 && q->top_right.x < -1 && q->bottom_right.x < -1) ||
+	    (q->bottom_left.x > 1 && q->top_left.x > 1 && q->top_right.x > 1 && q->bottom_right.x > 1) ||
+	    (q->bottom_left.y < -1 && q->top_left.y < -1 && q->top_right.y < -1 && q->bottom_right.y < -1) ||
+	    (q->bottom_left.y > 1 && q->top_left.y > 1 && q->top_right.y > 1 && q->bottom_right.y > 1);
 	
-	if (draw_frame.num_quads >= allocated_quads) {
+	return !should_cull || draw_frame._disable_culling;
+#endif
+}
+
+void _reserve_quads(u64 count) {
+	if (count > allocated_quads) {
 		// #Memory
 		
-		u64 new_count = max(get_next_power_of_two(draw_frame.num_quads+1), 128);
+		u64 new_count = max(get_next_power_of_two(count), 128);
 		
 		Draw_Quad *new_buffer = alloc(get_heap_allocator(), new_count*sizeof(Draw_Quad));
 		
@@ -157,22 +248,110 @@ Draw_Quad *draw_quad_projected(Draw_Quad quad, Matrix4 world_to_clip) {
 		quad_buffer = new_buffer;
 		allocated_quads = new_count;
 	}
+}
+
+inline s32 _current_z() {
+	return draw_frame.z_count > 0 ? draw_frame.z_stack[draw_frame.z_count-1] : 0;
+}
+inline u16 _current_scissor() {
+	return draw_frame.scissor_stack_depth > 0 ? draw_frame.scissor_stack[draw_frame.scissor_stack_depth-1]+1 : 0;
+}
+
+Draw_Quad _nil_quad = {0};
+Draw_Quad *draw_quad_projected(Draw_Quad quad, Matrix4 world_to_clip) {
+	
+	if (!_project_quad_corners(&quad, world_to_clip)) {
+		return &_nil_quad;
+	}
+	
+	quad.image_min_filter = GFX_FILTER_MODE_NEAREST;
+	quad.image_mag_filter = GFX_FILTER_MODE_NEAREST;
+	
+	quad.z = _current_z();
+	quad.scissor = _current_scissor();
+	
+	memset(quad.userdata, 0, sizeof(quad.userdata));
+	
+	_reserve_quads(draw_frame.num_quads+1);
 	
 	quad_buffer[draw_frame.num_quads] = quad;
 	draw_frame.num_quads += 1;
 	
 	return &quad_buffer[draw_frame.num_quads-1];
 }
+
+// Like draw_quad for every quad, but image, uv, type, filters & userdata are kept as given
+// since there's no pointer back to change them. Returns how many were not culled, those are
+// the last ones in quad_buffer.
+u64 draw_quads(Draw_Quad *quads, u64 count) {
+	Matrix4 world_to_clip = get_world_to_clip();
+	s32 z = _current_z();
+	u16 scissor = _current_scissor();
+	
+	_reserve_quads(draw_frame.num_quads+count);
+	
+	Draw_Quad *out = quad_buffer+draw_frame.num_quads;
+	u64 drawn = 0;
+	for (u64 i = 0; i < count; i++) {
+		out[drawn] = quads[i];
+		if (_project_quad_corners(&out[drawn], world_to_clip)) {
+			out[drawn].z = z;
+			out[drawn].scissor = scissor;
+			drawn += 1;
+		}
+	}
+	draw_frame.num_quads += drawn;
+	return drawn;
+}
+
+// Same as draw_image (or draw_rect when image is 0) for every sprite. Returns how many were not
+// culled, those are the last ones in quad_buffer.
+u64 draw_sprites(Draw_Sprite *sprites, u64 count) {
+	Matrix4 world_to_clip = get_world_to_clip();
+	s32 z = _current_z();
+	u16 scissor = _current_scissor();
+	
+	_reserve_quads(draw_frame.num_quads+count);
+	
+	Draw_Quad *out = quad_buffer+draw_frame.num_quads;
+	u64 drawn = 0;
+	for (u64 i = 0; i < count; i++) {
+		Draw_Sprite *s = &sprites[i];
+		Draw_Quad *q = &out[drawn];
+		
+		// #Copypaste #Volatile draw_rect
+		const float32 left   = s->position.x;
+		const float32 right  = s->position.x + s->size.x;
+		const float32 bottom = s->position.y;
+		const float32 top    = s->position.y + s->size.y;
+		q->bottom_left  = v2(left,  bottom);
+		q->top_left     = v2(left,  top);
+		q->top_right    = v2(right, top);
+		q->bottom_right = v2(right, bottom);
+		
+		if (!_project_quad_corners(q, world_to_clip)) continue;
+		
+		q->color = s->color;
+		q->uv = v4(0, 0, 1, 1);
+		q->image = s->image;
+		q->z = z;
+		q->scissor = scissor;
+		q->type = QUAD_TYPE_REGULAR;
+		q->image_min_filter = GFX_FILTER_MODE_NEAREST;
+		q->image_mag_filter = GFX_FILTER_MODE_NEAREST;
+		memset(q->userdata, 0, sizeof(q->userdata));
+		drawn += 1;
+	}
+	draw_frame.num_quads += drawn;
+	return drawn;
+}
+
 Draw_Quad *draw_quad(Draw_Quad quad) {
-	return draw_quad_projected(quad, m4_mul(draw_frame.projection, m4_inverse(draw_frame.view)));
+	return draw_quad_projected(quad, get_world_to_clip());
 }
 
 Draw_Quad *draw_quad_xform(Draw_Quad quad, Matrix4 xform) {
-	Matrix4 world_to_clip = m4_scalar(1.0);
-	world_to_clip         = m4_mul(world_to_clip, draw_frame.projection);
-	world_to_clip         = m4_mul(world_to_clip, m4_inverse(draw_frame.view));
-	world_to_clip         = m4_mul(world_to_clip, xform);
-	return draw_quad_projected(quad, world_to_clip);
+	return draw_quad_projected(quad, m4_mul_2d(get_world_to_clip(), xform));
 }
 
 Draw_Quad *draw_rect(Vector2 position, Vector2 size, Vector4 color) {
@@ -261,6 +440,7 @@ typedef struct {
 	Matrix4 xform;
 	Vector2 scale;
 	Vector4 color;
+	Matrix4 xform_to_clip; // Computed once per text instead of per glyph
 } Draw_Text_Callback_Params;
 bool draw_text_callback(Gfx_Glyph glyph, Gfx_Font_Atlas *atlas, float glyph_x, float glyph_y, void *ud) {
 
@@ -270,11 +450,20 @@ bool draw_text_callback(Gfx_Glyph glyph, Gfx_Font_Atlas *atlas, float glyph_x, f
 	
 	Vector2 size = v2(glyph.width*params->scale.x, glyph.height*params->scale.y);
 	
-	Matrix4 glyph_xform = m4_translate(params->xform, v3(glyph_x, glyph_y, 0));
+	Matrix4 glyph_to_clip = m4_translate_2d(params->xform_to_clip, v2(glyph_x, glyph_y));
+	
+	// #Copypaste #Volatile draw_image_xform
+	Draw_Quad quad = ZERO(Draw_Quad);
+	quad.bottom_left  = v2(0,  0);
+	quad.top_left     = v2(0,  size.y);
+	quad.top_right    = v2(size.x, size.y);
+	quad.bottom_right = v2(size.x, 0);
+	quad.color = params->color;
+	quad.image = atlas->image;
+	quad.uv = glyph.uv;
+	quad.type = QUAD_TYPE_TEXT;
 	
-	Draw_Quad *q = draw_image_xform(atlas->image, glyph_xform, size, params->color);
-	q->uv = glyph.uv;
-	q->type = QUAD_TYPE_TEXT;
+	Draw_Quad *q = draw_quad_projected(quad, glyph_to_clip);
 	q->image_min_filter = GFX_FILTER_MODE_LINEAR;
 	q->image_mag_filter = GFX_FILTER_MODE_LINEAR;
 	
@@ -290,6 +479,7 @@ void draw_text_xform(Gfx_Font *font, string text, u32 raster_height, Matrix4 xfo
 	p.xform = xform;
 	p.scale = scale;
 	p.color = color;
+	p.xform_to_clip = m4_mul_2d(get_world_to_clip(), xform);
 	
 	walk_glyphs((Walk_Glyphs_Spec){font, text, raster_height, scale, true, &p}, draw_text_callback);
 }
@@ -146,6 +146,10 @@ int entry(int argc, char **argv) {
 			pop_window_scissor();
 		}
 		
+		local_persist bool show_frame_stats = false;
+		if (is_key_just_pressed('F')) show_frame_stats = !show_frame_stats;
+		if (show_frame_stats) draw_frame_stats_overlay(font, 16);
+		
 		tm_scope("gfx_update") {
 			gfx_update();
 		}
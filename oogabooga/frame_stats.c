@@ -0,0 +1,234 @@
+
+/*
+	Frame timing statistics. Always recorded, it's a couple of rdtsc() per stat per frame so
+	it's fine in release builds.
+
+	The renderer records quad processing, gpu submit & present, and the whole frame is measured
+	from one gfx_update() to the next. Mark your own code to get update & draw times as well:
+
+		frame_stat_scope(FRAME_STAT_UPDATE) {
+			update_game(delta_t);
+		}
+		frame_stat_scope(FRAME_STAT_DRAW_BUILD) {
+			draw_game();
+		}
+
+	The last FRAME_STATS_HISTORY frames are kept:
+
+		Frame_Stat_Summary s = get_frame_stat_summary(FRAME_STAT_FRAME);
+		log("Frame time p99: %.2fms, max: %.2fms", s.p99, s.max);
+
+	Or shown on screen, call before gfx_update():
+
+		if (show_perf) draw_frame_stats_overlay(font, 16);
+
+	Headless programs call frame_stats_end_frame() themselves at the end of each frame.
+
+	#Sync Stats are meant to be recorded from the thread running the frame.
+*/
+
+#ifndef FRAME_STATS_HISTORY
+	#define FRAME_STATS_HISTORY 256
+#endif
+
+typedef enum Frame_Stat {
+	FRAME_STAT_UPDATE = 0, // Marked by game code
+	FRAME_STAT_DRAW_BUILD, // Marked by game code, filling the draw frame
+	FRAME_STAT_QUADS,      // Sorting quads & generating instances
+	FRAME_STAT_GPU_SUBMIT, // Uploading instances & draw calls
+	FRAME_STAT_PRESENT,
+	FRAME_STAT_FRAME,      // Whole frame
+
+	FRAME_STAT_COUNT
+} Frame_Stat;
+
+// In milliseconds, over the kept history
+typedef struct Frame_Stat_Summary {
+	f64 last;
+	f64 average;
+	f64 p50;
+	f64 p95;
+	f64 p99;
+	f64 max;
+	u64 sample_count;
+} Frame_Stat_Summary;
+
+typedef struct Frame_Stats {
+	u64 current_cycles[FRAME_STAT_COUNT]; // Accumulated for the frame in progress
+	f32 history_ms[FRAME_STAT_COUNT][FRAME_STATS_HISTORY];
+	u64 history_next;
+	u64 frame_count;
+	u64 last_frame_end_cycle;
+} Frame_Stats;
+
+// #Global
+ogb_instance Frame_Stats frame_stats;
+ogb_instance const char *frame_stat_names[FRAME_STAT_COUNT];
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Frame_Stats frame_stats = {0};
+const char *frame_stat_names[FRAME_STAT_COUNT] = {
+	"Update",
+	"Draw build",
+	"Quads",
+	"GPU submit",
+	"Present",
+	"Frame",
+};
+#endif
+
+ogb_instance void
+frame_stat_add(Frame_Stat stat, u64 cycles);
+
+// Pushes the accumulated times to the history. gfx_update() calls this.
+ogb_instance void
+frame_stats_end_frame();
+
+ogb_instance Frame_Stat_Summary
+get_frame_stat_summary(Frame_Stat stat);
+
+#define frame_stat_scope(stat) \
+    for (u64 _frame_stat_start = rdtsc(), _frame_stat_done = 0; \
+         _frame_stat_done == 0; \
+         _frame_stat_done = 1, frame_stat_add(stat, rdtsc()-_frame_stat_start))
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+// Where this thread's stats go when it isn't the thread running the frame, see gfx_render_thread.c
+thread_local u64 *_frame_stat_cycles = 0;
+
+void frame_stat_add(Frame_Stat stat, u64 cycles) {
+	if (_frame_stat_cycles) _frame_stat_cycles[stat] += cycles;
+	else                    frame_stats.current_cycles[stat] += cycles;
+}
+
+void frame_stats_end_frame() {
+	u64 now = rdtsc();
+	if (frame_stats.last_frame_end_cycle != 0) {
+		frame_stats.current_cycles[FRAME_STAT_FRAME] = now-frame_stats.last_frame_end_cycle;
+	}
+	frame_stats.last_frame_end_cycle = now;
+
+	for (u64 i = 0; i < FRAME_STAT_COUNT; i++) {
+		frame_stats.history_ms[i][frame_stats.history_next] = (f32)(cycles_to_seconds(frame_stats.current_cycles[i])*1000.0);
+		frame_stats.current_cycles[i] = 0;
+	}
+	frame_stats.history_next = (frame_stats.history_next+1) % FRAME_STATS_HISTORY;
+	frame_stats.frame_count += 1;
+}
+
+int _frame_stat_compare(const void *a, const void *b) {
+	f32 x = *(const f32*)a;
+	f32 y = *(const f32*)b;
+	return (x > y) - (x < y);
+}
+
+Frame_Stat_Summary get_frame_stat_summary(Frame_Stat stat) {
+	Frame_Stat_Summary s = {0};
+
+	u64 n = min(frame_stats.frame_count, FRAME_STATS_HISTORY);
+	if (n == 0) return s;
+
+	// Only sorted when asked for, recording stays cheap
+	f32 sorted[FRAME_STATS_HISTORY];
+	f32 help[FRAME_STATS_HISTORY];
+	f64 sum = 0;
+	for (u64 i = 0; i < n; i++) {
+		sorted[i] = frame_stats.history_ms[stat][i];
+		sum += sorted[i];
+	}
+	merge_sort(sorted, help, n, sizeof(f32), _frame_stat_compare);
+
+	u64 last_index = (frame_stats.history_next+FRAME_STATS_HISTORY-1) % FRAME_STATS_HISTORY;
+
+	s.sample_count = n;
+	s.last    = frame_stats.history_ms[stat][last_index];
+	s.average = sum/(f64)n;
+	s.p50     = sorted[(u64)(0.50*(f64)(n-1)+0.5)];
+	s.p95     = sorted[(u64)(0.95*(f64)(n-1)+0.5)];
+	s.p99     = sorted[(u64)(0.99*(f64)(n-1)+0.5)];
+	s.max     = sorted[n-1];
+	return s;
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+#if OOGABOOGA_HAS_GFX
+
+// Draws a table of the frame stats and a graph of recent frame times in the top left corner.
+ogb_instance void
+draw_frame_stats_overlay(Gfx_Font *font, u32 font_height);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+void draw_frame_stats_overlay(Gfx_Font *font, u32 font_height) {
+
+	// Draw in window pixels on top of everything, then put back whatever the game had
+	Matrix4 projection = draw_frame.projection;
+	Matrix4 view = draw_frame.view;
+	draw_frame.projection = m4_make_orthographic_projection(0, window.pixel_width, 0, window.pixel_height, -1, 10);
+	draw_frame.view = m4_scalar(1.0);
+	push_z_layer(MAX_Z-1);
+
+	const f32 padding = 8;
+	const f32 line_height = (f32)font_height*1.2f;
+	const f32 name_width = (f32)font_height*7;
+	const f32 column_width = (f32)font_height*4;
+	const f32 graph_height = (f32)font_height*4;
+	const u64 column_count = 6;
+
+	u64 row_count = 0;
+	Frame_Stat_Summary summaries[FRAME_STAT_COUNT];
+	for (u64 i = 0; i < FRAME_STAT_COUNT; i++) {
+		summaries[i] = get_frame_stat_summary((Frame_Stat)i);
+		// Skip what nobody measured, like update if the game doesn't mark it
+		if (summaries[i].max > 0) row_count += 1;
+	}
+
+	f32 width  = padding*2 + name_width + column_width*column_count;
+	f32 height = padding*3 + line_height*(row_count+1) + graph_height;
+	f32 top    = (f32)window.pixel_height;
+
+	draw_rect(v2(0, top-height), v2(width, height), v4(0, 0, 0, 0.7));
+
+	f32 y = top-padding-line_height;
+	const char *headers[] = {"ms", "last", "avg", "p50", "p95", "p99", "max"};
+	draw_text(font, STR(headers[0]), font_height, v2(padding, y), v2(1, 1), COLOR_WHITE);
+	for (u64 c = 0; c < column_count; c++) {
+		draw_text(font, STR(headers[c+1]), font_height, v2(padding+name_width+column_width*c, y), v2(1, 1), COLOR_WHITE);
+	}
+
+	for (u64 i = 0; i < FRAME_STAT_COUNT; i++) {
+		Frame_Stat_Summary s = summaries[i];
+		if (s.max <= 0) continue;
+		y -= line_height;
+
+		f64 values[] = {s.last, s.average, s.p50, s.p95, s.p99, s.max};
+		draw_text(font, STR(frame_stat_names[i]), font_height, v2(padding, y), v2(1, 1), COLOR_WHITE);
+		for (u64 c = 0; c < column_count; c++) {
+			draw_text(font, tprint("%.2f", values[c]), font_height, v2(padding+name_width+column_width*c, y), v2(1, 1), COLOR_WHITE);
+		}
+	}
+
+	// Frame times, oldest to newest, scaled so 33.3ms fills the graph. Line at 16.6ms.
+	u64 n = min(frame_stats.frame_count, FRAME_STATS_HISTORY);
+	f32 graph_width = width-padding*2;
+	f32 bar_width = graph_width/(f32)FRAME_STATS_HISTORY;
+	f32 graph_bottom = top-height+padding;
+	for (u64 i = 0; i < n; i++) {
+		u64 index = (frame_stats.history_next+FRAME_STATS_HISTORY-n+i) % FRAME_STATS_HISTORY;
+		f32 ms = frame_stats.history_ms[FRAME_STAT_FRAME][index];
+		f32 bar_height = min(ms/33.3f, 1.0f)*graph_height;
+		Vector4 color = ms > 16.7f ? v4(1, 0.3, 0.3, 1) : v4(0.3, 1, 0.3, 1);
+		draw_rect(v2(padding+bar_width*(FRAME_STATS_HISTORY-n+i), graph_bottom), v2(bar_width, bar_height), color);
+	}
+	draw_rect(v2(padding, graph_bottom+graph_height*0.5f), v2(graph_width, 1), v4(1, 1, 1, 0.5));
+
+	pop_z_layer();
+	draw_frame.projection = projection;
+	draw_frame.view = view;
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+#endif // OOGABOOGA_HAS_GFX
@@ -0,0 +1,257 @@
+
+/*
+	Runtime sprite atlas.
+
+	A draw call can bind GFX_BATCH_MAX_TEXTURES different images, so a scene with lots of small
+	images is split into many draw calls. To avoid that, make_image() and load_image_from_disk()
+	put 4 channel images of up to GFX_ATLAS_MAX_IMAGE_SIZE pixels into shared atlas pages.
+
+	The image gets the page's gfx_handle, and when batching, the quad uv (0..1 over the image) is
+	mapped into the image's rect in the page. gfx_set_image_data and delete_image work like for
+	any other image. Pass GFX_IMAGE_NO_ATLAS to make_image_ex() or load_image_from_disk_ex() to
+	give an image its own texture, or define GFX_ATLAS_MAX_IMAGE_SIZE 0 to turn this off.
+
+	Things to know:
+		- Atlased images share one gfx_handle, so image->gfx_handle doesn't identify the image.
+		- Shaders get uv in page space, so a pixel_shader_extension that does math on uv (0..1
+		  over the quad) sees the rect in the page instead.
+		- Sampling is CLAMP over the whole page, so uv outside of 0..1 (repeating a texture)
+		  samples the neighbouring images instead of wrapping.
+		- Edge pixels are repeated into a 1 pixel border so linear filtering doesn't bleed, but
+		  there are no mips.
+		- The first atlased image allocates a whole page, GFX_ATLAS_PAGE_SIZE squared at 4 bytes
+		  per pixel (16mb by default).
+		- Space in a page is only given back when every image in it has been deleted.
+		- If all GFX_ATLAS_MAX_PAGES pages are full, images get their own texture as usual.
+		- Like the rest of image creation, this is not thread safe.
+*/
+
+#ifndef GFX_ATLAS_MAX_IMAGE_SIZE
+	#define GFX_ATLAS_MAX_IMAGE_SIZE 256
+#endif
+#ifndef GFX_ATLAS_PAGE_SIZE
+	#define GFX_ATLAS_PAGE_SIZE 2048
+#endif
+#ifndef GFX_ATLAS_MAX_PAGES
+	#define GFX_ATLAS_MAX_PAGES 16
+#endif
+// #Volatile _gfx_atlas_write assumes 1
+#define GFX_ATLAS_PADDING 1
+
+#if GFX_ATLAS_MAX_IMAGE_SIZE+GFX_ATLAS_PADDING*2 >= GFX_ATLAS_PAGE_SIZE
+	#error "GFX_ATLAS_PAGE_SIZE must be bigger than GFX_ATLAS_MAX_IMAGE_SIZE plus padding"
+#endif
+
+// Top edge of the used space in a page, from left to right
+typedef struct Gfx_Atlas_Skyline_Node {
+	u32 x, y, width;
+} Gfx_Atlas_Skyline_Node;
+
+typedef struct Gfx_Atlas_Page {
+	Gfx_Image *image; // GFX_ATLAS_PAGE_SIZE squared, 4 channels
+	Gfx_Atlas_Skyline_Node *skyline;
+	u64 skyline_count;
+	u64 image_count; // Live images, the page is emptied when this goes to 0
+} Gfx_Atlas_Page;
+
+typedef struct Gfx_Atlas {
+	Gfx_Atlas_Page pages[GFX_ATLAS_MAX_PAGES];
+	u64 page_count;
+} Gfx_Atlas;
+
+// #Global
+ogb_instance Gfx_Atlas gfx_atlas;
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Gfx_Atlas gfx_atlas = {0};
+#endif
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+void _gfx_atlas_page_reset(Gfx_Atlas_Page *page) {
+	page->skyline[0].x = 0;
+	page->skyline[0].y = 0;
+	page->skyline[0].width = GFX_ATLAS_PAGE_SIZE;
+	page->skyline_count = 1;
+}
+
+// Bottom-left: lowest y, then the narrowest node so gaps get filled
+bool _gfx_atlas_page_find(Gfx_Atlas_Page *page, u32 w, u32 h, u32 *out_x, u32 *out_y, u64 *out_node) {
+	u32 best_y = GFX_ATLAS_PAGE_SIZE;
+	u32 best_width = GFX_ATLAS_PAGE_SIZE+1;
+	bool found = false;
+
+	for (u64 i = 0; i < page->skyline_count; i++) {
+		u32 x = page->skyline[i].x;
+		if (x+w > GFX_ATLAS_PAGE_SIZE) break;
+
+		// Resting on the highest node under the rect
+		u32 y = 0;
+		u32 width_left = w;
+		for (u64 j = i; width_left > 0; j++) {
+			y = max(y, page->skyline[j].y);
+			if (page->skyline[j].width >= width_left) break;
+			width_left -= page->skyline[j].width;
+		}
+		if (y+h > GFX_ATLAS_PAGE_SIZE) continue;
+
+		if (y < best_y || (y == best_y && page->skyline[i].width < best_width)) {
+			best_y = y;
+			best_width = page->skyline[i].width;
+			*out_x = x;
+			*out_y = y;
+			*out_node = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void _gfx_atlas_page_insert(Gfx_Atlas_Page *page, u64 node, u32 x, u32 y, u32 w, u32 h) {
+	Gfx_Atlas_Skyline_Node *nodes = page->skyline;
+
+	memmove(&nodes[node+1], &nodes[node], (page->skyline_count-node)*sizeof(Gfx_Atlas_Skyline_Node));
+	page->skyline_count += 1;
+	nodes[node].x = x;
+	nodes[node].y = y+h;
+	nodes[node].width = w;
+
+	// Cut away what the new node covers
+	u64 i = node+1;
+	while (i < page->skyline_count) {
+		u32 new_end = nodes[node].x+nodes[node].width;
+		if (nodes[i].x >= new_end) break;
+
+		u32 covered = new_end-nodes[i].x;
+		if (covered < nodes[i].width) {
+			nodes[i].x += covered;
+			nodes[i].width -= covered;
+			break;
+		}
+		memmove(&nodes[i], &nodes[i+1], (page->skyline_count-i-1)*sizeof(Gfx_Atlas_Skyline_Node));
+		page->skyline_count -= 1;
+	}
+
+	// Merge neighbours at the same height
+	i = 0;
+	while (i+1 < page->skyline_count) {
+		if (nodes[i].y == nodes[i+1].y) {
+			nodes[i].width += nodes[i+1].width;
+			memmove(&nodes[i+1], &nodes[i+2], (page->skyline_count-i-2)*sizeof(Gfx_Atlas_Skyline_Node));
+			page->skyline_count -= 1;
+		} else {
+			i += 1;
+		}
+	}
+}
+
+// Writes into the image's rect in its page and repeats the edges into the padding
+void _gfx_atlas_write(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data) {
+	Gfx_Image *page_image = image->atlas_page->image;
+	u32 px = image->atlas_x;
+	u32 py = image->atlas_y;
+	u32 right = px+image->width;
+	u32 top = py+image->height;
+	u8 *pixels = (u8*)data;
+	u64 stride = w*4;
+
+	gfx_set_image_data(page_image, px+x, py+y, w, h, data);
+
+	bool left_edge   = x == 0;
+	bool right_edge  = x+w == image->width;
+	bool bottom_edge = y == 0;
+	bool top_edge    = y+h == image->height;
+
+	if (left_edge || right_edge) {
+		// Baked sprites (sprite_atlas.c) can be bigger than GFX_ATLAS_MAX_IMAGE_SIZE
+		u32 *column = talloc(h*sizeof(u32));
+		if (left_edge) {
+			for (u32 r = 0; r < h; r++) memcpy(&column[r], pixels+r*stride, 4);
+			gfx_set_image_data(page_image, px-1, py+y, 1, h, column);
+		}
+		if (right_edge) {
+			for (u32 r = 0; r < h; r++) memcpy(&column[r], pixels+r*stride+(w-1)*4, 4);
+			gfx_set_image_data(page_image, right, py+y, 1, h, column);
+		}
+	}
+	if (bottom_edge) gfx_set_image_data(page_image, px+x, py-1, w, 1, pixels);
+	if (top_edge)    gfx_set_image_data(page_image, px+x, top,  w, 1, pixels+(h-1)*stride);
+
+	if (left_edge  && bottom_edge) gfx_set_image_data(page_image, px-1,  py-1, 1, 1, pixels);
+	if (right_edge && bottom_edge) gfx_set_image_data(page_image, right, py-1, 1, 1, pixels+(w-1)*4);
+	if (left_edge  && top_edge)    gfx_set_image_data(page_image, px-1,  top,  1, 1, pixels+(h-1)*stride);
+	if (right_edge && top_edge)    gfx_set_image_data(page_image, right, top,  1, 1, pixels+(h-1)*stride+(w-1)*4);
+}
+
+bool gfx_atlas_try_add_image(Gfx_Image *image, void *initial_data) {
+	if (GFX_ATLAS_MAX_IMAGE_SIZE == 0) return false;
+	if (image->flags & GFX_IMAGE_NO_ATLAS) return false;
+	if (image->channels != 4) return false;
+	if (image->width == 0 || image->height == 0) return false;
+	if (image->width > GFX_ATLAS_MAX_IMAGE_SIZE || image->height > GFX_ATLAS_MAX_IMAGE_SIZE) return false;
+
+	u32 w = image->width+GFX_ATLAS_PADDING*2;
+	u32 h = image->height+GFX_ATLAS_PADDING*2;
+
+	Gfx_Atlas_Page *page = 0;
+	u32 x = 0, y = 0;
+	u64 node = 0;
+	for (u64 i = 0; i < gfx_atlas.page_count; i++) {
+		if (_gfx_atlas_page_find(&gfx_atlas.pages[i], w, h, &x, &y, &node)) {
+			page = &gfx_atlas.pages[i];
+			break;
+		}
+	}
+
+	if (!page) {
+		if (gfx_atlas.page_count >= GFX_ATLAS_MAX_PAGES) return false;
+
+		page = &gfx_atlas.pages[gfx_atlas.page_count];
+		gfx_atlas.page_count += 1;
+		// #Memory #Heapalloc
+		page->image = make_image(GFX_ATLAS_PAGE_SIZE, GFX_ATLAS_PAGE_SIZE, 4, 0, get_heap_allocator());
+		page->skyline = alloc(get_heap_allocator(), (GFX_ATLAS_PAGE_SIZE+1)*sizeof(Gfx_Atlas_Skyline_Node));
+		page->image_count = 0;
+		_gfx_atlas_page_reset(page);
+		log_verbose("Made atlas page %llu for small images", gfx_atlas.page_count);
+
+		bool ok = _gfx_atlas_page_find(page, w, h, &x, &y, &node);
+		assert(ok, "Internal atlas error: image didn't fit in an empty page");
+	}
+
+	_gfx_atlas_page_insert(page, node, x, y, w, h);
+	page->image_count += 1;
+
+	image->atlas_page = page;
+	image->atlas_x = x+GFX_ATLAS_PADDING;
+	image->atlas_y = y+GFX_ATLAS_PADDING;
+	image->atlas_uv.x1 = (float)image->atlas_x/(float)GFX_ATLAS_PAGE_SIZE;
+	image->atlas_uv.y1 = (float)image->atlas_y/(float)GFX_ATLAS_PAGE_SIZE;
+	image->atlas_uv.x2 = (float)(image->atlas_x+image->width)/(float)GFX_ATLAS_PAGE_SIZE;
+	image->atlas_uv.y2 = (float)(image->atlas_y+image->height)/(float)GFX_ATLAS_PAGE_SIZE;
+	image->gfx_handle = page->image->gfx_handle;
+
+	if (initial_data) _gfx_atlas_write(image, 0, 0, image->width, image->height, initial_data);
+
+	return true;
+}
+
+void gfx_atlas_remove_image(Gfx_Image *image) {
+	Gfx_Atlas_Page *page = image->atlas_page;
+	assert(page && page->image_count > 0, "Image is not in an atlas page");
+
+	page->image_count -= 1;
+	if (page->image_count == 0) _gfx_atlas_page_reset(page);
+
+	image->atlas_page = 0;
+	image->gfx_handle = GFX_INVALID_HANDLE;
+}
+
+void gfx_atlas_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data) {
+	assert(image && data, "Bad parameters passed to gfx_set_image_data");
+	assert(x+w <= image->width && y+h <= image->height, "Specified subregion in image is out of bounds");
+	_gfx_atlas_write(image, x, y, w, h, data);
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
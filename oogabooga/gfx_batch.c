@@ -0,0 +1,318 @@
+
+/*
+	Turns the quads of a draw frame into instances & draw calls, without touching any graphics api.
+
+	This is the CPU side of rendering that every renderer shares: z sorting, assigning texture
+	slots, snapping text to pixels, flipping scissors to the renderer's y direction and picking
+	samplers.
+
+	Each quad becomes one Gfx_Quad_Instance. The renderer draws 6 vertices per instance and the
+	vertex shader picks the corner, uv & self uv from the vertex index:
+
+		vertex  0   1   2   3   4   5
+		corner  BL  TL  TR  BL  TR  BR
+
+	Texture slots & draw call boundaries are resolved in a cheap serial pass first. Frames with
+	at least GFX_BATCH_PARALLEL_MIN_QUADS quads then write their instances on the job system,
+	each worker filling its own range of 'instances', so the output is the same either way.
+
+	A renderer uploads 'instances' once and then issues 'draw_calls' in order, binding each
+	call's textures to slots 0..texture_count-1. A new draw call is only started when a frame
+	uses more than GFX_BATCH_MAX_TEXTURES different images.
+
+		gfx_batch_build(&batch, quad_buffer, draw_frame.num_quads, scissor_buffer, draw_frame.enable_z_sorting, window.pixel_width, window.pixel_height);
+		upload(batch.instances, batch.instance_count*sizeof(Gfx_Quad_Instance));
+		for (u64 i = 0; i < batch.draw_call_count; i++) draw_instanced(6, &batch.draw_calls[i]);
+
+	gfx_impl_null.c is the smallest renderer that does this.
+*/
+
+// #Volatile reflected in the 2D batch shader
+#define GFX_BATCH_MAX_TEXTURES 32
+
+// 0 to always write instances on the calling thread
+#ifndef GFX_BATCH_PARALLEL_MIN_QUADS
+	#define GFX_BATCH_PARALLEL_MIN_QUADS 32768
+#endif
+#define GFX_BATCH_PARALLEL_GRAIN 4096
+
+// #Volatile reflected in the renderers' instance layouts & the 2D batch shader
+typedef struct Gfx_Quad_Instance {
+
+	Vector2 corners[4]; // bottom_left, top_left, top_right, bottom_right in ndc
+	Vector4 uv;         // x1, y1, x2, y2
+	Vector4 color;
+	Vector4 scissor;    // In pixels, top-down
+
+	Vector4 userdata[VERTEX_2D_USER_DATA_COUNT];
+
+	s8 texture_index;
+	u8 type;
+	u8 sampler;
+	u8 has_scissor;
+
+} Gfx_Quad_Instance;
+
+// Quads are sorted through these instead of moving whole quads around
+typedef struct Gfx_Sort_Key {
+	s32 z;
+	u32 quad_index;
+} Gfx_Sort_Key;
+
+typedef struct Gfx_Draw_Call {
+	u64 first_instance;
+	u64 instance_count;
+	Gfx_Handle textures[GFX_BATCH_MAX_TEXTURES];
+	u64 texture_count;
+} Gfx_Draw_Call;
+
+// Buffers are kept between builds and only grow
+typedef struct Gfx_Batch {
+	Gfx_Quad_Instance *instances;
+	s8 *texture_indices; // One per instance, from the texture slot pass
+	u64 instance_count;
+	u64 instance_capacity;
+
+	Gfx_Draw_Call *draw_calls;
+	u64 draw_call_count;
+	u64 draw_call_capacity;
+
+	Gfx_Sort_Key *sort_keys;
+	Gfx_Sort_Key *sort_help;
+	u64 sort_capacity;
+} Gfx_Batch;
+
+// Quads are left untouched. Scissors are what Draw_Quad.scissor indexes, viewport size is in pixels.
+// A viewport size of 0 means the corners aren't in clip space yet: text isn't snapped to pixels
+// and quads can't have scissors.
+ogb_instance void
+gfx_batch_build(Gfx_Batch *batch, Draw_Quad *quads, u64 quad_count, Vector4 *scissors, bool z_sort, u32 viewport_width, u32 viewport_height);
+
+ogb_instance void
+gfx_batch_destroy(Gfx_Batch *batch);
+
+// Fills batch->sort_keys with the quads in z order. Returns false without sorting when the
+// quads were already in z order, which is common for layered 2D, and the keys are not needed.
+ogb_instance bool
+gfx_batch_z_sort(Gfx_Batch *batch, Draw_Quad *quads, u64 quad_count);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+Gfx_Draw_Call *_gfx_batch_push_draw_call(Gfx_Batch *batch) {
+	if (batch->draw_call_count >= batch->draw_call_capacity) {
+		u64 new_capacity = max(batch->draw_call_capacity*2, 4);
+		// #Memory #Heapalloc
+		Gfx_Draw_Call *new_calls = alloc(get_heap_allocator(), new_capacity*sizeof(Gfx_Draw_Call));
+		if (batch->draw_calls) {
+			memcpy(new_calls, batch->draw_calls, batch->draw_call_count*sizeof(Gfx_Draw_Call));
+			dealloc(get_heap_allocator(), batch->draw_calls);
+		}
+		batch->draw_calls = new_calls;
+		batch->draw_call_capacity = new_capacity;
+	}
+
+	Gfx_Draw_Call *call = &batch->draw_calls[batch->draw_call_count];
+	batch->draw_call_count += 1;
+	call->first_instance = batch->instance_count;
+	call->instance_count = 0;
+	call->texture_count = 0;
+	return call;
+}
+
+typedef struct Gfx_Batch_Write_Params {
+	Gfx_Batch *batch;
+	Draw_Quad *quads;
+	bool z_sort;
+	Vector4 *scissors;
+	bool snap_text;
+	float pixel_width;
+	float pixel_height;
+	u32 viewport_height;
+} Gfx_Batch_Write_Params;
+
+// Every instance only depends on its own quad, so ranges can be written on any thread
+void _gfx_batch_write_instances(u64 first, u64 end, void *userdata) {
+	Gfx_Batch_Write_Params *p = (Gfx_Batch_Write_Params*)userdata;
+	Gfx_Batch *batch = p->batch;
+
+	for (u64 i = first; i < end; i++) {
+
+		Draw_Quad *q = p->z_sort ? &p->quads[batch->sort_keys[i].quad_index] : &p->quads[i];
+		Gfx_Quad_Instance *instance = &batch->instances[i];
+
+		assert(q->z <= MAX_Z, "Z is too high. Z is %d, Max is %d.", q->z, MAX_Z);
+		assert(q->z >= (-MAX_Z+1), "Z is too low. Z is %d, Min is %d.", q->z, -MAX_Z+1);
+
+		memcpy(instance->corners, &q->bottom_left, sizeof(instance->corners));
+		if (q->type == QUAD_TYPE_TEXT && p->snap_text) {
+			for (u64 c = 0; c < 4; c++) {
+				instance->corners[c].x = round(instance->corners[c].x / p->pixel_width)  * p->pixel_width;
+				instance->corners[c].y = round(instance->corners[c].y / p->pixel_height) * p->pixel_height;
+			}
+		}
+
+		instance->uv = q->uv;
+		if (q->image && q->image->atlas_page) {
+			// Quad uv is over the image, map it to the image's rect in the atlas page
+			Vector4 a = q->image->atlas_uv;
+			instance->uv.x1 = a.x1 + q->uv.x1*(a.x2-a.x1);
+			instance->uv.y1 = a.y1 + q->uv.y1*(a.y2-a.y1);
+			instance->uv.x2 = a.x1 + q->uv.x2*(a.x2-a.x1);
+			instance->uv.y2 = a.y1 + q->uv.y2*(a.y2-a.y1);
+		}
+		instance->color = q->color;
+		memcpy(instance->userdata, q->userdata, sizeof(q->userdata));
+
+		instance->texture_index = batch->texture_indices[i];
+		instance->type = (u8)q->type;
+
+		// Scissors are given bottom-up, renderers want them top-down
+		instance->has_scissor = q->scissor != 0;
+		instance->scissor = v4(0, 0, 0, 0);
+		if (q->scissor) {
+			assert(p->viewport_height, "Quads with scissors need the viewport size");
+			Vector4 s = p->scissors[q->scissor-1];
+			instance->scissor = v4(s.x1, p->viewport_height - s.y2, s.x2, p->viewport_height - s.y1);
+		}
+
+		u8 sampler = -1;
+		if (q->image_min_filter == GFX_FILTER_MODE_NEAREST
+			 		&& q->image_mag_filter == GFX_FILTER_MODE_NEAREST)
+			 	sampler = 0;
+		if (q->image_min_filter == GFX_FILTER_MODE_LINEAR
+			 		&& q->image_mag_filter == GFX_FILTER_MODE_LINEAR)
+			 	sampler = 1;
+		if (q->image_min_filter == GFX_FILTER_MODE_LINEAR
+			 		&& q->image_mag_filter == GFX_FILTER_MODE_NEAREST)
+			 	sampler = 2;
+		if (q->image_min_filter == GFX_FILTER_MODE_NEAREST
+			 		&& q->image_mag_filter == GFX_FILTER_MODE_LINEAR)
+			 	sampler = 3;
+
+		instance->sampler = (u8)sampler;
+	}
+}
+
+bool gfx_batch_z_sort(Gfx_Batch *batch, Draw_Quad *quads, u64 quad_count) {
+	assert(quad_count <= 0xFFFFFFFF, "Too many quads to batch");
+
+	u64 first_out_of_order = 1;
+	while (first_out_of_order < quad_count && quads[first_out_of_order].z >= quads[first_out_of_order-1].z) {
+		first_out_of_order += 1;
+	}
+	if (first_out_of_order >= quad_count) return false;
+
+	if (batch->sort_capacity < quad_count) {
+		// #Memory #Heapalloc
+		if (batch->sort_keys) dealloc(get_heap_allocator(), batch->sort_keys);
+		if (batch->sort_help) dealloc(get_heap_allocator(), batch->sort_help);
+		batch->sort_keys = alloc(get_heap_allocator(), quad_count*sizeof(Gfx_Sort_Key));
+		batch->sort_help = alloc(get_heap_allocator(), quad_count*sizeof(Gfx_Sort_Key));
+		batch->sort_capacity = quad_count;
+	}
+
+	for (u64 i = 0; i < quad_count; i++) {
+		batch->sort_keys[i].z = quads[i].z;
+		batch->sort_keys[i].quad_index = (u32)i;
+	}
+
+	// Stable, so quads on the same layer keep the order they were drawn in
+	radix_sort(batch->sort_keys, batch->sort_help, quad_count, sizeof(Gfx_Sort_Key), offsetof(Gfx_Sort_Key, z), MAX_Z_BITS);
+	return true;
+}
+
+void gfx_batch_build(Gfx_Batch *batch, Draw_Quad *quads, u64 quad_count, Vector4 *scissors, bool z_sort, u32 viewport_width, u32 viewport_height) {
+
+	batch->instance_count = 0;
+	batch->draw_call_count = 0;
+
+	if (quad_count == 0) return;
+
+	if (batch->instance_capacity < quad_count) {
+		// #Memory #Heapalloc
+		if (batch->instances) dealloc(get_heap_allocator(), batch->instances);
+		if (batch->texture_indices) dealloc(get_heap_allocator(), batch->texture_indices);
+		batch->instances = alloc(get_heap_allocator(), quad_count*sizeof(Gfx_Quad_Instance));
+		batch->texture_indices = alloc(get_heap_allocator(), quad_count*sizeof(s8));
+		batch->instance_capacity = quad_count;
+	}
+
+	assert(quad_count <= 0xFFFFFFFF, "Too many quads to batch");
+	
+	if (z_sort) tm_scope("Z sorting") {
+		z_sort = gfx_batch_z_sort(batch, quads, quad_count);
+	}
+
+	Gfx_Draw_Call *call = _gfx_batch_push_draw_call(batch);
+	Gfx_Handle last_texture = 0;
+	s8 last_texture_index = 0;
+
+	// Texture slots & draw calls. Only looks at the images so it stays cheap next to writing instances.
+	for (u64 i = 0; i < quad_count; i++)  {
+
+		Draw_Quad *q = z_sort ? &quads[batch->sort_keys[i].quad_index] : &quads[i];
+
+		s8 texture_index = -1;
+
+		if (q->image) {
+
+			if (last_texture == q->image->gfx_handle) {
+				texture_index = last_texture_index;
+			} else {
+				// First look if texture is already bound
+				for (u64 j = 0; j < call->texture_count; j++) {
+					if (call->textures[j] == q->image->gfx_handle) {
+						texture_index = (s8)j;
+						break;
+					}
+				}
+				// Otherwise use a new slot
+				if (texture_index <= -1) {
+					if (call->texture_count >= GFX_BATCH_MAX_TEXTURES) {
+						// If max textures reached, start a new draw call with its own slots
+						batch->instance_count = i;
+						call->instance_count = batch->instance_count-call->first_instance;
+						call = _gfx_batch_push_draw_call(batch);
+					}
+					texture_index = (s8)call->texture_count;
+					call->texture_count += 1;
+				}
+			}
+			call->textures[texture_index] = q->image->gfx_handle;
+			last_texture = q->image->gfx_handle;
+			last_texture_index = texture_index;
+		}
+
+		batch->texture_indices[i] = texture_index;
+	}
+
+	batch->instance_count = quad_count;
+	call->instance_count = batch->instance_count-call->first_instance;
+
+	Gfx_Batch_Write_Params params;
+	params.batch = batch;
+	params.quads = quads;
+	params.z_sort = z_sort;
+	params.scissors = scissors;
+	params.snap_text = viewport_width && viewport_height;
+	params.pixel_width = params.snap_text ? 2.0/(float)viewport_width : 0;
+	params.pixel_height = params.snap_text ? 2.0/(float)viewport_height : 0;
+	params.viewport_height = viewport_height;
+
+	if (GFX_BATCH_PARALLEL_MIN_QUADS && quad_count >= GFX_BATCH_PARALLEL_MIN_QUADS) {
+		parallel_for(0, quad_count, GFX_BATCH_PARALLEL_GRAIN, _gfx_batch_write_instances, &params);
+	} else {
+		_gfx_batch_write_instances(0, quad_count, &params);
+	}
+}
+
+void gfx_batch_destroy(Gfx_Batch *batch) {
+	if (batch->instances)       dealloc(get_heap_allocator(), batch->instances);
+	if (batch->texture_indices) dealloc(get_heap_allocator(), batch->texture_indices);
+	if (batch->draw_calls)      dealloc(get_heap_allocator(), batch->draw_calls);
+	if (batch->sort_keys)       dealloc(get_heap_allocator(), batch->sort_keys);
+	if (batch->sort_help)       dealloc(get_heap_allocator(), batch->sort_help);
+	*batch = (Gfx_Batch){0};
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -7,25 +7,6 @@ const Gfx_Handle GFX_INVALID_HANDLE = 0;
 
 string temp_win32_null_terminated_wide_to_fixed_utf8(const u16 *utf16);
 
-// We wanna pack this at some point
-// #Cleanup #Memory why am I doing alignat(16)?
-typedef struct alignat(16) D3D11_Vertex {
-	
-	Vector4 color;
-	Vector4 position;
-	Vector2 uv;
-	Vector2 self_uv;
-	s8 texture_index;
-	u8 type;
-	u8 sampler;
-	u8 has_scissor;
-	
-	Vector4 userdata[VERTEX_2D_USER_DATA_COUNT];
-	
-	Vector4 scissor;
-	
-} D3D11_Vertex;
-
 ID3D11Debug *d3d11_debug = 0;
 
 ID3D11Device *d3d11_device = 0;
@@ -53,13 +34,21 @@ ID3D11InputLayout  *d3d11_image_vertex_layout = 0;
 
 ID3D11Buffer *d3d11_quad_vbo = 0;
 u32 d3d11_quad_vbo_size = 0;
-void *d3d11_staging_quad_buffer = 0;
 
 ID3D11Buffer *d3d11_cbuffer = 0;
 u64 d3d11_cbuffer_size = 0;
 
-Draw_Quad *sort_quad_buffer = 0;
-u64 sort_quad_buffer_size = 0;
+// World to clip for static batches, identity for the frame's quads which are already in ndc.
+// In the last vertex shader cbuffer slot so b0-b12 are free for shader extensions.
+// #Volatile register(b13) in the shader
+#define D3D11_QUAD_TRANSFORM_CBUFFER_SLOT 13
+ID3D11Buffer *d3d11_quad_transform_cbuffer = 0;
+
+Gfx_Batch d3d11_batch = ZERO(Gfx_Batch);
+
+// For the profiler counters, reset every frame
+u64 d3d11_frame_draw_calls = 0;
+u64 d3d11_frame_texture_slots = 0;
 
 // Defined at the bottom of this file
 extern const char *d3d11_image_shader_source;
@@ -275,89 +264,85 @@ d3d11_compile_shader(string source) {
 
 
 
-	#define layout_base_count 9
+	// Everything is per instance (one per quad), vs_main picks the corner from SV_VertexID
+	#define layout_base_count 11
 	D3D11_INPUT_ELEMENT_DESC layout[layout_base_count+VERTEX_2D_USER_DATA_COUNT];
 	memset(layout, 0, sizeof(layout));
 	
-	layout[0].SemanticName = "POSITION";
-	layout[0].SemanticIndex = 0;
-	layout[0].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	layout[0].InputSlot = 0;
-	layout[0].AlignedByteOffset = offsetof(D3D11_Vertex, position);
-	layout[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[0].InstanceDataStepRate = 0;
-	
-	layout[1].SemanticName = "TEXCOORD";
-	layout[1].SemanticIndex = 0;
-	layout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
-	layout[1].InputSlot = 0;
-	layout[1].AlignedByteOffset = offsetof(D3D11_Vertex, uv);
-	layout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[1].InstanceDataStepRate = 0;
-	
-	layout[2].SemanticName = "COLOR";
-	layout[2].SemanticIndex = 0;
-	layout[2].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	layout[2].InputSlot = 0;
-	layout[2].AlignedByteOffset = offsetof(D3D11_Vertex, color);
-	layout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[2].InstanceDataStepRate = 0;
-	
-	layout[3].SemanticName = "TEXTURE_INDEX";
-	layout[3].SemanticIndex = 0;
-	layout[3].Format = DXGI_FORMAT_R8_SINT;
-	layout[3].InputSlot = 0;
-	layout[3].AlignedByteOffset = offsetof(D3D11_Vertex, texture_index);
-	layout[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[3].InstanceDataStepRate = 0;
-	
-	layout[4].SemanticName = "TYPE";
+	for (int i = 0; i < 4; ++i) {
+	    layout[i].SemanticName = "CORNER";
+	    layout[i].SemanticIndex = i;
+	    layout[i].Format = DXGI_FORMAT_R32G32_FLOAT;
+	    layout[i].InputSlot = 0;
+	    layout[i].AlignedByteOffset = offsetof(Gfx_Quad_Instance, corners) + sizeof(Vector2) * i;
+	    layout[i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	    layout[i].InstanceDataStepRate = 1;
+	}
+	
+	layout[4].SemanticName = "TEXCOORD";
 	layout[4].SemanticIndex = 0;
-	layout[4].Format = DXGI_FORMAT_R8_UINT;
+	layout[4].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	layout[4].InputSlot = 0;
-	layout[4].AlignedByteOffset = offsetof(D3D11_Vertex, type);
-	layout[4].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[4].InstanceDataStepRate = 0;
+	layout[4].AlignedByteOffset = offsetof(Gfx_Quad_Instance, uv);
+	layout[4].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[4].InstanceDataStepRate = 1;
 	
-	layout[5].SemanticName = "SAMPLER_INDEX";
+	layout[5].SemanticName = "COLOR";
 	layout[5].SemanticIndex = 0;
-	layout[5].Format = DXGI_FORMAT_R8_SINT;
+	layout[5].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	layout[5].InputSlot = 0;
-	layout[5].AlignedByteOffset = offsetof(D3D11_Vertex, sampler);
-	layout[5].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[5].InstanceDataStepRate = 0;
+	layout[5].AlignedByteOffset = offsetof(Gfx_Quad_Instance, color);
+	layout[5].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[5].InstanceDataStepRate = 1;
 	
-	layout[6].SemanticName = "SELF_UV";
+	layout[6].SemanticName = "TEXTURE_INDEX";
 	layout[6].SemanticIndex = 0;
-	layout[6].Format = DXGI_FORMAT_R32G32_FLOAT;
+	layout[6].Format = DXGI_FORMAT_R8_SINT;
 	layout[6].InputSlot = 0;
-	layout[6].AlignedByteOffset = offsetof(D3D11_Vertex, self_uv);
-	layout[6].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[6].InstanceDataStepRate = 0;
+	layout[6].AlignedByteOffset = offsetof(Gfx_Quad_Instance, texture_index);
+	layout[6].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[6].InstanceDataStepRate = 1;
 	
-	layout[7].SemanticName = "SCISSOR";
+	layout[7].SemanticName = "TYPE";
 	layout[7].SemanticIndex = 0;
-	layout[7].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	layout[7].Format = DXGI_FORMAT_R8_UINT;
 	layout[7].InputSlot = 0;
-	layout[7].AlignedByteOffset = offsetof(D3D11_Vertex, scissor);
-	layout[7].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[7].InstanceDataStepRate = 0;
+	layout[7].AlignedByteOffset = offsetof(Gfx_Quad_Instance, type);
+	layout[7].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[7].InstanceDataStepRate = 1;
 	
-	layout[8].SemanticName = "HAS_SCISSOR";
+	layout[8].SemanticName = "SAMPLER_INDEX";
 	layout[8].SemanticIndex = 0;
-	layout[8].Format = DXGI_FORMAT_R8_UINT;
+	layout[8].Format = DXGI_FORMAT_R8_SINT;
 	layout[8].InputSlot = 0;
-	layout[8].AlignedByteOffset = offsetof(D3D11_Vertex, has_scissor);
-	layout[8].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	layout[8].InstanceDataStepRate = 0;
+	layout[8].AlignedByteOffset = offsetof(Gfx_Quad_Instance, sampler);
+	layout[8].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[8].InstanceDataStepRate = 1;
+	
+	layout[9].SemanticName = "SCISSOR";
+	layout[9].SemanticIndex = 0;
+	layout[9].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	layout[9].InputSlot = 0;
+	layout[9].AlignedByteOffset = offsetof(Gfx_Quad_Instance, scissor);
+	layout[9].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[9].InstanceDataStepRate = 1;
+	
+	layout[10].SemanticName = "HAS_SCISSOR";
+	layout[10].SemanticIndex = 0;
+	layout[10].Format = DXGI_FORMAT_R8_UINT;
+	layout[10].InputSlot = 0;
+	layout[10].AlignedByteOffset = offsetof(Gfx_Quad_Instance, has_scissor);
+	layout[10].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	layout[10].InstanceDataStepRate = 1;
 	
 	for (int i = 0; i < VERTEX_2D_USER_DATA_COUNT; ++i) {
 	    layout[layout_base_count + i].SemanticName = "USERDATA";
 	    layout[layout_base_count + i].SemanticIndex = i;
 	    layout[layout_base_count + i].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	    layout[layout_base_count + i].InputSlot = 0;
-	    layout[layout_base_count + i].AlignedByteOffset = offsetof(D3D11_Vertex, userdata) + sizeof(Vector4) * i;
-	    layout[layout_base_count + i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	    layout[layout_base_count + i].AlignedByteOffset = offsetof(Gfx_Quad_Instance, userdata) + sizeof(Vector4) * i;
+	    layout[layout_base_count + i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	    layout[layout_base_count + i].InstanceDataStepRate = 1;
 	}
 	
 	
@@ -517,6 +502,16 @@ void gfx_init() {
 	    win32_check_hr(hr);
 	}
 	
+	{
+		D3D11_BUFFER_DESC desc = ZERO(D3D11_BUFFER_DESC);
+		desc.ByteWidth      = sizeof(Matrix4);
+		desc.Usage          = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		hr = ID3D11Device_CreateBuffer(d3d11_device, &desc, 0, &d3d11_quad_transform_cbuffer);
+		win32_check_hr(hr);
+	}
+	
 	string source = STR(d3d11_image_shader_source);
 	
 	bool ok = d3d11_compile_shader(source);
@@ -527,7 +522,20 @@ void gfx_init() {
 	
 }
 
-void d3d11_draw_call(int number_of_rendered_quads, ID3D11ShaderResourceView **textures, u64 num_textures) {
+void d3d11_set_quad_transform(Matrix4 transform) {
+	D3D11_MAPPED_SUBRESOURCE mapping;
+	HRESULT hr = ID3D11DeviceContext_Map(d3d11_context, (ID3D11Resource*)d3d11_quad_transform_cbuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
+	win32_check_hr(hr);
+	memcpy(mapping.pData, &transform, sizeof(Matrix4));
+	ID3D11DeviceContext_Unmap(d3d11_context, (ID3D11Resource*)d3d11_quad_transform_cbuffer, 0);
+	
+	ID3D11DeviceContext_VSSetConstantBuffers(d3d11_context, D3D11_QUAD_TRANSFORM_CBUFFER_SLOT, 1, &d3d11_quad_transform_cbuffer);
+}
+
+void d3d11_draw_call(Gfx_Draw_Call *call, ID3D11Buffer *instance_buffer) {
+	d3d11_frame_draw_calls += 1;
+	d3d11_frame_texture_slots = max(d3d11_frame_texture_slots, call->texture_count);
+	
 	ID3D11DeviceContext_OMSetBlendState(d3d11_context, d3d11_blend_state, 0, 0xffffffff);
 	ID3D11DeviceContext_OMSetRenderTargets(d3d11_context, 1, &d3d11_window_render_target_view, 0); 
 	ID3D11DeviceContext_RSSetState(d3d11_context, d3d11_rasterizer);
@@ -537,17 +545,35 @@ void d3d11_draw_call(int number_of_rendered_quads, ID3D11ShaderResourceView **te
 	viewport.MaxDepth = 1.0;
 	ID3D11DeviceContext_RSSetViewports(d3d11_context, 1, &viewport);
 	
-    UINT stride = sizeof(D3D11_Vertex);
+    UINT stride = sizeof(Gfx_Quad_Instance);
     UINT offset = 0;
 	
 	ID3D11DeviceContext_IASetInputLayout(d3d11_context, d3d11_image_vertex_layout);
-    ID3D11DeviceContext_IASetVertexBuffers(d3d11_context, 0, 1, &d3d11_quad_vbo, &stride, &offset);
+    ID3D11DeviceContext_IASetVertexBuffers(d3d11_context, 0, 1, &instance_buffer, &stride, &offset);
     ID3D11DeviceContext_IASetPrimitiveTopology(d3d11_context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     ID3D11DeviceContext_VSSetShader(d3d11_context, d3d11_vertex_shader_for_2d, NULL, 0);
     ID3D11DeviceContext_PSSetShader(d3d11_context, d3d11_fragment_shader_for_2d, NULL, 0);
     
-	if (draw_frame.cbuffer && d3d11_cbuffer && d3d11_cbuffer_size) {
+    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 0, 1, &d3d11_image_sampler_np_fp);
+    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 1, 1, &d3d11_image_sampler_nl_fl);
+    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 2, 1, &d3d11_image_sampler_np_fl);
+    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 3, 1, &d3d11_image_sampler_nl_fp);
+    ID3D11DeviceContext_PSSetShaderResources(d3d11_context, 0, call->texture_count, call->textures);
+
+    // 6 vertices (two triangles) per quad instance
+    ID3D11DeviceContext_DrawInstanced(d3d11_context, 6, call->instance_count, 0, call->first_instance);
+}
+
+void d3d11_process_draw_frame(Gfx_Render_Frame *f) {
+
+	HRESULT hr;
+	Draw_Frame *draw = f->frame;
+	
+	ID3D11DeviceContext_ClearRenderTargetView(d3d11_context, d3d11_window_render_target_view, (float*)&f->clear_color);
+	
+	// Same for every draw call this frame
+	if (f->cbuffer && d3d11_cbuffer && d3d11_cbuffer_size) {
 		D3D11_MAPPED_SUBRESOURCE cbuffer_mapping;
 		ID3D11DeviceContext_Map(
 			d3d11_context, 
@@ -557,216 +583,86 @@ void d3d11_draw_call(int number_of_rendered_quads, ID3D11ShaderResourceView **te
 			0, 
 			&cbuffer_mapping
 		);
-		memcpy(cbuffer_mapping.pData, draw_frame.cbuffer, d3d11_cbuffer_size);
+		memcpy(cbuffer_mapping.pData, f->cbuffer, d3d11_cbuffer_size);
 		ID3D11DeviceContext_Unmap(d3d11_context, (ID3D11Resource*)d3d11_cbuffer, 0);
 		
 		ID3D11DeviceContext_PSSetConstantBuffers(d3d11_context, 0, 1, &d3d11_cbuffer);
 	}
-    
-    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 0, 1, &d3d11_image_sampler_np_fp);
-    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 1, 1, &d3d11_image_sampler_nl_fl);
-    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 2, 1, &d3d11_image_sampler_np_fl);
-    ID3D11DeviceContext_PSSetSamplers(d3d11_context, 3, 1, &d3d11_image_sampler_nl_fp);
-    ID3D11DeviceContext_PSSetShaderResources(d3d11_context, 0, num_textures, textures);
-
-    ID3D11DeviceContext_Draw(d3d11_context, number_of_rendered_quads * 6, 0);
-}
-
-void d3d11_process_draw_frame() {
-
-	HRESULT hr;
-	
-	ID3D11DeviceContext_ClearRenderTargetView(d3d11_context, d3d11_window_render_target_view, (float*)&window.clear_color);
 	
 	///
-	// Maybe grow quad vbo
-	u32 required_size = sizeof(D3D11_Vertex) * allocated_quads*6;
-
-	if (required_size > d3d11_quad_vbo_size) {
-		if (d3d11_quad_vbo) {
-			D3D11Release(d3d11_quad_vbo);
-			dealloc(get_heap_allocator(), d3d11_staging_quad_buffer);
+	// Static batches, under everything else. Uploaded once, then only the transform changes.
+	tm_scope("Static batches") frame_stat_scope(FRAME_STAT_GPU_SUBMIT) {
+		for (u64 i = 0; i < draw->static_batch_draw_count; i++) {
+			Static_Batch_Draw *d = &draw->static_batch_draws[i];
+			Static_Batch *sb = d->batch;
+			
+			// Cleared or recorded empty after it was drawn this frame, and D3D11 can't make an
+			// empty buffer
+			if (sb->batch.instance_count == 0) {
+				gfx_release_static_batch(sb);
+				sb->gpu_version = sb->version;
+				continue;
+			}
+			
+			if (sb->gpu_version != sb->version) {
+				gfx_release_static_batch(sb);
+				
+				D3D11_BUFFER_DESC desc = ZERO(D3D11_BUFFER_DESC);
+				desc.Usage = D3D11_USAGE_IMMUTABLE;
+				desc.ByteWidth = sb->batch.instance_count*sizeof(Gfx_Quad_Instance);
+				desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+				D3D11_SUBRESOURCE_DATA data = ZERO(D3D11_SUBRESOURCE_DATA);
+				data.pSysMem = sb->batch.instances;
+				ID3D11Buffer *buffer = 0;
+				hr = ID3D11Device_CreateBuffer(d3d11_device, &desc, &data, &buffer);
+				win32_check_hr(hr);
+				
+				sb->gpu_data = buffer;
+				sb->gpu_version = sb->version;
+			}
+			
+			d3d11_set_quad_transform(d->world_to_clip);
+			for (u64 j = 0; j < sb->batch.draw_call_count; j++) {
+				d3d11_draw_call(&sb->batch.draw_calls[j], (ID3D11Buffer*)sb->gpu_data);
+			}
 		}
-		D3D11_BUFFER_DESC desc = ZERO(D3D11_BUFFER_DESC);
-		desc.Usage = D3D11_USAGE_DYNAMIC; 
-		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		desc.ByteWidth = required_size;
-		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		HRESULT hr = ID3D11Device_CreateBuffer(d3d11_device, &desc, 0, &d3d11_quad_vbo);
-		assert(SUCCEEDED(hr), "CreateBuffer failed");
-		d3d11_quad_vbo_size = required_size;
-		
-		d3d11_staging_quad_buffer = alloc(get_heap_allocator(), d3d11_quad_vbo_size);
-		assert((u64)d3d11_staging_quad_buffer%16 == 0);
-		
-		log_verbose("Grew quad vbo to %d bytes.", d3d11_quad_vbo_size);
+	}
+	d3d11_set_quad_transform(m4_scalar(1.0));
+	
+	tm_scope("Quad processing") frame_stat_scope(FRAME_STAT_QUADS) {
+		gfx_batch_build(&d3d11_batch, f->quads, draw->num_quads, f->scissor_rects, draw->enable_z_sorting, f->viewport_width, f->viewport_height);
 	}
 
-	if (draw_frame.num_quads > 0) {
+	if (d3d11_batch.instance_count > 0) {
+	
 		///
-		// Render geometry from into vbo quad list
-	    
-		
-		ID3D11ShaderResourceView *textures[32];
-		ID3D11ShaderResourceView *last_texture = 0;
-		u64 num_textures = 0;
-		s8 last_texture_index = 0;
-		
-		D3D11_Vertex* head = (D3D11_Vertex*)d3d11_staging_quad_buffer;
-		D3D11_Vertex* pointer = head;
-		u64 number_of_rendered_quads = 0;
-		
-		tm_scope("Quad processing") {
-			if (draw_frame.enable_z_sorting) tm_scope("Z sorting") {
-				if (!sort_quad_buffer || (sort_quad_buffer_size < allocated_quads*sizeof(Draw_Quad))) {
-					// #Memory #Heapalloc
-					if (sort_quad_buffer) dealloc(get_heap_allocator(), sort_quad_buffer);
-					sort_quad_buffer = alloc(get_heap_allocator(), allocated_quads*sizeof(Draw_Quad));
-					sort_quad_buffer_size = allocated_quads*sizeof(Draw_Quad);
-				}
-				radix_sort(quad_buffer, sort_quad_buffer, draw_frame.num_quads, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
-			}
-		
-			for (u64 i = 0; i < draw_frame.num_quads; i++)  {
-				
-				Draw_Quad *q = &quad_buffer[i];
-				
-				assert(q->z <= MAX_Z, "Z is too high. Z is %d, Max is %d.", q->z, MAX_Z);
-				assert(q->z >= (-MAX_Z+1), "Z is too low. Z is %d, Min is %d.", q->z, -MAX_Z+1);
-				
-				s8 texture_index = -1;
-				
-				if (q->image) {
-					
-					if (last_texture == q->image->gfx_handle) {
-						texture_index = last_texture_index;
-					} else {
-						// First look if texture is already bound
-						for (u64 j = 0; j < num_textures; j++) {
-							if (textures[j] == q->image->gfx_handle) {
-								texture_index = (s8)j;
-								break;
-							}
-						}
-						// Otherwise use a new slot
-						if (texture_index <= -1) {
-							if (num_textures >= 32) {
-								// If max textures reached, make a draw call and start over
-								D3D11_MAPPED_SUBRESOURCE buffer_mapping;
-								ID3D11DeviceContext_Map(d3d11_context, (ID3D11Resource*)d3d11_quad_vbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &buffer_mapping);
-								memcpy(buffer_mapping.pData, d3d11_staging_quad_buffer, number_of_rendered_quads*sizeof(D3D11_Vertex)*6);
-								ID3D11DeviceContext_Unmap(d3d11_context, (ID3D11Resource*)d3d11_quad_vbo, 0);
-								d3d11_draw_call(number_of_rendered_quads, textures, num_textures);
-								head = (D3D11_Vertex*)d3d11_staging_quad_buffer;
-								num_textures = 0;
-								texture_index = 0;
-								number_of_rendered_quads = 0;
-								pointer = head;
-							} else {
-								texture_index = (s8)num_textures;
-								num_textures += 1;
-							}
-						}
-					}
-					textures[texture_index] = q->image->gfx_handle;
-					last_texture = q->image->gfx_handle;
-					last_texture_index = texture_index;
-				}
-				
-				if (q->type == QUAD_TYPE_TEXT) {
-					float pixel_width = 2.0/(float)window.width;
-					float pixel_height = 2.0/(float)window.height;
-					
-					q->bottom_left.x  = round(q->bottom_left.x  / pixel_width)  * pixel_width;
-				    q->bottom_left.y  = round(q->bottom_left.y  / pixel_height) * pixel_height;
-				    q->top_left.x     = round(q->top_left.x     / pixel_width)  * pixel_width;
-				    q->top_left.y     = round(q->top_left.y     / pixel_height) * pixel_height;
-				    q->top_right.x    = round(q->top_right.x    / pixel_width)  * pixel_width;
-				    q->top_right.y    = round(q->top_right.y    / pixel_height) * pixel_height;
-				    q->bottom_right.x = round(q->bottom_right.x / pixel_width)  * pixel_width;
-				    q->bottom_right.y = round(q->bottom_right.y / pixel_height) * pixel_height;
-				}
-				
-				// We will write to 6 vertices for the one quad (two tris)
-				 {
-				
-					D3D11_Vertex* BL  = pointer + 0;
-					D3D11_Vertex* TL  = pointer + 1;
-					D3D11_Vertex* TR  = pointer + 2;
-					D3D11_Vertex* BL2 = pointer + 3;
-					D3D11_Vertex* TR2 = pointer + 4;
-					D3D11_Vertex* BR  = pointer + 5;
-					pointer += 6;
-					
-					BL->position = v4(q->bottom_left.x,  q->bottom_left.y,  0, 1);
-					TL->position = v4(q->top_left.x,     q->top_left.y,     0, 1);
-					TR->position = v4(q->top_right.x,    q->top_right.y,    0, 1);
-					BR->position = v4(q->bottom_right.x, q->bottom_right.y, 0, 1);
-					
-					BL->uv = v2(q->uv.x1, q->uv.y1);
-					TL->uv = v2(q->uv.x1, q->uv.y2);
-					TR->uv = v2(q->uv.x2, q->uv.y2);
-					BR->uv = v2(q->uv.x2, q->uv.y1);
-					
-					BL->self_uv = v2(0, 0);
-					TL->self_uv = v2(0, 1);
-					TR->self_uv = v2(1, 1);
-					BR->self_uv = v2(1, 0);
-					
-					// #Speed
-					memcpy(BL->userdata, q->userdata, sizeof(q->userdata));
-					memcpy(TL->userdata, q->userdata, sizeof(q->userdata));
-					memcpy(TR->userdata, q->userdata, sizeof(q->userdata));
-					memcpy(BR->userdata, q->userdata, sizeof(q->userdata));
-					
-					BL->color = TL->color = TR->color = BR->color = q->color;
-					
-					BL->texture_index=TL->texture_index=TR->texture_index=BR->texture_index = texture_index;
-					BL->type=TL->type=TR->type=BR->type = (u8)q->type;
-					
-					float t = q->scissor.y1;
-					q->scissor.y1 = q->scissor.y2;
-					q->scissor.y2 = t;
-					
-					q->scissor.y1 = window.pixel_height - q->scissor.y1;
-					q->scissor.y2 = window.pixel_height - q->scissor.y2;
-					
-					BL->has_scissor=TL->has_scissor=TR->has_scissor=BR->has_scissor = q->has_scissor;
-					BL->scissor=TL->scissor=TR->scissor=BR->scissor = q->scissor;
-					
-					u8 sampler = -1;
-					if (q->image_min_filter == GFX_FILTER_MODE_NEAREST
-						 		&& q->image_mag_filter == GFX_FILTER_MODE_NEAREST)
-						 	sampler = 0;
-					if (q->image_min_filter == GFX_FILTER_MODE_LINEAR
-						 		&& q->image_mag_filter == GFX_FILTER_MODE_LINEAR)
-						 	sampler = 1;
-					if (q->image_min_filter == GFX_FILTER_MODE_LINEAR
-						 		&& q->image_mag_filter == GFX_FILTER_MODE_NEAREST)
-						 	sampler = 2;
-					if (q->image_min_filter == GFX_FILTER_MODE_NEAREST
-						 		&& q->image_mag_filter == GFX_FILTER_MODE_LINEAR)
-						 	sampler = 3;
-						 	
-					BL->type=TL->type=TR->type=BR->type = (u8)q->type;
-					BL->sampler=TL->sampler=TR->sampler=BR->sampler = (u8)sampler;
-					
-					*BL2 = *BL;
-					*TR2 = *TR;
-					
-					number_of_rendered_quads += 1;
-				}
+		// Maybe grow quad vbo
+		u32 required_size = sizeof(Gfx_Quad_Instance) * f->quad_capacity;
+	
+		if (required_size > d3d11_quad_vbo_size) {
+			if (d3d11_quad_vbo) {
+				D3D11Release(d3d11_quad_vbo);
 			}
+			D3D11_BUFFER_DESC desc = ZERO(D3D11_BUFFER_DESC);
+			desc.Usage = D3D11_USAGE_DYNAMIC; 
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			desc.ByteWidth = required_size;
+			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			hr = ID3D11Device_CreateBuffer(d3d11_device, &desc, 0, &d3d11_quad_vbo);
+			assert(SUCCEEDED(hr), "CreateBuffer failed");
+			d3d11_quad_vbo_size = required_size;
+			
+			log_verbose("Grew quad vbo to %d bytes.", d3d11_quad_vbo_size);
 		}
 		
-		tm_scope("Write to gpu") {
+		tm_scope("Write to gpu") frame_stat_scope(FRAME_STAT_GPU_SUBMIT) {
 		    D3D11_MAPPED_SUBRESOURCE buffer_mapping;
 			tm_scope("The Map call") {
 				hr = ID3D11DeviceContext_Map(d3d11_context, (ID3D11Resource*)d3d11_quad_vbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &buffer_mapping);
 			win32_check_hr(hr);
 			}
 			tm_scope("The memcpy") {
-				memcpy(buffer_mapping.pData, d3d11_staging_quad_buffer, number_of_rendered_quads*sizeof(D3D11_Vertex)*6);
+				memcpy(buffer_mapping.pData, d3d11_batch.instances, d3d11_batch.instance_count*sizeof(Gfx_Quad_Instance));
 			}
 			tm_scope("The Unmap call") {
 				ID3D11DeviceContext_Unmap(d3d11_context, (ID3D11Resource*)d3d11_quad_vbo, 0);
@@ -774,21 +670,18 @@ void d3d11_process_draw_frame() {
 		}
 		
 		///
-		// Draw call
-		tm_scope("Draw call") d3d11_draw_call(number_of_rendered_quads, textures, num_textures);
+		// Draw calls
+		tm_scope("Draw call") frame_stat_scope(FRAME_STAT_GPU_SUBMIT) {
+			for (u64 i = 0; i < d3d11_batch.draw_call_count; i++) {
+				d3d11_draw_call(&d3d11_batch.draw_calls[i], d3d11_quad_vbo);
+			}
+		}
     }
-    
-    reset_draw_frame(&draw_frame);
 }
 
-void gfx_update() {
-	if (window.should_close) return;
-	
-	
-
-	HRESULT hr;
-	///
-	// Maybe resize swap chain
+// ResizeBuffers can send messages to the window, so it's done on the game thread which pumps
+// them, while no frame is in flight.
+void gfx_sync_window() {
 	RECT client_rect;
 	bool ok = GetClientRect(window._os_handle, &client_rect);
 	assert(ok, "GetClientRect failed with error code %lu", GetLastError());
@@ -797,11 +690,22 @@ void gfx_update() {
 	if (window_width != d3d11_swap_chain_width || window_height != d3d11_swap_chain_height) {
 		d3d11_update_swapchain();
 	}
+}
+
+// Runs on the render thread when it's started (gfx_render_thread.c). Everything in here that
+// touches d3d11_context is only done while the game thread isn't, since the game thread waits
+// for the render thread before changing images, static batches, shaders or the swap chain.
+// Present doesn't need the window's thread, alt enter fullscreen is disabled in
+// d3d11_update_swapchain().
+void gfx_render_frame(Gfx_Render_Frame *f) {
+
+	HRESULT hr;
 
-	d3d11_process_draw_frame();
+	u64 quad_count = f->frame->num_quads;
+	d3d11_process_draw_frame(f);
 
-	tm_scope("Present") {
-		IDXGISwapChain1_Present(d3d11_swap_chain, window.enable_vsync, window.enable_vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+	tm_scope("Present") frame_stat_scope(FRAME_STAT_PRESENT) {
+		IDXGISwapChain1_Present(d3d11_swap_chain, f->enable_vsync, f->enable_vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 	}
 	
 	
@@ -825,11 +729,17 @@ void gfx_update() {
 		}
 	}
 #endif
-	
+
+	tm_counter("Quads", quad_count);
+	tm_counter("Draw calls", d3d11_frame_draw_calls);
+	tm_counter("Texture slots used", d3d11_frame_texture_slots);
+	d3d11_frame_draw_calls = 0;
+	d3d11_frame_texture_slots = 0;
 }
 
 
 void gfx_init_image(Gfx_Image *image, void *initial_data) {
+	gfx_render_thread_wait();
 
 	void *data = initial_data;
     if (!initial_data){
@@ -877,6 +787,11 @@ void gfx_init_image(Gfx_Image *image, void *initial_data) {
 }
 void gfx_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data) {
     assert(image && data, "Bad parameters passed to gfx_set_image_data");
+    gfx_render_thread_wait();
+    if (image->atlas_page) {
+    	gfx_atlas_set_image_data(image, x, y, w, h, data);
+    	return;
+    }
 
     ID3D11ShaderResourceView *view = image->gfx_handle;
     ID3D11Resource *resource = NULL;
@@ -902,6 +817,7 @@ void gfx_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data
     ID3D11DeviceContext_UpdateSubresource(d3d11_context, (ID3D11Resource*)texture, 0, &destBox, data, w * image->channels, 0);
 }
 void gfx_deinit_image(Gfx_Image *image) {
+	gfx_render_thread_wait();
 	ID3D11ShaderResourceView *view = image->gfx_handle;
 	ID3D11Resource *resource = 0;
 	ID3D11ShaderResourceView_GetResource(view, &resource);
@@ -917,9 +833,22 @@ void gfx_deinit_image(Gfx_Image *image) {
 	}
 }
 
+void gfx_release_static_batch(Static_Batch *sb) {
+	if (sb->gpu_data) {
+		ID3D11Buffer *buffer = (ID3D11Buffer*)sb->gpu_data;
+		D3D11Release(buffer);
+	}
+	sb->gpu_data = 0;
+	sb->gpu_version = 0;
+}
+
+// ext_source is pasted into the 2D shader and gets the same PS_INPUT as before quads were
+// instanced. It shares the source with the engine's shader, so it can't use register(b13) or
+// declare names like quad_transform, VS_INPUT or vs_main.
 bool 
 shader_recompile_with_extension(string ext_source, u64 cbuffer_size) {
 	
+	gfx_render_thread_wait();
 
 	string source = string_replace_all(STR(d3d11_image_shader_source), STR("$INJECT_PIXEL_POST_PROCESS"), ext_source, get_temporary_allocator());
 	
@@ -940,6 +869,7 @@ shader_recompile_with_extension(string ext_source, u64 cbuffer_size) {
 	win32_check_hr(hr);
 	
 	d3d11_cbuffer_size = cbuffer_size;
+	gfx_frame_cbuffer_size = cbuffer_size;
 	
 	return true;
 }
@@ -948,11 +878,11 @@ shader_recompile_with_extension(string ext_source, u64 cbuffer_size) {
 
 const char *d3d11_image_shader_source = RAW_STRING(
 	
+// One per quad
 struct VS_INPUT
 {
-    float4 position : POSITION;
-    float2 uv : TEXCOORD;
-    float2 self_uv : SELF_UV;
+    float2 corners[4] : CORNER; // BL, TL, TR, BR
+    float4 uv : TEXCOORD;       // x1, y1, x2, y2
     float4 color : COLOR;
     int texture_index : TEXTURE_INDEX;
     uint type : TYPE;
@@ -960,6 +890,7 @@ struct VS_INPUT
     uint has_scissor : HAS_SCISSOR;
     float4 userdata[$VERTEX_2D_USER_DATA_COUNT] : USERDATA;
     float4 scissor : SCISSOR;
+    uint vertex_id : SV_VertexID;
 };
 
 struct PS_INPUT
@@ -979,17 +910,33 @@ struct PS_INPUT
 
 
 
+// World to clip for static batches, identity otherwise
+// #Volatile D3D11_QUAD_TRANSFORM_CBUFFER_SLOT
+cbuffer quad_transform_cbuffer : register(b13) {
+    row_major float4x4 quad_transform;
+};
+
 PS_INPUT vs_main(VS_INPUT input)
 {
+    // Two triangles: BL, TL, TR, BL, TR, BR
+    static const uint corner_of_vertex[6] = { 0, 1, 2, 0, 2, 3 };
+    uint corner = corner_of_vertex[input.vertex_id];
+    
+    float2 corner_position = input.corners[0];
+    if (corner == 1) corner_position = input.corners[1];
+    if (corner == 2) corner_position = input.corners[2];
+    if (corner == 3) corner_position = input.corners[3];
+    float2 self_uv = float2(corner >= 2 ? 1.0 : 0.0, (corner == 1 || corner == 2) ? 1.0 : 0.0);
+    
     PS_INPUT output;
-    output.position_screen = input.position;
-    output.position = input.position;
-    output.uv = input.uv;
+    output.position_screen = mul(quad_transform, float4(corner_position, 0.0, 1.0));
+    output.position = output.position_screen;
+    output.uv = lerp(input.uv.xy, input.uv.zw, self_uv);
     output.color = input.color;
     output.texture_index = input.texture_index;
     output.type          = input.type;
     output.sampler_index = input.sampler_index;
-    output.self_uv = input.self_uv;
+    output.self_uv = self_uv;
 	for (int i = 0; i < $VERTEX_2D_USER_DATA_COUNT; i++) {
     	output.userdata[i] = input.userdata[i];
 	}
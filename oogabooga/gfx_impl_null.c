@@ -0,0 +1,130 @@
+
+/*
+	Renderer that draws nothing.
+
+	It does all the CPU side work of a real renderer (see gfx_batch.c) and records what it
+	would have submitted, so whole frames can be run & benchmarked without a GPU:
+
+		#define OOGABOOGA_HEADLESS 1
+		#define GFX_RENDERER GFX_RENDERER_NULL
+		#include "oogabooga/oogabooga.c"
+		...
+		draw_game();
+		gfx_update();
+		gfx_render_thread_wait(); // If the render thread is running
+		log("%llu draw calls", null_renderer_last_frame.draw_call_count);
+
+	Headless programs have no window, so the frame is 1280x720 unless window.width/height
+	are set before oogabooga_init().
+
+	The renderer itself is portable, but there is only a Windows os layer (os_impl_windows.c)
+	so far. Until there's a Linux one, headless & null renderer builds are Windows only too,
+	they just don't need a GPU or a window.
+*/
+
+typedef struct Null_Renderer_Frame {
+	u64 quad_count;
+	u64 instance_count;
+	u64 draw_call_count;
+	u64 texture_slots_used; // Most in any one draw call
+	u64 upload_bytes;
+	u64 static_batch_count;
+	u64 static_instance_count;
+	u64 first_frame_draw_call; // Static batches are submitted first, then the frame's quads
+} Null_Renderer_Frame;
+
+const Gfx_Handle GFX_INVALID_HANDLE = 0;
+
+Gfx_Batch null_renderer_batch = ZERO(Gfx_Batch);
+Null_Renderer_Frame null_renderer_last_frame = ZERO(Null_Renderer_Frame);
+u64 null_renderer_next_image_handle = 1;
+
+void gfx_init() {
+	if (window.width == 0 || window.height == 0) {
+		window.width  = 1280;
+		window.height = 720;
+	}
+	log_info("Null renderer init done, nothing will be drawn");
+}
+
+void gfx_sync_window() {}
+
+void null_renderer_count_draw_calls(Null_Renderer_Frame *frame, Gfx_Batch *batch) {
+	for (u64 i = 0; i < batch->draw_call_count; i++) {
+		Gfx_Draw_Call *call = &batch->draw_calls[i];
+		if (call->instance_count == 0) continue;
+		frame->draw_call_count += 1;
+		frame->texture_slots_used = max(frame->texture_slots_used, call->texture_count);
+	}
+}
+
+void gfx_render_frame(Gfx_Render_Frame *f) {
+	Draw_Frame *draw = f->frame;
+
+	Null_Renderer_Frame frame = ZERO(Null_Renderer_Frame);
+	frame.quad_count = draw->num_quads;
+
+	tm_scope("Quad processing") frame_stat_scope(FRAME_STAT_QUADS) {
+		gfx_batch_build(&null_renderer_batch, f->quads, draw->num_quads, f->scissor_rects, draw->enable_z_sorting, f->viewport_width, f->viewport_height);
+	}
+
+	// Static batches are only uploaded when they changed
+	for (u64 i = 0; i < draw->static_batch_draw_count; i++) {
+		Static_Batch *sb = draw->static_batch_draws[i].batch;
+		// Cleared or recorded empty after it was drawn this frame, nothing to upload or draw
+		if (sb->batch.instance_count == 0) {
+			sb->gpu_version = sb->version;
+			continue;
+		}
+		if (sb->gpu_version != sb->version) {
+			frame.upload_bytes += sb->batch.instance_count*sizeof(Gfx_Quad_Instance);
+			sb->gpu_version = sb->version;
+		}
+		frame.static_batch_count += 1;
+		frame.static_instance_count += sb->batch.instance_count;
+		null_renderer_count_draw_calls(&frame, &sb->batch);
+	}
+
+	frame.first_frame_draw_call = frame.draw_call_count;
+	frame.instance_count = null_renderer_batch.instance_count;
+	frame.upload_bytes += null_renderer_batch.instance_count*sizeof(Gfx_Quad_Instance);
+	null_renderer_count_draw_calls(&frame, &null_renderer_batch);
+	null_renderer_last_frame = frame;
+
+	tm_counter("Quads", frame.quad_count);
+	tm_counter("Draw calls", frame.draw_call_count);
+	tm_counter("Texture slots used", frame.texture_slots_used);
+}
+
+// Images get a unique handle so texture slots are assigned like on a real renderer
+void gfx_init_image(Gfx_Image *image, void *initial_data) {
+	gfx_render_thread_wait();
+	assert(image->channels > 0 && image->channels <= 4 && image->channels != 3, "Only 1, 2 or 4 channels allowed on images. Got %d", image->channels);
+	image->gfx_handle = (Gfx_Handle)null_renderer_next_image_handle;
+	null_renderer_next_image_handle += 1;
+}
+void gfx_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data) {
+	assert(image && data, "Bad parameters passed to gfx_set_image_data");
+	gfx_render_thread_wait();
+	if (image->atlas_page) {
+		gfx_atlas_set_image_data(image, x, y, w, h, data);
+		return;
+	}
+	assert(x+w <= image->width && y+h <= image->height, "Specified subregion in image is out of bounds");
+}
+void gfx_deinit_image(Gfx_Image *image) {
+	gfx_render_thread_wait();
+	image->gfx_handle = GFX_INVALID_HANDLE;
+}
+
+void gfx_release_static_batch(Static_Batch *sb) {
+	sb->gpu_data = 0;
+	sb->gpu_version = 0;
+}
+
+bool
+shader_recompile_with_extension(string ext_source, u64 cbuffer_size) {
+	gfx_render_thread_wait();
+	gfx_frame_cbuffer_size = cbuffer_size;
+	return true;
+}
@@ -7,6 +7,9 @@
 	#include <d3dcommon.h>
 	typedef ID3D11ShaderResourceView * Gfx_Handle;
 	
+#elif GFX_RENDERER == GFX_RENDERER_NULL
+	typedef void * Gfx_Handle;
+	
 #elif GFX_RENDERER == GFX_RENDERER_VULKAN
 	#error "We only have a D3D11 renderer at the moment"
 #elif GFX_RENDERER == GFX_RENDERER_METAL
@@ -31,16 +34,36 @@ typedef enum Gfx_Filter_Mode {
 	GFX_FILTER_MODE_LINEAR,
 } Gfx_Filter_Mode;
 
+typedef enum Gfx_Image_Flags {
+	// Give the image its own texture instead of packing it into a shared atlas page
+	// (see gfx_atlas.c). For images that repeat (uv outside 0..1) or that are sampled
+	// in a shader extension.
+	GFX_IMAGE_NO_ATLAS = 1 << 0,
+} Gfx_Image_Flags;
+
+typedef struct Gfx_Atlas_Page Gfx_Atlas_Page;
+
 typedef struct Gfx_Image {
 	u32 width, height, channels;
 	Gfx_Handle gfx_handle;
 	Allocator allocator;
+	Gfx_Image_Flags flags;
+	
+	// Set when the image was packed into a shared atlas page (see gfx_atlas.c).
+	// gfx_handle is then the page's and atlas_uv is where the image is in it.
+	Gfx_Atlas_Page *atlas_page;
+	u32 atlas_x, atlas_y;
+	Vector4 atlas_uv;
 } Gfx_Image;
 
 Gfx_Image *
 make_image(u32 width, u32 height, u32 channels, void *initial_data, Allocator allocator);
 Gfx_Image *
+make_image_ex(u32 width, u32 height, u32 channels, void *initial_data, Allocator allocator, Gfx_Image_Flags flags);
+Gfx_Image *
 load_image_from_disk(string path, Allocator allocator);
+Gfx_Image *
+load_image_from_disk_ex(string path, Allocator allocator, Gfx_Image_Flags flags);
 void 
 delete_image(Gfx_Image *image);
 
@@ -57,12 +80,29 @@ gfx_init();
 ogb_instance void 
 gfx_update();
 
+// Implemented in gfx_render_thread.c
+ogb_instance void
+gfx_render_thread_start();
+ogb_instance void
+gfx_render_thread_stop();
+// Returns once the frame in flight has been rendered. Does nothing if the render thread isn't running.
+ogb_instance void
+gfx_render_thread_wait();
+
 ogb_instance bool
 shader_recompile_with_extension(string ext_source, u64 cbuffer_size);
 
+// Implemented in gfx_atlas.c
+ogb_instance bool
+gfx_atlas_try_add_image(Gfx_Image *image, void *initial_data);
+ogb_instance void
+gfx_atlas_remove_image(Gfx_Image *image);
+ogb_instance void
+gfx_atlas_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data);
+
 // initial_data can be null to leave image data uninitialized
 Gfx_Image *
-make_image(u32 width, u32 height, u32 channels, void *initial_data, Allocator allocator) {
+make_image_ex(u32 width, u32 height, u32 channels, void *initial_data, Allocator allocator, Gfx_Image_Flags flags) {
 	Gfx_Image *image = alloc(allocator, sizeof(Gfx_Image) + width*height*channels);
 	
 	assert(channels > 0 && channels <= 4, "Only 1, 2, 3 or 4 channels allowed on images. Got %d", channels);
@@ -72,14 +112,22 @@ make_image(u32 width, u32 height, u32 channels, void *initial_data, Allocator al
     image->gfx_handle = GFX_INVALID_HANDLE;  // This is handled in gfx
     image->allocator = allocator;
     image->channels = channels;
+    image->flags = flags;
+    image->atlas_page = 0;
     
-    gfx_init_image(image, initial_data);
+    if (!gfx_atlas_try_add_image(image, initial_data)) {
+    	gfx_init_image(image, initial_data);
+    }
     
     return image;
 }
+Gfx_Image *
+make_image(u32 width, u32 height, u32 channels, void *initial_data, Allocator allocator) {
+	return make_image_ex(width, height, channels, initial_data, allocator, 0);
+}
 
 Gfx_Image *
-load_image_from_disk(string path, Allocator allocator) {
+load_image_from_disk_ex(string path, Allocator allocator, Gfx_Image_Flags flags) {
     string png;
     bool ok = os_read_entire_file(path, &png, allocator);
     if (!ok) return 0;
@@ -103,10 +151,14 @@ load_image_from_disk(string path, Allocator allocator) {
     image->gfx_handle = GFX_INVALID_HANDLE;  // This is handled in gfx
     image->allocator = allocator;
     image->channels = 4;
+    image->flags = flags;
+    image->atlas_page = 0;
 
     dealloc_string(allocator, png);
     
-    gfx_init_image(image, stb_data);
+    if (!gfx_atlas_try_add_image(image, stb_data)) {
+    	gfx_init_image(image, stb_data);
+    }
     
     stbi_image_free(stb_data);
     
@@ -114,12 +166,19 @@ load_image_from_disk(string path, Allocator allocator) {
 
     return image;
 }
+Gfx_Image *
+load_image_from_disk(string path, Allocator allocator) {
+	return load_image_from_disk_ex(path, allocator, 0);
+}
 
 void 
 delete_image(Gfx_Image *image) {
+    // The frame in flight might still draw it
+    gfx_render_thread_wait();
       // Free the image data allocated by stb_image
     image->width = 0;
     image->height = 0;
-    gfx_deinit_image(image);
+    if (image->atlas_page) gfx_atlas_remove_image(image);
+    else                   gfx_deinit_image(image);
     dealloc(image->allocator, image);
 }
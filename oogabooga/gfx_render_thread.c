@@ -0,0 +1,256 @@
+
+/*
+	Render thread.
+
+	By default gfx_update() sorts, batches, submits and presents the frame on the calling thread,
+	so game update, drawing and rendering run one after the other. Start the render thread and
+	the game builds frame N+1 while frame N is rendered:
+
+		gfx_render_thread_start(); // Or #define GFX_RENDER_THREAD 1 to start it in oogabooga_init()
+		while (!window.should_close) {
+			update_game();
+			draw_game();
+			gfx_update(); // Hands the frame off, waits only if the previous one isn't done yet
+		}
+
+	gfx_update() copies draw_frame and swaps quad_buffer & scissor_buffer with the render thread's,
+	so at most one frame is in flight and the game never waits for more than one frame of rendering.
+
+	Things to know:
+		- Creating, changing or deleting images and recording static batches wait for the frame
+		  in flight, since it might be using them. Loading things mid frame is fine, but costs a
+		  wait.
+		- draw_frame.cbuffer is copied with the frame, the renderer says how big it is.
+		- The renderer's frame stats (quads, gpu submit, present) show up one frame late.
+		- gfx_render_thread_wait() before reading what the renderer did with the last frame, like
+		  null_renderer_last_frame.
+*/
+
+#ifndef GFX_RENDER_THREAD
+	#define GFX_RENDER_THREAD 0
+#endif
+
+// Everything the renderer needs from a frame. Points straight at draw_frame when rendering on
+// the calling thread, at copies when rendering on the render thread.
+typedef struct Gfx_Render_Frame {
+	Draw_Frame *frame;
+	Draw_Quad *quads;
+	u64 quad_capacity;
+	Vector4 *scissor_rects;
+	void *cbuffer;
+	u32 viewport_width, viewport_height;
+	Vector4 clear_color;
+	bool enable_vsync;
+} Gfx_Render_Frame;
+
+typedef struct Gfx_Render_Thread {
+	Thread thread;
+	bool running;
+
+	Mutex mutex;
+	Condition_Variable frame_ready; // Signaled by gfx_update()
+	Condition_Variable frame_done;  // Signaled by the render thread
+	bool busy;
+	bool stop;
+
+	// The frame in flight. The buffers are kept from frame to frame.
+	Gfx_Render_Frame render_frame;
+	Draw_Frame *frame;
+	Draw_Quad *quads;
+	u64 quad_capacity;
+	Vector4 *scissor_rects;
+	u64 scissor_capacity;
+	u8 *cbuffer;
+	u64 cbuffer_capacity;
+
+	u64 stat_cycles[FRAME_STAT_COUNT];
+	u64 frames_rendered;
+} Gfx_Render_Thread;
+
+// Implemented per renderer. Sorts, batches, submits and presents the frame. Runs on the render
+// thread when it's started.
+ogb_instance void
+gfx_render_frame(Gfx_Render_Frame *frame);
+// Implemented per renderer. Runs on the game thread with no frame in flight, before the frame is
+// rendered, for renderer work that talks to the window (like resizing the swap chain).
+ogb_instance void
+gfx_sync_window();
+
+// #Global
+ogb_instance Gfx_Render_Thread gfx_render_thread;
+// How many bytes of draw_frame.cbuffer the renderer reads, set by shader_recompile_with_extension
+ogb_instance u64 gfx_frame_cbuffer_size;
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Gfx_Render_Thread gfx_render_thread = ZERO(Gfx_Render_Thread);
+u64 gfx_frame_cbuffer_size = 0;
+
+void _gfx_render_thread_proc(Thread *t) {
+	_frame_stat_cycles = gfx_render_thread.stat_cycles;
+
+	mutex_acquire_or_wait(&gfx_render_thread.mutex);
+	while (true) {
+		while (!gfx_render_thread.busy && !gfx_render_thread.stop) {
+			condition_variable_wait(&gfx_render_thread.frame_ready, &gfx_render_thread.mutex);
+		}
+		if (!gfx_render_thread.busy) break;
+		mutex_release(&gfx_render_thread.mutex);
+
+		gfx_render_frame(&gfx_render_thread.render_frame);
+		reset_temporary_storage();
+
+		mutex_acquire_or_wait(&gfx_render_thread.mutex);
+		gfx_render_thread.busy = false;
+		gfx_render_thread.frames_rendered += 1;
+		condition_variable_broadcast(&gfx_render_thread.frame_done);
+	}
+	mutex_release(&gfx_render_thread.mutex);
+}
+
+void gfx_render_thread_start() {
+	assert(!gfx_render_thread.running, "Render thread is already running");
+
+	Allocator heap = get_heap_allocator();
+
+	gfx_render_thread.frame = alloc(heap, sizeof(Draw_Frame));
+	mutex_init(&gfx_render_thread.mutex);
+	condition_variable_init(&gfx_render_thread.frame_ready);
+	condition_variable_init(&gfx_render_thread.frame_done);
+	gfx_render_thread.busy = false;
+	gfx_render_thread.stop = false;
+	gfx_render_thread.frames_rendered = 0;
+	memset(gfx_render_thread.stat_cycles, 0, sizeof(gfx_render_thread.stat_cycles));
+
+	os_thread_init(&gfx_render_thread.thread, _gfx_render_thread_proc);
+	os_thread_start(&gfx_render_thread.thread);
+
+	gfx_render_thread.running = true;
+
+	log_verbose("Render thread started");
+}
+
+void gfx_render_thread_wait() {
+	if (!gfx_render_thread.running) return;
+
+	mutex_acquire_or_wait(&gfx_render_thread.mutex);
+	while (gfx_render_thread.busy) {
+		condition_variable_wait(&gfx_render_thread.frame_done, &gfx_render_thread.mutex);
+	}
+	mutex_release(&gfx_render_thread.mutex);
+
+	// The render thread is idle, so its stats are ours to take
+	for (u64 i = 0; i < FRAME_STAT_COUNT; i++) {
+		frame_stats.current_cycles[i] += gfx_render_thread.stat_cycles[i];
+		gfx_render_thread.stat_cycles[i] = 0;
+	}
+}
+
+void gfx_render_thread_stop() {
+	assert(gfx_render_thread.running, "Render thread is not running");
+
+	gfx_render_thread_wait();
+
+	mutex_acquire_or_wait(&gfx_render_thread.mutex);
+	gfx_render_thread.stop = true;
+	condition_variable_signal(&gfx_render_thread.frame_ready);
+	mutex_release(&gfx_render_thread.mutex);
+
+	os_thread_destroy(&gfx_render_thread.thread);
+
+	Allocator heap = get_heap_allocator();
+	dealloc(heap, gfx_render_thread.frame);
+	if (gfx_render_thread.quads)   dealloc(heap, gfx_render_thread.quads);
+	if (gfx_render_thread.scissor_rects) dealloc(heap, gfx_render_thread.scissor_rects);
+	if (gfx_render_thread.cbuffer) dealloc(heap, gfx_render_thread.cbuffer);
+	mutex_destroy(&gfx_render_thread.mutex);
+
+	gfx_render_thread = ZERO(Gfx_Render_Thread);
+
+	log_verbose("Render thread stopped");
+}
+
+// Gives draw_frame to the render thread, which must be idle
+void _gfx_render_thread_hand_off() {
+	Gfx_Render_Thread *rt = &gfx_render_thread;
+
+	// #Speed ~100kb, most of it stacks that are empty by now. Same as the reset after.
+	memcpy(rt->frame, &draw_frame, sizeof(Draw_Frame));
+
+	// Quads and scissors are swapped, not copied. The game draws into the buffer from two frames ago.
+	Draw_Quad *quads = rt->quads;
+	u64 quad_capacity = rt->quad_capacity;
+	rt->quads = quad_buffer;
+	rt->quad_capacity = allocated_quads;
+	quad_buffer = quads;
+	allocated_quads = quad_capacity;
+
+	Vector4 *scissor_rects = rt->scissor_rects;
+	u64 scissor_capacity = rt->scissor_capacity;
+	rt->scissor_rects = scissor_buffer;
+	rt->scissor_capacity = allocated_scissors;
+	scissor_buffer = scissor_rects;
+	allocated_scissors = scissor_capacity;
+
+	if (draw_frame.cbuffer && gfx_frame_cbuffer_size) {
+		if (rt->cbuffer_capacity < gfx_frame_cbuffer_size) {
+			if (rt->cbuffer) dealloc(get_heap_allocator(), rt->cbuffer);
+			rt->cbuffer = alloc(get_heap_allocator(), gfx_frame_cbuffer_size);
+			rt->cbuffer_capacity = gfx_frame_cbuffer_size;
+		}
+		memcpy(rt->cbuffer, draw_frame.cbuffer, gfx_frame_cbuffer_size);
+		rt->frame->cbuffer = rt->cbuffer;
+	}
+
+	rt->render_frame.frame = rt->frame;
+	rt->render_frame.quads = rt->quads;
+	rt->render_frame.quad_capacity = rt->quad_capacity;
+	rt->render_frame.scissor_rects = rt->scissor_rects;
+	rt->render_frame.cbuffer = rt->frame->cbuffer;
+	rt->render_frame.viewport_width = window.pixel_width;
+	rt->render_frame.viewport_height = window.pixel_height;
+	rt->render_frame.clear_color = window.clear_color;
+	rt->render_frame.enable_vsync = window.enable_vsync;
+
+	mutex_acquire_or_wait(&rt->mutex);
+	rt->busy = true;
+	condition_variable_signal(&rt->frame_ready);
+	mutex_release(&rt->mutex);
+}
+
+void gfx_update() {
+	if (window.should_close) return;
+
+	if (gfx_render_thread.running) {
+		// Backpressure, only one frame in flight
+		tm_scope("Wait for render thread") {
+			gfx_render_thread_wait();
+		}
+		gfx_sync_window();
+		_gfx_render_thread_hand_off();
+	} else {
+		gfx_sync_window();
+		Gfx_Render_Frame frame = ZERO(Gfx_Render_Frame);
+		frame.frame = &draw_frame;
+		frame.quads = quad_buffer;
+		frame.quad_capacity = allocated_quads;
+		frame.scissor_rects = scissor_buffer;
+		frame.cbuffer = draw_frame.cbuffer;
+		frame.viewport_width = window.pixel_width;
+		frame.viewport_height = window.pixel_height;
+		frame.clear_color = window.clear_color;
+		frame.enable_vsync = window.enable_vsync;
+		gfx_render_frame(&frame);
+	}
+
+	reset_draw_frame(&draw_frame);
+
+	tm_counter("Heap bytes live", heap_bytes_allocated);
+	tm_counter("Temporary storage high water", get_and_reset_temporary_storage_high_water());
+
+	frame_stats_end_frame();
+
+	tm_frame_end();
+	tm_frame_begin();
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -0,0 +1,783 @@
+/*
+
+	Work-stealing job system.
+
+	A fixed pool of workers, one per logical processor by default. The thread calling
+	job_system_init is worker 0 and the rest are spawned threads. If the pool is started by
+	running a job instead, every worker is a spawned thread. Every worker owns a Chase-Lev deque: the owner pushes and
+	pops at the bottom (LIFO, cache hot) and idle workers steal from the top (FIFO, oldest and
+	usually biggest work first). Threads outside of the pool push into a shared Mpmc_Queue.
+
+	Example Usage:
+
+	void decode_thing(void *data) {
+		Thing *thing = (Thing*)data;
+		// ...
+	}
+
+	Job_Counter counter = {0};
+	for (u64 i = 0; i < thing_count; i++) {
+		job_run(decode_thing, &things[i], &counter);
+	}
+
+	// Runs pending jobs on this thread while waiting, so it's fine to do this inside of a job.
+	job_wait(&counter);
+
+	// Or batched (counter is incremented once for all jobs)
+	Job jobs[64];
+	// ... fill in jobs[i].proc and jobs[i].data
+	jobs_run(jobs, 64, &counter);
+	job_wait(&counter);
+
+	Notes:
+		- The job system is started with the default worker count the first time a job is run.
+		  Any thread can do that, it's safe if several do at once. The pool is then all spawned
+		  threads and the calling thread stays outside of it. Call job_system_init() yourself to
+		  pick the number of workers and make the calling thread worker 0.
+		- Every worker has its own temporary storage. talloc() in a job is fine, but the memory
+		  is given back when the job returns so don't hand it back to the spawning thread.
+		- Dependencies are expressed with counters: a job can job_wait() on the counter of the
+		  jobs it depends on, or spawn the dependent jobs itself when it's done.
+		- If a queue is full the job is run immediately on the calling thread.
+
+	Data-parallel loops:
+
+	void update_entities(u64 first, u64 end, void *userdata) {
+		World *world = (World*)userdata;
+		for (u64 i = first; i < end; i++) {
+			// ...
+		}
+	}
+	// grain is the smallest number of items handed to a worker at a time (0 = pick for me).
+	// If there are fewer items than that, or only one worker, it just runs on this thread.
+	parallel_for(0, MAX_ENTITY_COUNT, 0, update_entities, world);
+
+	void sum_health(u64 first, u64 end, void *partial, void *userdata) {
+		float32 *sum = (float32*)partial;
+		for (u64 i = first; i < end; i++) *sum += world->entities[i].health;
+	}
+	void combine_sum(void *result, void *partial, void *userdata) {
+		*(float32*)result += *(float32*)partial;
+	}
+	float32 zero = 0;
+	float32 total_health = 0;
+	parallel_reduce(0, MAX_ENTITY_COUNT, 0, sum_health, combine_sum, &zero, &total_health, sizeof(float32), 0);
+
+	Items are handed out in chunks of 'grain' from a shared cursor as workers become free,
+	so it balances itself when some items are much more expensive than others.
+
+	Async tasks:
+
+	Long running work that needs to wait for other jobs (loading a level, building an atlas)
+	can be written as a sequential async task instead of blocking a thread. A task is a
+	stackless coroutine: the proc returns when it waits and is called again later (on any
+	worker) from where it left off.
+
+	typedef struct Load_Level {
+		Async_Task task;
+		string path;
+		string file;
+		Job_Counter decode_counter;
+		// ...
+	} Load_Level;
+	bool load_level(Async_Task *task) {
+		Load_Level *l = (Load_Level*)task->data;
+		async_begin(task);
+
+		os_read_entire_file(l->path, &l->file, get_heap_allocator());
+
+		// Worker is free to do other things until these are done
+		jobs_run(decode_jobs, decode_count, &l->decode_counter);
+		async_await(task, &l->decode_counter);
+
+		// ...
+
+		async_end(task);
+	}
+
+	Load_Level *l = ...;
+	Job_Counter level_loaded = {0};
+	async_run(&l->task, load_level, l, &level_loaded);
+
+	// Each frame
+	if (job_counter_is_done(&level_loaded)) { ... }
+
+	Notes on async tasks:
+		- Locals don't survive async_await/async_yield, keep state in the task data.
+		- Same goes for talloc() memory.
+		- Don't use async_await/async_yield inside of a switch in the proc, or twice on one line.
+		- The Async_Task and its data must stay alive until the task is done.
+		- If the main thread is the only worker (single core), tasks only make progress while
+		  it's in job_wait() or job_help().
+
+*/
+
+#ifndef JOB_QUEUE_CAPACITY
+	#define JOB_QUEUE_CAPACITY 4096 // Must be power of 2
+#endif
+#ifndef ASYNC_MAX_WAITING_TASKS
+	#define ASYNC_MAX_WAITING_TASKS 1024
+#endif
+// How often sleeping workers check if a waiting async task can continue
+#define ASYNC_POLL_INTERVAL_MS 1
+
+#define JOB_SYSTEM_MAX_WORKERS 64
+
+typedef void(*Job_Proc)(void *data);
+
+typedef struct Job_Counter {
+	volatile u64 value;
+} Job_Counter;
+
+typedef struct Job {
+	Job_Proc proc;
+	void *data;
+	Job_Counter *counter; // Can be null
+} Job;
+
+typedef struct Async_Task Async_Task;
+// Return true when done. Use async_begin/async_end & friends to get a resumable proc.
+typedef bool(*Async_Proc)(Async_Task *task);
+
+typedef struct Async_Task {
+	Async_Proc proc;
+	void *data;
+	Job_Counter *counter; // Can be null, decremented when the task is done
+	u64 resume_point;
+	Job_Counter *waiting_on; // Null when it just yielded
+} Async_Task;
+
+#define async_begin(task) switch ((task)->resume_point) { case 0:
+#define async_end(task) } return true
+
+// Continue some time later, lets other jobs & tasks run
+#define async_yield(task) do { \
+	(task)->waiting_on = 0; \
+	(task)->resume_point = __LINE__; \
+	return false; \
+	case __LINE__:; \
+} while (0)
+
+// Continue once the counter is done
+#define async_await(task, counter) do { \
+	(task)->waiting_on = (counter); \
+	(task)->resume_point = __LINE__; \
+	if (!job_counter_is_done(counter)) return false; \
+	case __LINE__:; \
+} while (0)
+
+// Chase-Lev work-stealing deque (fixed capacity). Only the owning worker may push & pop.
+// Any thread may steal.
+typedef struct Job_Deque {
+	volatile s64 top;
+	u8 _pad0[64-sizeof(s64)]; // Thieves hammer 'top', keep it away from the owners 'bottom'
+	volatile s64 bottom;
+	u8 _pad1[64-sizeof(s64)];
+	Job jobs[JOB_QUEUE_CAPACITY];
+} Job_Deque;
+
+typedef struct Job_Worker {
+	Job_Deque deque;
+	Thread thread;
+	u64 index;
+	u64 random_state; // For picking steal victims
+} Job_Worker;
+
+typedef struct Job_System {
+	Job_Worker *workers;
+	u64 worker_count; // Including the thread that called job_system_init, if it was called
+	volatile bool running;
+	bool initted;
+	volatile u32 init_state; // JOB_SYSTEM_INIT_*, so only one thread can start the job system
+	bool started_by_running_a_job; // Then worker 0 is a spawned thread too
+
+	// Idle workers sleep on wake_sequence, which is bumped when jobs are pushed
+	volatile u32 wake_sequence;
+	volatile u32 sleeper_count;
+
+	// For threads which are not in the pool (audio thread etc)
+	Mpmc_Queue external_queue;
+
+	// Async tasks that are waiting to be resumed
+	Mpmc_Queue async_waiting;
+} Job_System;
+
+#define JOB_SYSTEM_INIT_NONE     0
+#define JOB_SYSTEM_INIT_STARTING 1
+#define JOB_SYSTEM_INIT_DONE     2
+
+// #Global
+ogb_instance Job_System job_system;
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Job_System job_system = {0};
+thread_local Job_Worker *job_worker_current = 0;
+#endif
+
+// worker_count is the number of threads executing jobs, including the calling thread.
+// Pass 0 to use one worker per logical processor.
+// The calling thread becomes worker 0 and needs to help out by calling job_wait().
+void ogb_instance
+job_system_init(u64 worker_count);
+
+// All jobs must be done before shutting down
+void ogb_instance
+job_system_shutdown();
+
+u64 ogb_instance
+job_system_get_worker_count();
+
+// Returns index of the calling thread in the worker pool, or -1 if it's not in the pool
+s64 ogb_instance
+job_get_current_worker_index();
+
+void ogb_instance
+job_run(Job_Proc proc, void *data, Job_Counter *counter);
+
+// Note: job.counter is overwritten with 'counter'
+void ogb_instance
+jobs_run(Job *jobs, u64 count, Job_Counter *counter);
+
+// Executes other jobs while waiting for counter to reach 0
+void ogb_instance
+job_wait(Job_Counter *counter);
+
+// Executes jobs & async tasks on the calling thread until there's nothing to do or max_seconds
+// has passed. For lending the main thread to background work at the end of a frame.
+void ogb_instance
+job_help(f64 max_seconds);
+
+bool ogb_instance
+job_counter_is_done(Job_Counter *counter);
+
+// Called with sub-ranges [first, end) of the full range
+typedef void(*Parallel_For_Proc)(u64 first, u64 end, void *userdata);
+// Accumulate [first, end) into 'partial'
+typedef void(*Parallel_Reduce_Proc)(u64 first, u64 end, void *partial, void *userdata);
+// Fold 'partial' into 'result'
+typedef void(*Parallel_Combine_Proc)(void *result, void *partial, void *userdata);
+
+// Returns once proc has been called for every item in [first, end)
+void ogb_instance
+parallel_for(u64 first, u64 end, u64 grain, Parallel_For_Proc proc, void *userdata);
+
+// Every participating thread accumulates into its own partial value which starts as a copy of
+// 'identity'. The partials are then combined into 'result' (which is not reset) on the calling
+// thread. Which items end up in which partial is not deterministic.
+void ogb_instance
+parallel_reduce(u64 first, u64 end, u64 grain, Parallel_Reduce_Proc proc, Parallel_Combine_Proc combine, void *identity, void *result, u64 value_size, void *userdata);
+
+// Schedules the task onto the job workers. counter is incremented now and decremented when
+// proc returns true.
+void ogb_instance
+async_run(Async_Task *task, Async_Proc proc, void *data, Job_Counter *counter);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+bool job_deque_push(Job_Deque *d, Job job) {
+	s64 b = d->bottom;
+	s64 t = (s64)atomic_load_64((volatile u64*)&d->top, MEMORY_ORDER_ACQUIRE);
+	if (b-t >= JOB_QUEUE_CAPACITY) return false;
+
+	d->jobs[b & (JOB_QUEUE_CAPACITY-1)] = job;
+	// Job must be written before thieves can see it
+	atomic_store_64((volatile u64*)&d->bottom, (u64)(b+1), MEMORY_ORDER_RELEASE);
+
+	return true;
+}
+bool job_deque_pop(Job_Deque *d, Job *job) {
+	s64 b = d->bottom-1;
+	// Thieves must see the new bottom before we read top
+	atomic_exchange_64((volatile u64*)&d->bottom, (u64)b);
+	s64 t = (s64)atomic_load_64((volatile u64*)&d->top, MEMORY_ORDER_ACQUIRE);
+
+	if (t > b) {
+		// Was empty
+		atomic_store_64((volatile u64*)&d->bottom, (u64)(b+1), MEMORY_ORDER_RELAXED);
+		return false;
+	}
+
+	*job = d->jobs[b & (JOB_QUEUE_CAPACITY-1)];
+
+	if (t == b) {
+		// Last job, we might be racing a thief for it
+		bool won = compare_and_swap_64((u64*)&d->top, t+1, t);
+		atomic_store_64((volatile u64*)&d->bottom, (u64)(b+1), MEMORY_ORDER_RELAXED);
+		return won;
+	}
+
+	return true;
+}
+bool job_deque_steal(Job_Deque *d, Job *job) {
+	s64 t = (s64)atomic_load_64((volatile u64*)&d->top,    MEMORY_ORDER_ACQUIRE);
+	s64 b = (s64)atomic_load_64((volatile u64*)&d->bottom, MEMORY_ORDER_ACQUIRE);
+
+	if (t >= b) return false;
+
+	// The slot might be overwritten while we copy it, but then top has moved and the
+	// cas fails, so we never use a torn job.
+	Job j = d->jobs[t & (JOB_QUEUE_CAPACITY-1)];
+	if (!compare_and_swap_64((u64*)&d->top, t+1, t)) return false;
+
+	*job = j;
+	return true;
+}
+
+void _async_resume(void *data);
+
+// Takes one waiting task, if it can continue we get a job to resume it, otherwise it
+// goes back in line.
+bool _async_try_get_ready(Job *job) {
+	if (mpmc_queue_get_count(&job_system.async_waiting) == 0) return false;
+
+	Async_Task *task;
+	if (!mpmc_queue_pop(&job_system.async_waiting, &task)) return false;
+
+	if (task->waiting_on && !job_counter_is_done(task->waiting_on)) {
+		if (mpmc_queue_push(&job_system.async_waiting, &task)) return false;
+		// Someone filled the queue up in between, _async_resume will deal with it
+	}
+
+	job->proc = _async_resume;
+	job->data = task;
+	job->counter = 0;
+	return true;
+}
+
+// worker can be null if calling thread isn't in the pool
+bool _job_try_get(Job_Worker *worker, Job *job) {
+	if (worker && job_deque_pop(&worker->deque, job)) return true;
+
+	if (mpmc_queue_pop(&job_system.external_queue, job)) return true;
+
+	u64 n = job_system.worker_count;
+	if (n == 0) return false;
+
+	u64 start = 0;
+	if (worker) {
+		// xorshift
+		u64 x = worker->random_state;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		worker->random_state = x;
+		start = x % n;
+	}
+
+	for (u64 i = 0; i < n; i++) {
+		Job_Worker *victim = &job_system.workers[(start+i) % n];
+		if (victim == worker) continue;
+		if (job_deque_steal(&victim->deque, job)) return true;
+	}
+
+	return _async_try_get_ready(job);
+}
+
+bool _job_any_queued() {
+	if (mpmc_queue_get_count(&job_system.external_queue) > 0) return true;
+	for (u64 i = 0; i < job_system.worker_count; i++) {
+		Job_Deque *d = &job_system.workers[i].deque;
+		if (d->bottom > d->top) return true;
+	}
+	return false;
+}
+
+// Call after jobs were pushed
+void _job_wake_sleepers(u64 job_count) {
+	// The pushes must be visible before we check for sleepers, and sleepers register
+	// before they check the queues a last time, so either they see the jobs or we see them.
+	FULL_MEMORY_BARRIER;
+	if (atomic_load_32(&job_system.sleeper_count, MEMORY_ORDER_RELAXED) == 0) return;
+
+	atomic_fetch_add_32(&job_system.wake_sequence, 1);
+	if (job_count > 1) os_wake_all_on_address(&job_system.wake_sequence);
+	else               os_wake_one_on_address(&job_system.wake_sequence);
+}
+
+void _job_execute(Job *job) {
+	// Whatever the job allocates in temporary storage is given back when it returns.
+	// Restoring (rather than resetting) keeps the memory of a job that is waiting on this
+	// one further up the stack intact.
+	if (!temporary_storage_initted) temporary_storage_init();
+	void *temp_mark = temporary_storage_pointer;
+
+	job->proc(job->data);
+
+	temporary_storage_pointer = temp_mark;
+
+	if (job->counter) {
+		u64 previous = atomic_fetch_sub_64(&job->counter->value, 1);
+		// Async tasks could be waiting for this, make sure someone is awake to resume them
+		if (previous == 1 && mpmc_queue_get_count(&job_system.async_waiting) > 0) {
+			_job_wake_sleepers(1);
+		}
+	}
+}
+
+void _job_worker_sleep() {
+	atomic_fetch_add_32(&job_system.sleeper_count, 1);
+
+	u32 sequence = atomic_load_32(&job_system.wake_sequence, MEMORY_ORDER_ACQUIRE);
+	if (job_system.running && !_job_any_queued()) {
+		// Waiting tasks can become ready without anyone pushing (async_yield), so poll for those
+		u32 timeout = mpmc_queue_get_count(&job_system.async_waiting) > 0 ? ASYNC_POLL_INTERVAL_MS : OS_WAIT_INFINITE;
+		os_wait_on_address(&job_system.wake_sequence, sequence, timeout);
+	}
+
+	atomic_fetch_sub_32(&job_system.sleeper_count, 1);
+}
+
+void _job_worker_proc(Thread *t) {
+	Job_Worker *worker = (Job_Worker*)t->data;
+	job_worker_current = worker;
+
+	u64 idle_count = 0;
+	while (job_system.running) {
+		Job job;
+		if (_job_try_get(worker, &job)) {
+			_job_execute(&job);
+			idle_count = 0;
+			continue;
+		}
+
+		// Spin for a bit since there's usually more work right around the corner in a frame,
+		// then sleep until someone pushes jobs.
+		idle_count += 1;
+		if (idle_count < 64)       cpu_pause();
+		else if (idle_count < 128) os_yield_thread();
+		else                       _job_worker_sleep();
+	}
+
+	job_worker_current = 0;
+}
+
+// init_state must already be JOB_SYSTEM_INIT_STARTING
+void _job_system_start(u64 worker_count, bool calling_thread_is_worker) {
+	if (worker_count == 0) worker_count = os.number_of_logical_processors;
+	if (worker_count == 0) worker_count = 1;
+	worker_count = min(worker_count, JOB_SYSTEM_MAX_WORKERS);
+
+	job_system.worker_count = worker_count;
+	job_system.workers = (Job_Worker*)alloc(get_heap_allocator(), sizeof(Job_Worker)*worker_count);
+	memset(job_system.workers, 0, sizeof(Job_Worker)*worker_count);
+
+	mpmc_queue_init(&job_system.external_queue, sizeof(Job), JOB_QUEUE_CAPACITY, get_heap_allocator());
+	mpmc_queue_init(&job_system.async_waiting, sizeof(Async_Task*), ASYNC_MAX_WAITING_TASKS, get_heap_allocator());
+
+	job_system.running = true;
+	job_system.initted = true;
+	MEMORY_BARRIER;
+
+	for (u64 i = 0; i < worker_count; i++) {
+		Job_Worker *worker = &job_system.workers[i];
+		worker->index = i;
+		worker->random_state = 0x9E3779B97F4A7C15ull * (i+1);
+
+		if (i == 0 && calling_thread_is_worker) continue;
+
+		os_thread_init(&worker->thread, _job_worker_proc);
+		worker->thread.data = worker;
+		os_thread_start(&worker->thread);
+	}
+
+	job_system.started_by_running_a_job = !calling_thread_is_worker;
+	if (calling_thread_is_worker) job_worker_current = &job_system.workers[0];
+
+	atomic_store_32(&job_system.init_state, JOB_SYSTEM_INIT_DONE, MEMORY_ORDER_RELEASE);
+
+	log_verbose("Job system started with %llu workers", worker_count);
+}
+
+void job_system_init(u64 worker_count) {
+	bool first = compare_and_swap_32((u32*)&job_system.init_state, JOB_SYSTEM_INIT_STARTING, JOB_SYSTEM_INIT_NONE);
+	assert(first, "Job system is already initialized");
+	_job_system_start(worker_count, true);
+}
+
+// The lazy start when a job is run before job_system_init(). If several threads get here at
+// once, one of them starts the job system and the others wait for it. None of them joins the
+// pool, they push to the shared queue and help out from there like any outside thread.
+void _job_system_init_once() {
+	if (atomic_load_32(&job_system.init_state, MEMORY_ORDER_ACQUIRE) == JOB_SYSTEM_INIT_DONE) return;
+
+	if (compare_and_swap_32((u32*)&job_system.init_state, JOB_SYSTEM_INIT_STARTING, JOB_SYSTEM_INIT_NONE)) {
+		_job_system_start(0, false);
+		return;
+	}
+	while (atomic_load_32(&job_system.init_state, MEMORY_ORDER_ACQUIRE) != JOB_SYSTEM_INIT_DONE) {
+		os_yield_thread();
+	}
+}
+
+void job_system_shutdown() {
+	assert(job_system.initted, "Job system is not initialized");
+	Job_Worker *owner = job_system.started_by_running_a_job ? 0 : &job_system.workers[0];
+	assert(job_worker_current == owner, "Job system must be shut down from the thread that initialized it, or from outside of the pool if it was started by running a job");
+
+	job_system.running = false;
+	atomic_fetch_add_32(&job_system.wake_sequence, 1);
+	os_wake_all_on_address(&job_system.wake_sequence);
+
+	u64 first_spawned = job_system.started_by_running_a_job ? 0 : 1;
+	for (u64 i = first_spawned; i < job_system.worker_count; i++) {
+		os_thread_destroy(&job_system.workers[i].thread);
+	}
+
+	for (u64 i = 0; i < job_system.worker_count; i++) {
+		Job_Deque *d = &job_system.workers[i].deque;
+		assert(d->bottom == d->top, "Job system was shut down with jobs still in queue");
+	}
+	assert(mpmc_queue_get_count(&job_system.external_queue) == 0, "Job system was shut down with jobs still in queue");
+
+	assert(mpmc_queue_get_count(&job_system.async_waiting) == 0, "Job system was shut down with async tasks still running");
+
+	mpmc_queue_deinit(&job_system.external_queue);
+	mpmc_queue_deinit(&job_system.async_waiting);
+	dealloc(get_heap_allocator(), job_system.workers);
+
+	job_worker_current = 0;
+	memset(&job_system, 0, sizeof(job_system));
+}
+
+u64 job_system_get_worker_count() {
+	if (!job_system.initted) return 0;
+	return job_system.worker_count;
+}
+
+s64 job_get_current_worker_index() {
+	if (!job_worker_current) return -1;
+	return (s64)job_worker_current->index;
+}
+
+void jobs_run(Job *jobs, u64 count, Job_Counter *counter) {
+	_job_system_init_once();
+
+	if (counter) atomic_fetch_add_64(&counter->value, count);
+
+	Job_Worker *worker = job_worker_current;
+
+	if (!worker) {
+		// Not in the pool, push to the shared queue in batches so we only touch its
+		// indices once per batch.
+		Job batch[64];
+		for (u64 first = 0; first < count; first += 64) {
+			u64 batch_count = min(count-first, 64);
+			for (u64 i = 0; i < batch_count; i++) {
+				batch[i] = jobs[first+i];
+				batch[i].counter = counter;
+			}
+			u64 pushed = mpmc_queue_push_many(&job_system.external_queue, batch, batch_count);
+			if (pushed > 0) _job_wake_sleepers(pushed);
+			// Queue is full, just do the rest now
+			for (u64 i = pushed; i < batch_count; i++) _job_execute(&batch[i]);
+		}
+		return;
+	}
+
+	u64 pushed_count = 0;
+	for (u64 i = 0; i < count; i++) {
+		Job job = jobs[i];
+		job.counter = counter;
+
+		if (job_deque_push(&worker->deque, job)) {
+			pushed_count += 1;
+		} else {
+			// Queue is full, just do it now. Get the others going on the queue first.
+			if (pushed_count > 0) _job_wake_sleepers(pushed_count);
+			pushed_count = 0;
+			_job_execute(&job);
+		}
+	}
+
+	if (pushed_count > 0) _job_wake_sleepers(pushed_count);
+}
+void job_run(Job_Proc proc, void *data, Job_Counter *counter) {
+	Job job;
+	job.proc = proc;
+	job.data = data;
+	job.counter = counter;
+	jobs_run(&job, 1, counter);
+}
+
+bool job_counter_is_done(Job_Counter *counter) {
+	// Acquire so everything the jobs wrote is visible once we see 0
+	return atomic_load_64(&counter->value, MEMORY_ORDER_ACQUIRE) == 0;
+}
+
+void job_wait(Job_Counter *counter) {
+	u64 idle_count = 0;
+	while (!job_counter_is_done(counter)) {
+		Job job;
+		if (job_system.initted && _job_try_get(job_worker_current, &job)) {
+			_job_execute(&job);
+			idle_count = 0;
+			continue;
+		}
+
+		// Someone else has the remaining jobs, it should be a short wait
+		idle_count += 1;
+		if (idle_count >= 64) os_yield_thread();
+		else                  cpu_pause();
+	}
+}
+
+void job_help(f64 max_seconds) {
+	if (!job_system.initted) return;
+
+	f64 end_time = os_get_current_time_in_seconds() + max_seconds;
+	do {
+		Job job;
+		if (!_job_try_get(job_worker_current, &job)) break;
+		_job_execute(&job);
+	} while (os_get_current_time_in_seconds() < end_time);
+}
+
+#define PARALLEL_CHUNKS_PER_WORKER 16
+#define PARALLEL_PARTIAL_ALIGNMENT 64 // Cache line, so partials don't false share
+
+typedef struct Parallel_Loop {
+	volatile u64 cursor;
+	u64 end;
+	u64 grain;
+	volatile u64 next_participant;
+
+	Parallel_For_Proc for_proc;
+	Parallel_Reduce_Proc reduce_proc;
+	void *userdata;
+
+	u8 *partials; // value_stride per participant
+	u64 value_stride;
+} Parallel_Loop;
+
+u64 _parallel_pick_grain(u64 count, u64 grain) {
+	if (grain != 0) return grain;
+	grain = count / (job_system.worker_count*PARALLEL_CHUNKS_PER_WORKER);
+	return max(grain, 1);
+}
+
+void _parallel_loop_participate(void *data) {
+	Parallel_Loop *loop = (Parallel_Loop*)data;
+
+	u64 participant = atomic_fetch_add_64(&loop->next_participant, 1);
+	void *partial = loop->partials ? loop->partials+participant*loop->value_stride : 0;
+
+	while (true) {
+		u64 chunk_first = atomic_fetch_add_64(&loop->cursor, loop->grain);
+		u64 chunk_end = chunk_first+loop->grain;
+		if (chunk_first >= loop->end) break;
+		chunk_end = min(chunk_end, loop->end);
+
+		if (loop->for_proc) loop->for_proc(chunk_first, chunk_end, loop->userdata);
+		else                loop->reduce_proc(chunk_first, chunk_end, partial, loop->userdata);
+	}
+}
+
+void _parallel_loop_run(Parallel_Loop *loop, u64 participant_count) {
+	// The calling thread is one participant, the rest are jobs that might get stolen.
+	Job jobs[JOB_SYSTEM_MAX_WORKERS];
+	for (u64 i = 0; i < participant_count-1; i++) {
+		jobs[i].proc = _parallel_loop_participate;
+		jobs[i].data = loop;
+	}
+
+	Job_Counter counter = {0};
+	jobs_run(jobs, participant_count-1, &counter);
+
+	_parallel_loop_participate(loop);
+
+	job_wait(&counter);
+}
+
+void parallel_for(u64 first, u64 end, u64 grain, Parallel_For_Proc proc, void *userdata) {
+	if (end <= first) return;
+	_job_system_init_once();
+
+	u64 count = end-first;
+	grain = _parallel_pick_grain(count, grain);
+
+	if (count <= grain || job_system.worker_count <= 1) {
+		proc(first, end, userdata);
+		return;
+	}
+
+	Parallel_Loop loop = {0};
+	loop.cursor = first;
+	loop.end = end;
+	loop.grain = grain;
+	loop.for_proc = proc;
+	loop.userdata = userdata;
+
+	u64 chunk_count = (count+grain-1)/grain;
+	_parallel_loop_run(&loop, min(chunk_count, job_system.worker_count));
+}
+
+void parallel_reduce(u64 first, u64 end, u64 grain, Parallel_Reduce_Proc proc, Parallel_Combine_Proc combine, void *identity, void *result, u64 value_size, void *userdata) {
+	if (end <= first) return;
+	_job_system_init_once();
+
+	u64 count = end-first;
+	grain = _parallel_pick_grain(count, grain);
+
+	u64 participant_count = min((count+grain-1)/grain, job_system.worker_count);
+	u64 stride = (value_size+PARALLEL_PARTIAL_ALIGNMENT-1) & ~(PARALLEL_PARTIAL_ALIGNMENT-1ull);
+
+	// Overallocate so we can align the first partial
+	u8 *partials = (u8*)talloc(stride*participant_count+PARALLEL_PARTIAL_ALIGNMENT);
+	partials = (u8*)(((u64)partials+PARALLEL_PARTIAL_ALIGNMENT-1) & ~(PARALLEL_PARTIAL_ALIGNMENT-1ull));
+	for (u64 i = 0; i < participant_count; i++) {
+		memcpy(partials+i*stride, identity, value_size);
+	}
+
+	if (participant_count <= 1) {
+		proc(first, end, partials, userdata);
+	} else {
+		Parallel_Loop loop = {0};
+		loop.cursor = first;
+		loop.end = end;
+		loop.grain = grain;
+		loop.reduce_proc = proc;
+		loop.userdata = userdata;
+		loop.partials = partials;
+		loop.value_stride = stride;
+
+		_parallel_loop_run(&loop, participant_count);
+	}
+
+	for (u64 i = 0; i < participant_count; i++) {
+		combine(result, partials+i*stride, userdata);
+	}
+}
+
+void _async_resume(void *data) {
+	Async_Task *task = (Async_Task*)data;
+
+	// Resuming would skip past the async_await
+	bool ready = !task->waiting_on || job_counter_is_done(task->waiting_on);
+
+	if (ready && task->proc(task)) {
+		if (task->counter) atomic_fetch_sub_64(&task->counter->value, 1);
+		return;
+	}
+
+	// Not done, wait in line to be resumed
+	while (!mpmc_queue_push(&job_system.async_waiting, &task)) {
+		// Too many waiting tasks, help out until there's room
+		Job job;
+		if (_job_try_get(job_worker_current, &job)) _job_execute(&job);
+		else os_yield_thread();
+	}
+	_job_wake_sleepers(1);
+}
+
+void async_run(Async_Task *task, Async_Proc proc, void *data, Job_Counter *counter) {
+	task->proc = proc;
+	task->data = data;
+	task->counter = counter;
+	task->resume_point = 0;
+	task->waiting_on = 0;
+
+	if (counter) atomic_fetch_add_64(&counter->value, 1);
+	job_run(_async_resume, task, 0);
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
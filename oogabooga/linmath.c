@@ -301,6 +301,29 @@ Matrix4 m4_mul(LMATH_ALIGN Matrix4 a, LMATH_ALIGN Matrix4 b) {
     return result;
 }
 
+// Only the x & y rows of a*b, the z & w rows are identity. That's all it takes to get x & y of
+// 2D points (z = 0) transformed by a*b, at half the cost of m4_mul.
+Matrix4 m4_mul_2d(LMATH_ALIGN Matrix4 a, LMATH_ALIGN Matrix4 b) {
+    Matrix4 result = m4_scalar(1.0);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            result.m[i][j] = a.m[i][0] * b.m[0][j] +
+                             a.m[i][1] * b.m[1][j] +
+                             a.m[i][2] * b.m[2][j] +
+                             a.m[i][3] * b.m[3][j];
+        }
+    }
+    return result;
+}
+
+// m*translation for a translation in x & y, without building and multiplying a matrix
+inline Matrix4 m4_translate_2d(Matrix4 m, Vector2 translation) {
+    for (int i = 0; i < 4; ++i) {
+        m.m[i][3] += m.m[i][0] * translation.x + m.m[i][1] * translation.y;
+    }
+    return m;
+}
+
 inline Matrix4 m4_translate(Matrix4 m, Vector3 translation) {
     Matrix4 translation_matrix = m4_make_translation(translation);
     return m4_mul(m, translation_matrix);
@@ -99,11 +99,13 @@ typedef alignat(16) struct Heap_Allocation_Metadata {
 ogb_instance Heap_Block *heap_head;
 ogb_instance bool heap_initted;
 ogb_instance Spinlock heap_lock;
+ogb_instance u64 heap_bytes_allocated; // Live bytes handed out by heap_alloc, excluding metadata
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 Heap_Block *heap_head;
 bool heap_initted = false;
-Spinlock heap_lock;
+alignat(CACHE_LINE_SIZE) Spinlock heap_lock;
+u64 heap_bytes_allocated = 0;
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
 	
 
@@ -385,6 +387,7 @@ void *heap_alloc(u64 size) {
 	Heap_Allocation_Metadata *meta = (Heap_Allocation_Metadata*)best_fit;
 	meta->size = size;
 	meta->block = best_fit_block;
+	heap_bytes_allocated += size;
 #if CONFIGURATION == DEBUG
 	meta->signature = HEAP_META_SIGNATURE;
 	meta->block->total_allocated += size;
@@ -419,6 +422,7 @@ void heap_dealloc(void *p) {
 	// Yoink meta data before we start overwriting it
 	Heap_Block *block = meta->block;
 	u64 size = meta->size;
+	heap_bytes_allocated -= size;
 	
 #if CONFIGURATION == DEBUG
 	memset(p, 0x69696969, size);
@@ -550,6 +554,7 @@ thread_local void * temporary_storage = 0;
 thread_local bool   temporary_storage_initted = false;
 thread_local void * temporary_storage_pointer = 0;
 thread_local bool   has_warned_temporary_storage_overflow = false;
+thread_local u64    temporary_storage_high_water = 0;
 thread_local Allocator temp_allocator;
 
 ogb_instance Allocator 
@@ -571,6 +576,10 @@ talloc(u64 size);
 ogb_instance void 
 reset_temporary_storage();
 
+// Most temporary storage used on this thread between resets since the last call
+ogb_instance u64 
+get_and_reset_temporary_storage_high_water();
+
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 void* temp_allocator_proc(u64 size, void *p, Allocator_Message message, void* data) {
@@ -624,12 +633,25 @@ void* talloc(u64 size) {
 	return p;
 }
 
+u64 _temporary_storage_used() {
+	return (u64)((u8*)temporary_storage_pointer - (u8*)temporary_storage);
+}
+
 void reset_temporary_storage() {
 	if (!temporary_storage_initted) temporary_storage_init();
 	
+	temporary_storage_high_water = max(temporary_storage_high_water, _temporary_storage_used());
 	temporary_storage_pointer = temporary_storage;
 	
 	has_warned_temporary_storage_overflow = true;
 }
 
+u64 get_and_reset_temporary_storage_high_water() {
+	if (!temporary_storage_initted) return 0;
+	
+	u64 high_water = max(temporary_storage_high_water, _temporary_storage_used());
+	temporary_storage_high_water = 0;
+	return high_water;
+}
+
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
\ No newline at end of file
@@ -86,6 +86,17 @@
 			
 				#define RUN_TESTS 1
 				
+		- RUN_BENCHMARKS
+			Run ooga booga benchmarks (benchmarks.c) before entry and write the results as json
+			to BENCHMARK_OUTPUT_PATH (defaults to "oogabooga_benchmarks.json").
+		
+			0: Disable
+			1: Enable
+			
+			Example:
+			
+				#define RUN_BENCHMARKS 1
+				
 		- ENABLE_PROFILING
 			Enable time profiling which will be dumped to google_trace.json.
 		
@@ -105,6 +116,8 @@
 		- OOGABOOGA_HEADLESS
             Run oogabooga in headless mode, i.e. no window, no graphics, no audio.
             Useful if you only need the oogabooga standard library for something like a game server.
+            Define GFX_RENDERER as GFX_RENDERER_NULL as well to keep the drawing api, which batches
+            quads but draws nothing (gfx_impl_null.c). Useful to test & benchmark drawing code.
             
             0: Disable
             1: Enable
@@ -112,6 +125,26 @@
             Example:
             
                 #define OOGABOOGA_HEADLESS 1
+                
+		- JOB_QUEUE_CAPACITY
+			Max number of queued jobs per worker thread in the job system (jobs.c).
+			If a queue is full, jobs are executed immediately on the thread that runs them.
+			Must be a power of 2. Defaults to 4096.
+			
+			Example:
+			
+				#define JOB_QUEUE_CAPACITY 16384
+				
+		- GFX_RENDER_THREAD
+			Render on a separate thread, so the next frame is built while the last one is
+			rendered (gfx_render_thread.c). Can also be started with gfx_render_thread_start().
+			
+			0: Disable (default)
+			1: Enable
+			
+			Example:
+			
+				#define GFX_RENDER_THREAD 1
 		
 
 */
@@ -267,6 +300,7 @@ typedef u8 bool;
 #define GFX_RENDERER_D3D11  0
 #define GFX_RENDERER_VULKAN 1
 #define GFX_RENDERER_METAL  2
+#define GFX_RENDERER_NULL   3 // Draws nothing, see gfx_impl_null.c
 #ifndef GFX_RENDERER
 // #Portability
 	#if TARGET_OS == WINDOWS
@@ -278,6 +312,14 @@ typedef u8 bool;
 	#endif
 #endif
 
+// Headless builds have no graphics unless they ask for the null renderer, which lets them
+// build & batch draw frames (for tests and benchmarks) without a window.
+#if !defined(OOGABOOGA_HEADLESS) || GFX_RENDERER == GFX_RENDERER_NULL
+	#define OOGABOOGA_HAS_GFX 1
+#else
+	#define OOGABOOGA_HAS_GFX 0
+#endif
+
 
 #include "string.c"
 #include "unicode.c"
@@ -305,24 +347,43 @@ typedef u8 bool;
 /////
 
 #include "concurrency.c"
+#include "queues.c"
 
 #include "profiling.c"
 #include "random.c"
 #include "color.c"
 #include "memory.c"
+#include "jobs.c"
+#include "sampling_profiler.c"
 #include "input.c"
 
-#ifndef OOGABOOGA_HEADLESS
+#if OOGABOOGA_HAS_GFX
 
     #include "gfx_interface.c"
 
+    #include "gfx_atlas.c"
+
+    #include "sprite_atlas.c"
+
     #include "font.c"
 
     #include "drawing.c"
 
+    #include "gfx_batch.c"
+
+    #include "static_batch.c"
+#endif
+
+#ifndef OOGABOOGA_HEADLESS
     #include "audio.c"
 #endif
 
+#include "frame_stats.c"
+
+#if OOGABOOGA_HAS_GFX
+    #include "gfx_render_thread.c"
+#endif
+
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 
     #if TARGET_OS == WINDOWS
@@ -335,10 +396,12 @@ typedef u8 bool;
     	#error "Current OS is not supported"
     #endif
 
-    #ifndef OOGABOOGA_HEADLESS
+    #if OOGABOOGA_HAS_GFX
         // #Portability
         #if GFX_RENDERER == GFX_RENDERER_D3D11
             #include "gfx_impl_d3d11.c"
+        #elif GFX_RENDERER == GFX_RENDERER_NULL
+            #include "gfx_impl_null.c"
         #elif GFX_RENDERER == GFX_RENDERER_VULKAN
             #error "We only have a D3D11 renderer at the moment"
         #elif GFX_RENDERER == GFX_RENDERER_METAL
@@ -351,6 +414,7 @@ typedef u8 bool;
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
 
 #include "tests.c"
+#include "benchmarks.c"
 
 #define malloc please_use_alloc_for_memory_allocations_instead_of_malloc
 #define free please_use_dealloc_for_memory_deallocations_instead_of_free
@@ -386,10 +450,14 @@ void oogabooga_init(u64 program_memory_size) {
 	heap_init();
 	temporary_storage_init();
 	log_info("Ooga booga version is %d.%02d.%03d", OGB_VERSION_MAJOR, OGB_VERSION_MINOR, OGB_VERSION_PATCH);
-#ifndef OOGABOOGA_HEADLESS
-	gfx_init();
-#else
+#ifdef OOGABOOGA_HEADLESS
     log_info("Headless mode on");
+#endif
+#if OOGABOOGA_HAS_GFX
+	gfx_init();
+	#if GFX_RENDER_THREAD
+	gfx_render_thread_start();
+	#endif
 #endif
 	log_verbose("CPU has sse1:   %cs", features.sse1 ? "true" : "false");
 	log_verbose("CPU has sse2:   %cs", features.sse2 ? "true" : "false");
@@ -400,6 +468,11 @@ void oogabooga_init(u64 program_memory_size) {
 	log_verbose("CPU has avx:    %cs", features.avx ? "true" : "false");
 	log_verbose("CPU has avx2:   %cs", features.avx2 ? "true" : "false");
 	log_verbose("CPU has avx512: %cs", features.avx512 ? "true" : "false");
+	log_verbose("CPU has invariant tsc: %cs", features.invariant_tsc ? "true" : "false");
+	log_verbose("CPU cycles per second: %llu", os.cycles_per_second);
+	if (!features.invariant_tsc) {
+		log_warning("CPU has no invariant tsc, profiler timings may be off if the clock speed changes");
+	}
 }
 #endif
 
@@ -427,6 +500,10 @@ int main(int argc, char **argv) {
 		oogabooga_run_tests();
 	#endif
 	
+	#if RUN_BENCHMARKS
+		oogabooga_run_benchmarks(STR(BENCHMARK_OUTPUT_PATH));
+	#endif
+	
 	int code = ENTRY_PROC(argc, argv);
 	
 #if ENABLE_PROFILING
@@ -259,6 +259,11 @@ void os_init(u64 program_memory_size) {
     GetSystemInfo(&si);
 	os.granularity = cast(u64)si.dwAllocationGranularity;
 	os.page_size = cast(u64)si.dwPageSize;
+	// dwNumberOfProcessors caps out at 64 (one processor group)
+	os.number_of_logical_processors = cast(u64)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+	if (os.number_of_logical_processors == 0) os.number_of_logical_processors = cast(u64)si.dwNumberOfProcessors;
+	
+	os.cycles_per_second = os_measure_cycles_per_second(0.01);
 	
 	os.static_memory_start = 0;
 	os.static_memory_end = 0;
@@ -534,6 +539,24 @@ void os_unlock_mutex(Mutex_Handle m) {
 	assert(result, "Unlock mutex 0x%x failed with error %d", m, GetLastError());
 }
 
+///
+// Wait on address (needs -lsynchronization, windows 8+)
+
+bool os_wait_on_address(volatile u32 *address, u32 expected, u32 timeout_ms) {
+	BOOL result = WaitOnAddress(address, &expected, sizeof(u32), timeout_ms);
+	if (!result) {
+		DWORD err = GetLastError();
+		assert(err == ERROR_TIMEOUT, "WaitOnAddress failed with error %d", err);
+		return false;
+	}
+	return true;
+}
+void os_wake_one_on_address(volatile u32 *address) {
+	WakeByAddressSingle((PVOID)address);
+}
+void os_wake_all_on_address(volatile u32 *address) {
+	WakeByAddressAll((PVOID)address);
+}
 
 void os_sleep(u32 ms) {
     Sleep(ms);
@@ -921,6 +944,46 @@ bool os_is_directory_s(string path) {
     return (attributes & FILE_ATTRIBUTE_DIRECTORY);
 }
 
+bool os_get_file_names_in_directory_s(string path, string **names, u64 *count, Allocator allocator) {
+	*names = 0;
+	*count = 0;
+	
+    u16 *search_path = temp_win32_fixed_utf8_to_null_terminated_wide(string_concat(path, STR("\\*"), get_temporary_allocator()));
+	assert(search_path, "Invalid path string");
+    if (search_path == 0) {
+        return false;
+    }
+    
+    WIN32_FIND_DATAW find_data;
+    HANDLE find = FindFirstFileW(search_path, &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    u64 capacity = 0;
+    do {
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        
+        if (*count >= capacity) {
+            u64 new_capacity = max(capacity*2, 32);
+            string *new_names = alloc(allocator, new_capacity*sizeof(string));
+            if (*names) {
+                memcpy(new_names, *names, *count*sizeof(string));
+                dealloc(allocator, *names);
+            }
+            *names = new_names;
+            capacity = new_capacity;
+        }
+        
+        string name = temp_win32_null_terminated_wide_to_fixed_utf8(find_data.cFileName);
+        (*names)[*count] = string_copy(name, allocator);
+        *count += 1;
+    } while (FindNextFileW(find, &find_data) != 0);
+    
+    FindClose(find);
+    return true;
+}
+
 bool os_is_path_absolute(string path) {
 	// #Incomplete #Portability not sure this is very robust.
 	
@@ -1144,6 +1207,152 @@ os_get_stack_trace(u64 *trace_count, Allocator allocator) {
 #endif // NOT DEBUG
 }
 
+// How much of the stack above Rsp is copied per capture. Frames further up are cut off.
+#define WIN32_CAPTURE_STACK_WINDOW KB(64)
+// Committed after the copy, so unwinding a frame that reaches past the window reads zeros
+// instead of faulting. As big as a default thread stack, no frame can be bigger.
+#define WIN32_CAPTURE_STACK_SLACK MB(1)
+
+// Kept by the capturing thread between captures, sampling asks for the same thread over and over
+thread_local u64 win32_captured_thread_id = 0;
+thread_local HANDLE win32_captured_thread = 0;
+thread_local u8 *win32_captured_stack = 0;
+
+#if _M_X64
+// Moves registers that point into the copied part of the stack into the copy
+void win32_rebase_stack_registers(CONTEXT *context, u64 stack_low, u64 stack_high, u64 copy) {
+	DWORD64 *registers[] = {
+		&context->Rsp, &context->Rbp, &context->Rbx, &context->Rsi, &context->Rdi,
+		&context->R12, &context->R13, &context->R14, &context->R15,
+	};
+	for (u64 i = 0; i < sizeof(registers)/sizeof(registers[0]); i++) {
+		if (*registers[i] >= stack_low && *registers[i] < stack_high) {
+			*registers[i] = *registers[i] - stack_low + copy;
+		}
+	}
+}
+#endif
+
+u64
+os_capture_thread_stack(u64 thread_id, u64 *addresses, u64 max_count) {
+	assert(thread_id != GetCurrentThreadId(), "os_capture_thread_stack can't capture the calling thread");
+
+	if (win32_captured_thread_id != thread_id) {
+		if (win32_captured_thread) CloseHandle(win32_captured_thread);
+		win32_captured_thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, (DWORD)thread_id);
+		win32_captured_thread_id = win32_captured_thread ? thread_id : 0;
+		if (!win32_captured_thread) return 0;
+	}
+	HANDLE thread = win32_captured_thread;
+
+#if _M_X64
+	if (!win32_captured_stack) {
+		win32_captured_stack = VirtualAlloc(0, WIN32_CAPTURE_STACK_WINDOW+WIN32_CAPTURE_STACK_SLACK, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (!win32_captured_stack) return 0;
+	}
+
+	// #Sync
+	// The thread might be suspended holding any lock, like the heap's or the loader's (which
+	// RtlLookupFunctionEntry takes). So while it's suspended we only get its registers and copy
+	// the top of its stack, and unwind the copy after it's resumed.
+	if (SuspendThread(thread) == (DWORD)-1) return 0;
+
+	CONTEXT context;
+	memset(&context, 0, sizeof(context));
+	context.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
+	u64 copied = 0;
+	if (GetThreadContext(thread, &context)) {
+		// The committed pages from Rsp up are the used part of the stack
+		MEMORY_BASIC_INFORMATION region;
+		if (VirtualQuery((void*)context.Rsp, &region, sizeof(region))) {
+			u64 region_end = (u64)region.BaseAddress+region.RegionSize;
+			copied = min(region_end-context.Rsp, WIN32_CAPTURE_STACK_WINDOW);
+			memcpy(win32_captured_stack, (void*)context.Rsp, copied);
+		}
+	}
+
+	ResumeThread(thread);
+
+	if (copied == 0) return 0;
+	memset(win32_captured_stack+copied, 0, WIN32_CAPTURE_STACK_WINDOW-copied);
+
+	// We unwind with the .pdata tables rather than frame pointers because release builds
+	// are compiled with -fomit-frame-pointer.
+	u64 stack_low  = context.Rsp;
+	u64 stack_high = context.Rsp+copied;
+	u64 copy_low   = (u64)win32_captured_stack;
+	u64 copy_high  = copy_low+copied;
+	win32_rebase_stack_registers(&context, stack_low, stack_high, copy_low);
+
+	u64 count = 0;
+	while (count < max_count && context.Rip != 0) {
+		addresses[count] = context.Rip;
+		count += 1;
+
+		u64 rsp = context.Rsp;
+		if (rsp < copy_low || rsp+8 > copy_high) break;
+
+		DWORD64 image_base;
+		PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context.Rip, &image_base, 0);
+		if (function) {
+			void *handler_data;
+			DWORD64 establisher_frame;
+			RtlVirtualUnwind(UNW_FLAG_NHANDLER, image_base, context.Rip, function, &context, &handler_data, &establisher_frame, 0);
+		} else if (count == 1) {
+			// Leaf function without unwind info, return address is on top of the stack
+			context.Rip = *(DWORD64*)context.Rsp;
+			context.Rsp += 8;
+		} else {
+			// No unwind info further up means we can't trust anything above
+			break;
+		}
+
+		// Registers restored from the copy point at the real stack
+		win32_rebase_stack_registers(&context, stack_low, stack_high, copy_low);
+		if (context.Rsp <= rsp) break;
+	}
+
+	return count;
+#else
+	return 0;
+#endif
+}
+
+void
+os_capture_thread_stack_done() {
+	if (win32_captured_thread) CloseHandle(win32_captured_thread);
+	if (win32_captured_stack) VirtualFree(win32_captured_stack, 0, MEM_RELEASE);
+	win32_captured_thread_id = 0;
+	win32_captured_thread = 0;
+	win32_captured_stack = 0;
+}
+
+string
+os_get_symbol_name(u64 address, Allocator allocator) {
+#if CONFIGURATION == DEBUG
+	// Symbols were initialized in os_init
+	DWORD64 displacement = 0;
+	char buffer[sizeof(SYMBOL_INFO) + WIN32_MAX_SYMBOL_NAME_LENGTH * sizeof(TCHAR)];
+	PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
+	symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+	symbol->MaxNameLen = WIN32_MAX_SYMBOL_NAME_LENGTH;
+	if (SymFromAddr(GetCurrentProcess(), address, &displacement, symbol)) {
+		return string_copy((string){symbol->NameLen, (u8*)symbol->Name}, allocator);
+	}
+#endif
+
+	HMODULE module = 0;
+	if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)address, &module)) {
+		char path[MAX_PATH];
+		DWORD length = GetModuleFileNameA(module, path, MAX_PATH);
+		if (length > 0) {
+			string module_name = get_file_name_including_extension((string){length, (u8*)path});
+			return sprint(allocator, "%s+0x%llx", module_name, address-(u64)module);
+		}
+	}
+	return sprint(allocator, "0x%llx", address);
+}
+
 
 #ifndef OOGABOOGA_HEADLESS
 
@@ -1329,8 +1538,8 @@ win32_audio_poll_default_device_thread(Thread *t) {
 void 
 win32_audio_thread(Thread *t) {
 	
-	mutex_init(&audio_init_mutex);
-	
+    // audio_init_mutex is zero initialized, which is a valid unlocked Mutex. Initializing it
+    // here would race with the main thread using it.
     mutex_acquire_or_wait(&audio_init_mutex);
     win32_has_audio_thread_started = true;
     MEMORY_BARRIER;
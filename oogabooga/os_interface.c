@@ -41,6 +41,10 @@ typedef struct Os_Info {
 	u64 page_size;
 	u64 granularity;
 	
+	u64 number_of_logical_processors;
+	
+	u64 cycles_per_second; // rdtsc() frequency, measured in os_init
+	
 	Dynamic_Library_Handle crt;
 	
 	Crt_Vsnprintf_Proc crt_vsnprintf;
@@ -143,6 +147,24 @@ os_lock_mutex(Mutex_Handle m);
 void ogb_instance
 os_unlock_mutex(Mutex_Handle m);
 
+///
+// Wait on address (futex style)
+// This is what the sync primitives in concurrency.c sleep on.
+
+#define OS_WAIT_INFINITE 0xFFFFFFFF
+
+// Sleeps for as long as *address == expected, until woken by os_wake_*_on_address or timeout.
+// This can wake up spuriously, so always check the value again.
+// Returns false if the timeout was reached.
+bool ogb_instance
+os_wait_on_address(volatile u32 *address, u32 expected, u32 timeout_ms);
+
+void ogb_instance
+os_wake_one_on_address(volatile u32 *address);
+
+void ogb_instance
+os_wake_all_on_address(volatile u32 *address);
+
 ///
 // Threading utilities
 
@@ -166,6 +188,31 @@ DEPRECATED(u64 os_get_current_cycle_count(), "use rdtsc() instead");
 float64 ogb_instance
 os_get_current_time_in_seconds();
 
+// Times rdtsc() against the os clock for 'seconds'
+u64 os_measure_cycles_per_second(f64 seconds) {
+	f64 start_time = os_get_current_time_in_seconds();
+	u64 start_cycles = rdtsc();
+	f64 end_time;
+	do {
+		end_time = os_get_current_time_in_seconds();
+	} while (end_time-start_time < seconds);
+	u64 end_cycles = rdtsc();
+	return (u64)((f64)(end_cycles-start_cycles)/(end_time-start_time));
+}
+
+// For converting rdtsc() differences.
+// Only reliable if query_cpu_capabilities().invariant_tsc, otherwise the tsc rate may
+// change with power states.
+inline float64
+cycles_to_seconds(u64 cycles) {
+	if (os.cycles_per_second == 0) os.cycles_per_second = os_measure_cycles_per_second(0.01);
+	return (float64)cycles/(float64)os.cycles_per_second;
+}
+inline float64
+cycles_to_microseconds(u64 cycles) {
+	return cycles_to_seconds(cycles)*1000000.0;
+}
+
 ///
 ///
 // Dynamic Libraries
@@ -264,6 +311,11 @@ os_is_file_s(string path);
 bool ogb_instance
 os_is_directory_s(string path);
 
+// Names of the files directly in a directory (not sub directories, not recursive).
+// The names and the array are allocated with allocator.
+bool ogb_instance
+os_get_file_names_in_directory_s(string path, string **names, u64 *count, Allocator allocator);
+
 
 bool ogb_instance
 os_is_path_absolute(string path);
@@ -335,6 +387,12 @@ inline bool os_is_directory_f(const char *path) {return os_is_directory_s(STR(pa
                            default: os_is_directory_f \
                           )(__VA_ARGS__)
                           
+inline bool os_get_file_names_in_directory_f(const char *path, string **names, u64 *count, Allocator allocator) {return os_get_file_names_in_directory_s(STR(path), names, count, allocator);}
+#define os_get_file_names_in_directory(...) _Generic((FIRST_ARG(__VA_ARGS__)), \
+                           string:  os_get_file_names_in_directory_s, \
+                           default: os_get_file_names_in_directory_f \
+                          )(__VA_ARGS__)
+                          
                           
 
 void ogb_instance
@@ -391,6 +449,19 @@ os_get_stack_limit();
 ogb_instance string*
 os_get_stack_trace(u64 *trace_count, Allocator allocator);
 
+// Writes the return addresses of another threads call stack, innermost first, and returns how
+// many. The thread is suspended while the top of its stack is copied, which is then walked.
+// Can't be used on the calling thread.
+ogb_instance u64
+os_capture_thread_stack(u64 thread_id, u64 *addresses, u64 max_count);
+// Frees what os_capture_thread_stack keeps around for the calling thread
+ogb_instance void
+os_capture_thread_stack_done();
+
+// Function name at address, or "module+0x1234" when there are no symbols (release builds)
+ogb_instance string
+os_get_symbol_name(u64 address, Allocator allocator);
+
 void dump_stack_trace() {
 	u64 count;
 	string *strings = os_get_stack_trace(&count, get_temporary_allocator());
@@ -1,58 +1,662 @@
 
 
+/*
+	Every thread records its events in its own fixed size ring (Spsc_Queue) as raw binary:
+	name pointer, start & duration. No locks and no formatting when a scope ends. If a ring
+	fills up before it's flushed, the thread moves its events to a growing array next to the
+	ring and carries on. It never formats anything itself.
+
+	profiler_flush() drains the rings into the current output, which depends on the mode. A
+	background thread flushes every PROFILER_FLUSH_INTERVAL_MS, started when the first thread
+	records something.
+
+		PROFILER_MODE_JSON (default)
+			Events are converted to google trace json in memory, and dump_profile_result()
+			writes google_trace.json at exit. Memory grows with the number of events.
+
+		PROFILER_MODE_STREAM
+			profiler_start_streaming("trace.ogbtrace");
+			A background thread writes compact binary chunks to the file as the program runs,
+			so memory is bounded and everything up to the last flush survives a crash.
+
+		PROFILER_MODE_HISTORY
+			profiler_start_history(5.0);
+			A background thread keeps the last N seconds of chunks in memory. Whenever
+			something interesting happens, write them out with a snapshot:
+
+			if (is_key_just_pressed(KEY_F9)) profiler_snapshot(STR("slow_frame.ogbtrace"));
+
+	Binary traces are converted for chrome://tracing or ui.perfetto.dev with:
+		profiler_convert_trace_to_json(STR("trace.ogbtrace"), STR("trace.json"));
+
+	Besides scopes there are counter tracks and frame markers:
+		tm_counter("Enemies alive", enemy_count);
+		tm_frame_begin(); ... tm_frame_end();
+	gfx_update() already marks frames and records the engine counters (quads, draw calls,
+	heap bytes, temporary storage, texture slots), the audio thread records active voices.
+
+	Binary trace layout: Profile_Trace_Header followed by chunks. Each chunk is a
+	Profile_Chunk_Header, event_count Profile_Trace_Events and then name_bytes of names that
+	the events point into.
+*/
+
+#ifndef PROFILER_EVENTS_PER_THREAD
+	#define PROFILER_EVENTS_PER_THREAD 8192 // Must be power of 2
+#endif
+#ifndef PROFILER_FLUSH_INTERVAL_MS
+	#define PROFILER_FLUSH_INTERVAL_MS 100 // How often the background thread flushes
+#endif
+#ifndef PROFILER_MAX_HISTORY_BYTES
+	#define PROFILER_MAX_HISTORY_BYTES (64ull*1024*1024) // Cap for PROFILER_MODE_HISTORY
+#endif
+
+#define PROFILER_CHUNK_MAX_EVENTS 4096
+#define PROFILER_CHUNK_MAX_NAME_BYTES (32*1024) // Also caps name length, which is stored as u16
+#define PROFILER_CHUNK_NAME_SLOTS 512 // Must be power of 2
+#define PROFILER_TRACE_VERSION 2
+#define PROFILER_JSON_EVENT_FORMAT "{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f},"
+#define PROFILER_JSON_COUNTER_FORMAT "{\"cat\":\"counter\",\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"value\":%.3f}},"
+// Frames get their own track (tid 0) and a global instant marker where they begin
+#define PROFILER_JSON_FRAME_FORMAT "{\"cat\":\"frame\",\"dur\":%.3f,\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f},{\"cat\":\"frame\",\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f},"
+
+typedef enum Profiler_Mode {
+	PROFILER_MODE_JSON = 0,
+	PROFILER_MODE_STREAM,
+	PROFILER_MODE_HISTORY,
+} Profiler_Mode;
+
+typedef enum Profile_Event_Kind {
+	PROFILE_EVENT_SCOPE = 0,
+	PROFILE_EVENT_COUNTER,
+	PROFILE_EVENT_FRAME,
+} Profile_Event_Kind;
+
+typedef struct Profile_Event {
+	string name; // Not copied, must stay alive until flushed (string literals are fine)
+	u64 start;
+	union {
+		u64 duration; // PROFILE_EVENT_SCOPE & PROFILE_EVENT_FRAME
+		f64 value;    // PROFILE_EVENT_COUNTER
+	};
+	Profile_Event_Kind kind;
+} Profile_Event;
+
+// Pushed by the owning thread only. Popped under raw_lock, by whoever flushes or by the owning
+// thread when the ring is full.
+typedef struct Profile_Thread_Buffer {
+	Spsc_Queue events;
+	u64 thread_id;
+	struct Profile_Thread_Buffer *next;
+
+	// Events moved out of the ring but not flushed yet, in recording order
+	Spinlock raw_lock;
+	Profile_Event *raw;
+	u64 raw_count;
+	u64 raw_capacity;
+} Profile_Thread_Buffer;
+
+// On disk
+typedef struct Profile_Trace_Header {
+	u8 magic[8]; // "OGBTRACE"
+	u32 version;
+	u32 _reserved;
+	u64 cycles_per_second;
+} Profile_Trace_Header;
+typedef struct Profile_Chunk_Header {
+	u32 event_count;
+	u32 name_bytes;
+	u64 first_cycle;
+	u64 last_cycle;
+} Profile_Chunk_Header;
+typedef struct Profile_Trace_Event {
+	u64 start;
+	union {
+		u64 duration;
+		f64 value;
+	};
+	u64 thread_id;
+	u32 name_offset;
+	u16 name_length;
+	u16 kind; // Profile_Event_Kind
+} Profile_Trace_Event;
+
+// A chunk kept in memory for PROFILER_MODE_HISTORY
+typedef struct Profile_History_Chunk {
+	struct Profile_History_Chunk *next;
+	u64 size; // Bytes of chunk data following this struct
+	u64 last_cycle;
+} Profile_History_Chunk;
+
+// Chunk being built while flushing
+typedef struct Profile_Chunk_Builder {
+	Profile_Chunk_Header header;
+	Profile_Trace_Event events[PROFILER_CHUNK_MAX_EVENTS];
+	u8 names[PROFILER_CHUNK_MAX_NAME_BYTES];
+	// Names are deduplicated by pointer, most events use the same few literals
+	const u8 *name_keys[PROFILER_CHUNK_NAME_SLOTS];
+	u32 name_offsets[PROFILER_CHUNK_NAME_SLOTS];
+	u32 name_lengths[PROFILER_CHUNK_NAME_SLOTS];
+} Profile_Chunk_Builder;
+
+typedef struct Profiler_State {
+	Profiler_Mode mode;
+
+	File stream_file;
+
+	f64 history_seconds;
+	Profile_History_Chunk *history_first;
+	Profile_History_Chunk *history_last;
+	u64 history_bytes;
+
+	Profile_Chunk_Builder *chunk; // Only while streaming or keeping history
+
+	// Swapped with a thread's raw events while flushing, so it can record while we format
+	Profile_Event *flush_events;
+	u64 flush_events_capacity;
+
+	Thread flush_thread;
+	volatile bool flush_thread_started;
+} Profiler_State;
+
 // #Global
 ogb_instance String_Builder _profile_output;
 ogb_instance bool profiler_initted;
 ogb_instance Spinlock _profiler_lock;
+ogb_instance Profile_Thread_Buffer *volatile _profiler_thread_buffers;
+ogb_instance Profiler_State _profiler;
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 String_Builder _profile_output = {0};
 bool profiler_initted = false;
-Spinlock _profiler_lock;
+alignat(CACHE_LINE_SIZE) Spinlock _profiler_lock; // Only taken when flushing
+Profile_Thread_Buffer *volatile _profiler_thread_buffers = 0;
+thread_local Profile_Thread_Buffer *_profiler_thread_buffer = 0;
+thread_local u64 _profiler_frame_start = 0;
+Profiler_State _profiler = {0};
 #endif
 
+// Drains what all threads recorded so far into the output of the current mode
+void ogb_instance
+profiler_flush();
+
+// Writes binary trace chunks to 'path' from a background thread until profiler_stop()
+bool ogb_instance
+profiler_start_streaming(string path);
+
+// Keeps the last 'seconds' of events in memory (bounded by PROFILER_MAX_HISTORY_BYTES)
+void ogb_instance
+profiler_start_history(f64 seconds);
+
+// Writes the kept history to 'path' as a binary trace
+bool ogb_instance
+profiler_snapshot(string path);
+
+// Flushes & goes back to PROFILER_MODE_JSON
+void ogb_instance
+profiler_stop();
+
+bool ogb_instance
+profiler_convert_trace_to_json(string trace_path, string json_path);
+
+void ogb_instance
+dump_profile_result();
+
+// count & start are in rdtsc() cycles
+void ogb_instance
+_profiler_report_time_cycles(string name, u64 count, u64 start);
+
+// Adds a sample to the counter track 'name'
+void ogb_instance
+profiler_counter(string name, f64 value);
+
+// Everything between these ends up in one "Frame" event on the frame track
+void ogb_instance
+profiler_frame_begin();
+void ogb_instance
+profiler_frame_end();
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+void _profiler_flush_thread_proc(Thread *t);
+
+Profile_Thread_Buffer *_profiler_register_thread() {
+	Profile_Thread_Buffer *buffer = (Profile_Thread_Buffer*)alloc(get_heap_allocator(), sizeof(Profile_Thread_Buffer));
+	memset(buffer, 0, sizeof(*buffer));
+	spsc_queue_init(&buffer->events, sizeof(Profile_Event), PROFILER_EVENTS_PER_THREAD, get_heap_allocator());
+	buffer->thread_id = get_context().thread_id;
+
+	// Buffers are never freed, events from threads that exited are still flushed.
+	Profile_Thread_Buffer *head;
+	do {
+		head = (Profile_Thread_Buffer*)atomic_load_pointer((void*volatile*)&_profiler_thread_buffers, MEMORY_ORDER_ACQUIRE);
+		buffer->next = head;
+	} while (!compare_and_swap_pointer((void*volatile*)&_profiler_thread_buffers, buffer, head));
+
+	_profiler_thread_buffer = buffer;
+
+	if (compare_and_swap_bool((bool*)&_profiler.flush_thread_started, true, false)) {
+		os_thread_init(&_profiler.flush_thread, _profiler_flush_thread_proc);
+		os_thread_start(&_profiler.flush_thread);
+	}
+
+	return buffer;
+}
+
+// Called with buffer->raw_lock held
+void _profiler_drain_ring(Profile_Thread_Buffer *buffer) {
+	u64 count = spsc_queue_get_count(&buffer->events);
+	if (buffer->raw_count+count > buffer->raw_capacity) {
+		u64 capacity = max(buffer->raw_capacity*2, buffer->raw_count+count);
+		Profile_Event *raw = (Profile_Event*)alloc(get_heap_allocator(), capacity*sizeof(Profile_Event));
+		if (buffer->raw) {
+			memcpy(raw, buffer->raw, buffer->raw_count*sizeof(Profile_Event));
+			dealloc(get_heap_allocator(), buffer->raw);
+		}
+		buffer->raw = raw;
+		buffer->raw_capacity = capacity;
+	}
+	buffer->raw_count += spsc_queue_pop_many(&buffer->events, buffer->raw+buffer->raw_count, count);
+}
+
+Profile_Trace_Header _profiler_make_trace_header() {
+	Profile_Trace_Header header = {0};
+	memcpy(header.magic, "OGBTRACE", 8);
+	header.version = PROFILER_TRACE_VERSION;
+	header.cycles_per_second = os.cycles_per_second;
+	if (header.cycles_per_second == 0) header.cycles_per_second = os_measure_cycles_per_second(0.01);
+	return header;
+}
+
+// Called with _profiler_lock held
+void _profiler_emit_chunk() {
+	Profile_Chunk_Builder *c = _profiler.chunk;
+	if (c->header.event_count == 0) return;
+
+	u64 events_size = sizeof(Profile_Trace_Event)*c->header.event_count;
+	u64 size = sizeof(Profile_Chunk_Header) + events_size + c->header.name_bytes;
+
+	if (_profiler.mode == PROFILER_MODE_STREAM) {
+		os_file_write_bytes(_profiler.stream_file, &c->header, sizeof(Profile_Chunk_Header));
+		os_file_write_bytes(_profiler.stream_file, c->events, events_size);
+		os_file_write_bytes(_profiler.stream_file, c->names, c->header.name_bytes);
+	} else if (_profiler.mode == PROFILER_MODE_HISTORY) {
+		Profile_History_Chunk *h = (Profile_History_Chunk*)alloc(get_heap_allocator(), sizeof(Profile_History_Chunk)+size);
+		h->next = 0;
+		h->size = size;
+		h->last_cycle = c->header.last_cycle;
+		u8 *data = (u8*)(h+1);
+		memcpy(data, &c->header, sizeof(Profile_Chunk_Header));
+		memcpy(data+sizeof(Profile_Chunk_Header), c->events, events_size);
+		memcpy(data+sizeof(Profile_Chunk_Header)+events_size, c->names, c->header.name_bytes);
+
+		if (_profiler.history_last) _profiler.history_last->next = h;
+		else                        _profiler.history_first = h;
+		_profiler.history_last = h;
+		_profiler.history_bytes += size;
+
+		// Forget what's too old, or too much
+		u64 oldest_cycle_to_keep = rdtsc() - (u64)(_profiler.history_seconds*(f64)os.cycles_per_second);
+		while (_profiler.history_first != _profiler.history_last) {
+			Profile_History_Chunk *first = _profiler.history_first;
+			if (first->last_cycle >= oldest_cycle_to_keep && _profiler.history_bytes <= PROFILER_MAX_HISTORY_BYTES) break;
+			_profiler.history_first = first->next;
+			_profiler.history_bytes -= first->size;
+			dealloc(get_heap_allocator(), first);
+		}
+	}
+
+	memset(&c->header, 0, sizeof(c->header));
+	memset(c->name_keys, 0, sizeof(c->name_keys));
+}
+
+// Called with _profiler_lock held
+void _profiler_chunk_add(Profile_Event *e, u64 thread_id) {
+	Profile_Chunk_Builder *c = _profiler.chunk;
+
+	u64 name_length = min(e->name.count, PROFILER_CHUNK_MAX_NAME_BYTES);
+	u64 name_size = (name_length+7) & ~7ull; // Keeps the next chunk header aligned
+	if (c->header.event_count == PROFILER_CHUNK_MAX_EVENTS || c->header.name_bytes+name_size > PROFILER_CHUNK_MAX_NAME_BYTES) {
+		_profiler_emit_chunk();
+	}
+
+	// Find or add name. Full table just means we store the name again.
+	u64 slot = ((u64)e->name.data >> 3) & (PROFILER_CHUNK_NAME_SLOTS-1);
+	u32 name_offset = c->header.name_bytes;
+	bool found = false;
+	for (u64 i = 0; i < 8; i++) {
+		u64 s = (slot+i) & (PROFILER_CHUNK_NAME_SLOTS-1);
+		if (c->name_keys[s] == e->name.data && c->name_lengths[s] == name_length) {
+			name_offset = c->name_offsets[s];
+			found = true;
+			break;
+		}
+		if (c->name_keys[s] == 0) {
+			c->name_keys[s] = e->name.data;
+			c->name_offsets[s] = name_offset;
+			c->name_lengths[s] = (u32)name_length;
+			break;
+		}
+	}
+	if (!found) {
+		memcpy(c->names+c->header.name_bytes, e->name.data, name_length);
+		memset(c->names+c->header.name_bytes+name_length, 0, name_size-name_length);
+		c->header.name_bytes += name_size;
+	}
+
+	Profile_Trace_Event *t = &c->events[c->header.event_count];
+	t->start = e->start;
+	t->duration = e->duration;
+	t->thread_id = thread_id;
+	t->name_offset = name_offset;
+	t->name_length = (u16)name_length;
+	t->kind = (u16)e->kind;
+
+	u64 end = e->kind == PROFILE_EVENT_COUNTER ? e->start : e->start+e->duration;
+	if (c->header.event_count == 0 || e->start < c->header.first_cycle) c->header.first_cycle = e->start;
+	if (end > c->header.last_cycle) c->header.last_cycle = end;
+	c->header.event_count += 1;
+}
+
+// Trace timestamps & durations are in microseconds.
+// (c string formats so they're not converted in temporary storage for every event)
+void _profiler_print_json_event(String_Builder *sb, Profile_Event_Kind kind, string name, u64 start, u64 duration, f64 value, u64 thread_id, f64 us_per_cycle) {
+	f64 ts = (f64)start*us_per_cycle;
+	switch (kind) {
+		case PROFILE_EVENT_SCOPE:
+			string_builder_print(sb, PROFILER_JSON_EVENT_FORMAT, (f64)duration*us_per_cycle, name, thread_id, ts);
+			break;
+		case PROFILE_EVENT_COUNTER:
+			string_builder_print(sb, PROFILER_JSON_COUNTER_FORMAT, name, ts, value);
+			break;
+		case PROFILE_EVENT_FRAME:
+			string_builder_print(sb, PROFILER_JSON_FRAME_FORMAT, (f64)duration*us_per_cycle, name, ts, name, ts);
+			break;
+	}
+}
+
+void profiler_flush() {
+	spinlock_acquire_or_wait(&_profiler_lock);
+
+	if (!profiler_initted) {
+		string_builder_init_reserve(&_profile_output, 1024*1000, get_heap_allocator());
+		profiler_initted = true;
+	}
+
+	f64 us_per_cycle = cycles_to_microseconds(1);
+
+	Profile_Thread_Buffer *buffer = (Profile_Thread_Buffer*)atomic_load_pointer((void*volatile*)&_profiler_thread_buffers, MEMORY_ORDER_ACQUIRE);
+	while (buffer) {
+		// Only hold the thread's lock while moving events, it might be waiting to record
+		spinlock_acquire_or_wait(&buffer->raw_lock);
+		_profiler_drain_ring(buffer);
+		Profile_Event *events = buffer->raw;
+		u64 count = buffer->raw_count;
+		u64 capacity = buffer->raw_capacity;
+		buffer->raw = _profiler.flush_events;
+		buffer->raw_capacity = _profiler.flush_events_capacity;
+		buffer->raw_count = 0;
+		spinlock_release(&buffer->raw_lock);
+
+		for (u64 i = 0; i < count; i++) {
+			Profile_Event *e = &events[i];
+			if (_profiler.mode == PROFILER_MODE_JSON) {
+				_profiler_print_json_event(&_profile_output, e->kind, e->name, e->start, e->duration, e->value, buffer->thread_id, us_per_cycle);
+			} else {
+				_profiler_chunk_add(e, buffer->thread_id);
+			}
+		}
+
+		_profiler.flush_events = events;
+		_profiler.flush_events_capacity = capacity;
+
+		buffer = buffer->next;
+	}
+
+	if (_profiler.mode != PROFILER_MODE_JSON) _profiler_emit_chunk();
+
+	spinlock_release(&_profiler_lock);
+}
+
+// Runs for the rest of the program
+void _profiler_flush_thread_proc(Thread *t) {
+	while (true) {
+		os_sleep(PROFILER_FLUSH_INTERVAL_MS);
+		profiler_flush();
+	}
+}
+
+void _profiler_start_background(Profiler_Mode mode) {
+	assert(_profiler.mode == PROFILER_MODE_JSON, "Profiler is already streaming or keeping history, call profiler_stop() first");
+
+	// Whatever was recorded before goes to the json output like before
+	profiler_flush();
+
+	spinlock_acquire_or_wait(&_profiler_lock);
+	_profiler.chunk = (Profile_Chunk_Builder*)alloc(get_heap_allocator(), sizeof(Profile_Chunk_Builder));
+	memset(_profiler.chunk, 0, sizeof(Profile_Chunk_Builder));
+	_profiler.mode = mode;
+	spinlock_release(&_profiler_lock);
+}
+
+bool profiler_start_streaming(string path) {
+	File file = os_file_open(path, O_CREATE | O_WRITE);
+	if (file == OS_INVALID_FILE) {
+		log_error("Could not open '%s' for profiler streaming", path);
+		return false;
+	}
+
+	Profile_Trace_Header header = _profiler_make_trace_header();
+	os_file_write_bytes(file, &header, sizeof(header));
+
+	_profiler.stream_file = file;
+	_profiler_start_background(PROFILER_MODE_STREAM);
+	return true;
+}
+
+void profiler_start_history(f64 seconds) {
+	_profiler.history_seconds = seconds;
+	if (os.cycles_per_second == 0) os.cycles_per_second = os_measure_cycles_per_second(0.01);
+	_profiler_start_background(PROFILER_MODE_HISTORY);
+}
+
+bool profiler_snapshot(string path) {
+	profiler_flush();
+
+	File file = os_file_open(path, O_CREATE | O_WRITE);
+	if (file == OS_INVALID_FILE) {
+		log_error("Could not open '%s' for profiler snapshot", path);
+		return false;
+	}
+
+	Profile_Trace_Header header = _profiler_make_trace_header();
+	os_file_write_bytes(file, &header, sizeof(header));
+
+	spinlock_acquire_or_wait(&_profiler_lock);
+	assert(_profiler.mode == PROFILER_MODE_HISTORY, "profiler_snapshot needs profiler_start_history()");
+	for (Profile_History_Chunk *h = _profiler.history_first; h; h = h->next) {
+		os_file_write_bytes(file, h+1, h->size);
+	}
+	spinlock_release(&_profiler_lock);
+
+	os_file_close(file);
+	return true;
+}
+
+void profiler_stop() {
+	if (_profiler.mode == PROFILER_MODE_JSON) return;
+
+	profiler_flush();
+
+	spinlock_acquire_or_wait(&_profiler_lock);
+	if (_profiler.mode == PROFILER_MODE_STREAM) {
+		os_file_close(_profiler.stream_file);
+		_profiler.stream_file = OS_INVALID_FILE;
+	}
+	while (_profiler.history_first) {
+		Profile_History_Chunk *next = _profiler.history_first->next;
+		dealloc(get_heap_allocator(), _profiler.history_first);
+		_profiler.history_first = next;
+	}
+	_profiler.history_last = 0;
+	_profiler.history_bytes = 0;
+	dealloc(get_heap_allocator(), _profiler.chunk);
+	_profiler.chunk = 0;
+	_profiler.mode = PROFILER_MODE_JSON;
+	spinlock_release(&_profiler_lock);
+}
+
+bool profiler_convert_trace_to_json(string trace_path, string json_path) {
+	string trace;
+	if (!os_read_entire_file(trace_path, &trace, get_heap_allocator())) {
+		log_error("Could not read profiler trace '%s'", trace_path);
+		return false;
+	}
+
+	Profile_Trace_Header *header = (Profile_Trace_Header*)trace.data;
+	if (trace.count < sizeof(Profile_Trace_Header) || memcmp(header->magic, "OGBTRACE", 8) != 0 || header->version != PROFILER_TRACE_VERSION) {
+		log_error("'%s' is not a profiler trace (or a different version)", trace_path);
+		dealloc(get_heap_allocator(), trace.data);
+		return false;
+	}
+
+	File file = os_file_open(json_path, O_CREATE | O_WRITE);
+	if (file == OS_INVALID_FILE) {
+		log_error("Could not open '%s' for writing", json_path);
+		dealloc(get_heap_allocator(), trace.data);
+		return false;
+	}
+
+	f64 microseconds_per_cycle = 1000000.0/(f64)header->cycles_per_second;
+
+	// One chunk at a time so memory doesn't grow with the trace
+	String_Builder json;
+	string_builder_init_reserve(&json, 1024*64, get_heap_allocator());
+	os_file_write_string(file, STR("["));
+
+	u64 offset = sizeof(Profile_Trace_Header);
+	bool ok = true;
+	while (offset+sizeof(Profile_Chunk_Header) <= trace.count) {
+		Profile_Chunk_Header *chunk = (Profile_Chunk_Header*)(trace.data+offset);
+		Profile_Trace_Event *events = (Profile_Trace_Event*)(chunk+1);
+		u8 *names = (u8*)(events+chunk->event_count);
+		u64 chunk_size = sizeof(Profile_Chunk_Header) + sizeof(Profile_Trace_Event)*chunk->event_count + chunk->name_bytes;
+		if (offset+chunk_size > trace.count) {
+			// Probably crashed in the middle of writing this chunk
+			ok = false;
+			break;
+		}
+
+		json.count = 0;
+		for (u32 i = 0; i < chunk->event_count; i++) {
+			Profile_Trace_Event *e = &events[i];
+			if (e->name_offset+e->name_length > chunk->name_bytes) continue;
+			string name = (string){e->name_length, names+e->name_offset};
+			_profiler_print_json_event(&json, (Profile_Event_Kind)e->kind, name, e->start, e->duration, e->value, e->thread_id, microseconds_per_cycle);
+		}
+		os_file_write_string(file, json.result);
+
+		offset += chunk_size;
+	}
+
+	os_file_write_string(file, STR("{}]"));
+	os_file_close(file);
+
+	dealloc(get_heap_allocator(), json.buffer);
+	dealloc(get_heap_allocator(), trace.data);
+
+	if (!ok) log_warning("Profiler trace '%s' ends with an incomplete chunk, it was skipped", trace_path);
+	return true;
+}
+
 void dump_profile_result() {
+	if (_profiler.mode != PROFILER_MODE_JSON) {
+		profiler_stop();
+		return;
+	}
+
+	profiler_flush();
+
 	File file = os_file_open("google_trace.json", O_CREATE | O_WRITE);
-	
+
+	// The flush thread might still be adding to it
+	spinlock_acquire_or_wait(&_profiler_lock);
 	os_file_write_string(file, STR("["));
 	os_file_write_string(file, _profile_output.result);
 	os_file_write_string(file, STR("{}]"));
-	
+	spinlock_release(&_profiler_lock);
+
 	os_file_close(file);
-	
+
 	log_verbose("Wrote profiling result to google_trace.json");
 }
-void _profiler_report_time_cycles(string name, u64 count, u64 start) {
-	if (!profiler_initted) {
-		spinlock_init(&_profiler_lock);
-		profiler_initted = true;
-		
-		string_builder_init_reserve(&_profile_output, 1024*1000, get_heap_allocator());	
-		
+void _profiler_record(Profile_Event *e) {
+	Profile_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_register_thread();
+
+	if (!spsc_queue_push(&buffer->events, e)) {
+		// Ring is full, the flush thread hasn't come around yet. Move the events out of the
+		// way, formatting is for the flush thread.
+		spinlock_acquire_or_wait(&buffer->raw_lock);
+		_profiler_drain_ring(buffer);
+		spinlock_release(&buffer->raw_lock);
+		bool pushed = spsc_queue_push(&buffer->events, e);
+		assert(pushed, "Profiler ring should have room after draining it");
 	}
-	
-	spinlock_acquire_or_wait(&_profiler_lock);
-	
-	string fmt = STR("{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%lld},");
-	string_builder_print(&_profile_output, fmt, (float64)count*1000, name, get_context().thread_id, start*1000);
-	
-	spinlock_release(&_profiler_lock);
 }
+void _profiler_report_time_cycles(string name, u64 count, u64 start) {
+	Profile_Event e;
+	e.name = name;
+	e.start = start;
+	e.duration = count;
+	e.kind = PROFILE_EVENT_SCOPE;
+	_profiler_record(&e);
+}
+void profiler_counter(string name, f64 value) {
+	Profile_Event e;
+	e.name = name;
+	e.start = rdtsc();
+	e.value = value;
+	e.kind = PROFILE_EVENT_COUNTER;
+	_profiler_record(&e);
+}
+void profiler_frame_begin() {
+	_profiler_frame_start = rdtsc();
+}
+void profiler_frame_end() {
+	if (_profiler_frame_start == 0) return; // No matching profiler_frame_begin()
+
+	Profile_Event e;
+	e.name = STR("Frame");
+	e.start = _profiler_frame_start;
+	e.duration = rdtsc()-_profiler_frame_start;
+	e.kind = PROFILE_EVENT_FRAME;
+	_profiler_record(&e);
+	_profiler_frame_start = 0;
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
 #if ENABLE_PROFILING
 #define tm_scope(name) \
-    for (u64 start_time = os_get_current_cycle_count(), end_time = start_time, elapsed_time = 0; \
+    for (u64 start_time = rdtsc(), end_time = start_time, elapsed_time = 0; \
          elapsed_time == 0; \
-         elapsed_time = (end_time = os_get_current_cycle_count()) - start_time, _profiler_report_time_cycles(STR(name), elapsed_time, start_time))
+         elapsed_time = (end_time = rdtsc()) - start_time, _profiler_report_time_cycles(STR(name), elapsed_time, start_time))
 #define tm_scope_var(name, var) \
-    for (u64 start_time = os_get_current_cycle_count(), end_time = start_time, elapsed_time = 0; \
+    for (u64 start_time = rdtsc(), end_time = start_time, elapsed_time = 0; \
          elapsed_time == 0; \
-         elapsed_time = (end_time = os_get_current_cycle_count()) - start_time, var=elapsed_time)
+         elapsed_time = (end_time = rdtsc()) - start_time, var=elapsed_time)
 #define tm_scope_accum(name, var) \
-    for (u64 start_time = os_get_current_cycle_count(), end_time = start_time, elapsed_time = 0; \
+    for (u64 start_time = rdtsc(), end_time = start_time, elapsed_time = 0; \
          elapsed_time == 0; \
-         elapsed_time = (end_time = os_get_current_cycle_count()) - start_time, var+=elapsed_time)
+         elapsed_time = (end_time = rdtsc()) - start_time, var+=elapsed_time)
+#define tm_counter(name, value) profiler_counter(STR(name), (f64)(value))
+#define tm_frame_begin() profiler_frame_begin()
+#define tm_frame_end() profiler_frame_end()
 #else
 	#define tm_scope(...)
 	#define tm_scope_var(...)
 	#define tm_scope_accum(...)
-#endif
\ No newline at end of file
+	#define tm_counter(...)
+	#define tm_frame_begin()
+	#define tm_frame_end()
+#endif
@@ -0,0 +1,308 @@
+
+/*
+
+	Bounded lock-free queues. Items are copied in & out, capacity is rounded up to a power of 2.
+
+	Single producer, single consumer. Exactly one thread pushes and exactly one thread pops,
+	for example game thread -> audio thread commands.
+
+	Spsc_Queue q;
+	spsc_queue_init(&q, sizeof(Command), 256, get_heap_allocator());
+
+	Command cmd = ...;
+	if (!spsc_queue_push(&q, &cmd)) { ... } // Full
+
+	// On the other thread
+	Command cmds[32];
+	u64 count = spsc_queue_pop_many(&q, cmds, 32);
+	for (u64 i = 0; i < count; i++) { ... }
+
+	spsc_queue_deinit(&q);
+
+	Multi producer, multi consumer (Dmitry Vyukov's bounded queue). Any thread can push and
+	any thread can pop. Same procedures as Spsc_Queue but prefixed mpmc_:
+
+	Mpmc_Queue q;
+	mpmc_queue_init(&q, sizeof(Job), 4096, get_heap_allocator());
+	mpmc_queue_push(&q, &job);
+	mpmc_queue_pop(&q, &job);
+	mpmc_queue_push_many(&q, jobs, count); // Returns how many were pushed (all or as many as fit)
+	mpmc_queue_pop_many(&q, jobs, max_count);
+	mpmc_queue_deinit(&q);
+
+	The producer and consumer indices live on separate cache lines so the two sides don't
+	invalidate each other's cache on every push/pop. Batched push/pop only touches the shared
+	indices once per batch.
+
+	Note: push_many/pop_many on Mpmc_Queue claim a range of slots and then wait for each slot
+	to be released by whichever thread was still copying an item in/out of it. That wait is
+	only as long as a memcpy, unless that thread is preempted right in the middle of it
+	(then we yield to it).
+
+*/
+
+typedef struct Spsc_Queue {
+	u8 *items;
+	u64 item_size;
+	u64 capacity;
+	u64 mask;
+	Allocator allocator;
+
+	u8 _pad0[CACHE_LINE_SIZE];
+	// Producer side
+	volatile u64 tail;
+	u64 cached_head; // Last head the producer saw, so it only reads the consumer's line when it looks full
+	u8 _pad1[CACHE_LINE_SIZE-sizeof(u64)*2];
+	// Consumer side
+	volatile u64 head;
+	u64 cached_tail;
+	u8 _pad2[CACHE_LINE_SIZE-sizeof(u64)*2];
+} Spsc_Queue;
+
+typedef struct Mpmc_Queue {
+	u8 *cells; // Each cell is a u64 sequence number followed by the item
+	u64 cell_size;
+	u64 item_size;
+	u64 capacity;
+	u64 mask;
+	Allocator allocator;
+
+	u8 _pad0[CACHE_LINE_SIZE];
+	volatile u64 enqueue_pos;
+	u8 _pad1[CACHE_LINE_SIZE-sizeof(u64)];
+	volatile u64 dequeue_pos;
+	u8 _pad2[CACHE_LINE_SIZE-sizeof(u64)];
+} Mpmc_Queue;
+
+// Copies count items between a linear buffer and a ring starting at ring index 'pos'
+void _queue_copy_to_ring(u8 *ring, u64 item_size, u64 capacity, u64 pos, void *src, u64 count) {
+	u64 index = pos & (capacity-1);
+	u64 first_count = min(count, capacity-index);
+	memcpy(ring+index*item_size, src, first_count*item_size);
+	memcpy(ring, (u8*)src+first_count*item_size, (count-first_count)*item_size);
+}
+void _queue_copy_from_ring(u8 *ring, u64 item_size, u64 capacity, u64 pos, void *dst, u64 count) {
+	u64 index = pos & (capacity-1);
+	u64 first_count = min(count, capacity-index);
+	memcpy(dst, ring+index*item_size, first_count*item_size);
+	memcpy((u8*)dst+first_count*item_size, ring, (count-first_count)*item_size);
+}
+
+///
+// Spsc_Queue
+
+void
+spsc_queue_init(Spsc_Queue *q, u64 item_size, u64 capacity, Allocator allocator) {
+	assert(item_size > 0, "Queue item size must be more than 0");
+	assert(capacity > 0, "Queue capacity must be more than 0");
+	memset(q, 0, sizeof(*q));
+	q->item_size = item_size;
+	q->capacity  = get_next_power_of_two(capacity);
+	q->mask      = q->capacity-1;
+	q->allocator = allocator;
+	q->items     = (u8*)alloc(allocator, q->capacity*item_size);
+}
+void
+spsc_queue_deinit(Spsc_Queue *q) {
+	dealloc(q->allocator, q->items);
+	memset(q, 0, sizeof(*q));
+}
+
+// Producer only. Returns how many of the items were pushed.
+u64
+spsc_queue_push_many(Spsc_Queue *q, void *items, u64 count) {
+	u64 tail = q->tail; // Only we write tail
+	u64 free_count = q->capacity - (tail - q->cached_head);
+	if (free_count < count) {
+		q->cached_head = atomic_load_64(&q->head, MEMORY_ORDER_ACQUIRE);
+		free_count = q->capacity - (tail - q->cached_head);
+	}
+	count = min(count, free_count);
+	if (count == 0) return 0;
+
+	_queue_copy_to_ring(q->items, q->item_size, q->capacity, tail, items, count);
+
+	// Items must be written before the consumer can see the new tail
+	atomic_store_64(&q->tail, tail+count, MEMORY_ORDER_RELEASE);
+	return count;
+}
+// Consumer only. Returns how many items were written to 'items'.
+u64
+spsc_queue_pop_many(Spsc_Queue *q, void *items, u64 max_count) {
+	u64 head = q->head; // Only we write head
+	u64 available = q->cached_tail - head;
+	if (available < max_count) {
+		q->cached_tail = atomic_load_64(&q->tail, MEMORY_ORDER_ACQUIRE);
+		available = q->cached_tail - head;
+	}
+	u64 count = min(max_count, available);
+	if (count == 0) return 0;
+
+	_queue_copy_from_ring(q->items, q->item_size, q->capacity, head, items, count);
+
+	// Items must be read before the producer can overwrite them
+	atomic_store_64(&q->head, head+count, MEMORY_ORDER_RELEASE);
+	return count;
+}
+bool
+spsc_queue_push(Spsc_Queue *q, void *item) {
+	return spsc_queue_push_many(q, item, 1) == 1;
+}
+bool
+spsc_queue_pop(Spsc_Queue *q, void *item) {
+	return spsc_queue_pop_many(q, item, 1) == 1;
+}
+// Only exact when called from the producer or consumer thread while the other side is idle
+u64
+spsc_queue_get_count(Spsc_Queue *q) {
+	u64 tail = atomic_load_64(&q->tail, MEMORY_ORDER_ACQUIRE);
+	u64 head = atomic_load_64(&q->head, MEMORY_ORDER_ACQUIRE);
+	return tail-head;
+}
+
+///
+// Mpmc_Queue
+
+void
+mpmc_queue_init(Mpmc_Queue *q, u64 item_size, u64 capacity, Allocator allocator) {
+	assert(item_size > 0, "Queue item size must be more than 0");
+	assert(capacity > 0, "Queue capacity must be more than 0");
+	memset(q, 0, sizeof(*q));
+	q->item_size = item_size;
+	q->cell_size = (sizeof(u64)+item_size+7) & ~7ull; // Keep the sequence numbers 8 byte aligned
+	q->capacity  = get_next_power_of_two(capacity);
+	q->mask      = q->capacity-1;
+	q->allocator = allocator;
+	q->cells     = (u8*)alloc(allocator, q->capacity*q->cell_size);
+
+	// A cell is free for position p when its sequence is p, and holds the item pushed at
+	// position p when its sequence is p+1.
+	for (u64 i = 0; i < q->capacity; i++) {
+		*(u64*)(q->cells + i*q->cell_size) = i;
+	}
+}
+void
+mpmc_queue_deinit(Mpmc_Queue *q) {
+	dealloc(q->allocator, q->cells);
+	memset(q, 0, sizeof(*q));
+}
+
+// The other side claimed the cell and is copying in/out of it right now
+void
+_mpmc_queue_wait_for_cell(volatile u64 *cell, u64 seq) {
+	u64 spin_count = 0;
+	while (atomic_load_64(cell, MEMORY_ORDER_ACQUIRE) != seq) {
+		// It got preempted mid-copy, let it run
+		if (++spin_count > 64) os_yield_thread();
+		else cpu_pause();
+	}
+}
+
+volatile u64*
+_mpmc_queue_cell(Mpmc_Queue *q, u64 pos) {
+	return (volatile u64*)(q->cells + (pos & q->mask)*q->cell_size);
+}
+
+bool
+mpmc_queue_push(Mpmc_Queue *q, void *item) {
+	u64 pos = atomic_load_64(&q->enqueue_pos, MEMORY_ORDER_RELAXED);
+	while (true) {
+		volatile u64 *cell = _mpmc_queue_cell(q, pos);
+		u64 seq = atomic_load_64(cell, MEMORY_ORDER_ACQUIRE);
+		s64 diff = (s64)seq - (s64)pos;
+		if (diff == 0) {
+			if (compare_and_swap_64((u64*)&q->enqueue_pos, pos+1, pos)) {
+				memcpy((u8*)cell+sizeof(u64), item, q->item_size);
+				atomic_store_64(cell, pos+1, MEMORY_ORDER_RELEASE);
+				return true;
+			}
+		} else if (diff < 0) {
+			// Cell still holds the item from a lap ago, so it's full
+			return false;
+		}
+		pos = atomic_load_64(&q->enqueue_pos, MEMORY_ORDER_RELAXED);
+	}
+}
+bool
+mpmc_queue_pop(Mpmc_Queue *q, void *item) {
+	u64 pos = atomic_load_64(&q->dequeue_pos, MEMORY_ORDER_RELAXED);
+	while (true) {
+		volatile u64 *cell = _mpmc_queue_cell(q, pos);
+		u64 seq = atomic_load_64(cell, MEMORY_ORDER_ACQUIRE);
+		s64 diff = (s64)seq - (s64)(pos+1);
+		if (diff == 0) {
+			if (compare_and_swap_64((u64*)&q->dequeue_pos, pos+1, pos)) {
+				memcpy(item, (u8*)cell+sizeof(u64), q->item_size);
+				atomic_store_64(cell, pos+q->capacity, MEMORY_ORDER_RELEASE);
+				return true;
+			}
+		} else if (diff < 0) {
+			// Nothing pushed here yet, so it's empty
+			return false;
+		}
+		pos = atomic_load_64(&q->dequeue_pos, MEMORY_ORDER_RELAXED);
+	}
+}
+
+// Returns how many of the items were pushed
+u64
+mpmc_queue_push_many(Mpmc_Queue *q, void *items, u64 count) {
+	u64 pos;
+	while (true) {
+		pos = atomic_load_64(&q->enqueue_pos, MEMORY_ORDER_RELAXED);
+		u64 dequeue_pos = atomic_load_64(&q->dequeue_pos, MEMORY_ORDER_ACQUIRE);
+
+		// Everything before dequeue_pos has been claimed by a consumer, so those cells will
+		// be free for us soon if they aren't already.
+		s64 used = (s64)(pos - dequeue_pos);
+		if (used < 0) continue; // pos is stale
+		u64 n = min(count, q->capacity - (u64)used);
+		if (n == 0) return 0;
+
+		if (compare_and_swap_64((u64*)&q->enqueue_pos, pos+n, pos)) {
+			count = n;
+			break;
+		}
+	}
+
+	for (u64 i = 0; i < count; i++) {
+		volatile u64 *cell = _mpmc_queue_cell(q, pos+i);
+		_mpmc_queue_wait_for_cell(cell, pos+i);
+		memcpy((u8*)cell+sizeof(u64), (u8*)items+i*q->item_size, q->item_size);
+		atomic_store_64(cell, pos+i+1, MEMORY_ORDER_RELEASE);
+	}
+	return count;
+}
+// Returns how many items were written to 'items'
+u64
+mpmc_queue_pop_many(Mpmc_Queue *q, void *items, u64 max_count) {
+	u64 pos;
+	u64 count;
+	while (true) {
+		pos = atomic_load_64(&q->dequeue_pos, MEMORY_ORDER_RELAXED);
+		u64 enqueue_pos = atomic_load_64(&q->enqueue_pos, MEMORY_ORDER_ACQUIRE);
+
+		// Everything before enqueue_pos has been claimed by a producer
+		s64 available = (s64)(enqueue_pos - pos);
+		if (available < 0) continue; // pos is stale
+		count = min(max_count, (u64)available);
+		if (count == 0) return 0;
+
+		if (compare_and_swap_64((u64*)&q->dequeue_pos, pos+count, pos)) break;
+	}
+
+	for (u64 i = 0; i < count; i++) {
+		volatile u64 *cell = _mpmc_queue_cell(q, pos+i);
+		_mpmc_queue_wait_for_cell(cell, pos+i+1);
+		memcpy((u8*)items+i*q->item_size, (u8*)cell+sizeof(u64), q->item_size);
+		atomic_store_64(cell, pos+i+q->capacity, MEMORY_ORDER_RELEASE);
+	}
+	return count;
+}
+// Approximate if other threads are pushing/popping at the same time
+u64
+mpmc_queue_get_count(Mpmc_Queue *q) {
+	u64 dequeue_pos = atomic_load_64(&q->dequeue_pos, MEMORY_ORDER_ACQUIRE);
+	u64 enqueue_pos = atomic_load_64(&q->enqueue_pos, MEMORY_ORDER_ACQUIRE);
+	return enqueue_pos > dequeue_pos ? enqueue_pos-dequeue_pos : 0;
+}
@@ -0,0 +1,277 @@
+
+/*
+	Opt-in sampling profiler. A helper thread interrupts the thread that started it a number
+	of times per second and records its call stack, which finds the hot code that nobody
+	thought of wrapping in tm_scope.
+
+		sampling_profiler_start(1000); // Hz
+		...
+		sampling_profiler_stop();
+		sampling_profiler_dump_collapsed(STR("samples.folded"));
+
+	The dump is in "collapsed stacks" format, one line per unique stack with its sample count:
+
+		main;entry;update_world;resolve_collisions 37
+
+	Open it in https://www.speedscope.app or make an svg with flamegraph.pl.
+
+	Only return addresses are recorded while sampling, symbols are looked up when dumping.
+	Debug builds get function names, release builds get "module+0x1234" which can be resolved
+	offline with the pdb. The last SAMPLING_PROFILER_MAX_SAMPLES samples are kept.
+
+	Sampling sleeps between samples at up to 1000 Hz (so the actual rate depends on the timer
+	resolution). Above that the helper thread spins between samples and keeps a core busy.
+*/
+
+#ifndef SAMPLING_PROFILER_MAX_SAMPLES
+	#define SAMPLING_PROFILER_MAX_SAMPLES 16384
+#endif
+#ifndef SAMPLING_PROFILER_MAX_DEPTH
+	#define SAMPLING_PROFILER_MAX_DEPTH 64
+#endif
+
+typedef struct Stack_Sample {
+	u64 depth;
+	u64 addresses[SAMPLING_PROFILER_MAX_DEPTH]; // Innermost first
+} Stack_Sample;
+
+typedef struct Sampling_Profiler {
+	Stack_Sample *samples; // Ring of SAMPLING_PROFILER_MAX_SAMPLES
+	u64 sample_count;      // Taken in total, the ring keeps the last ones
+	Mutex samples_mutex;
+
+	u64 target_thread_id;
+	f64 interval_seconds;
+	f64 start_seconds;
+	f64 stop_seconds;
+
+	Thread thread;
+	volatile bool running;
+} Sampling_Profiler;
+
+// #Global
+ogb_instance Sampling_Profiler _sampling_profiler;
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Sampling_Profiler _sampling_profiler = {0};
+#endif
+
+// Starts sampling the calling thread 'hz' times per second
+ogb_instance bool
+sampling_profiler_start(u64 hz);
+
+ogb_instance void
+sampling_profiler_stop();
+
+// Number of samples taken since start (including ones that no longer fit in the ring)
+ogb_instance u64
+sampling_profiler_get_sample_count();
+
+// Writes the kept samples as collapsed stacks. Can be called while sampling.
+ogb_instance bool
+sampling_profiler_dump_collapsed(string path);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+void _sampling_profiler_thread_proc(Thread *t) {
+	Sampling_Profiler *p = &_sampling_profiler;
+
+	u64 addresses[SAMPLING_PROFILER_MAX_DEPTH];
+	f64 next_sample = os_get_current_time_in_seconds();
+	while (p->running) {
+		u64 depth = os_capture_thread_stack(p->target_thread_id, addresses, SAMPLING_PROFILER_MAX_DEPTH);
+
+		// Captured outside the lock so the target isn't suspended for longer than needed
+		if (depth > 0) {
+			mutex_acquire_or_wait(&p->samples_mutex);
+			Stack_Sample *sample = &p->samples[p->sample_count % SAMPLING_PROFILER_MAX_SAMPLES];
+			sample->depth = depth;
+			memcpy(sample->addresses, addresses, depth*sizeof(u64));
+			p->sample_count += 1;
+			mutex_release(&p->samples_mutex);
+		}
+
+		next_sample += p->interval_seconds;
+		f64 now = os_get_current_time_in_seconds();
+		if (next_sample < now) next_sample = now; // Fell behind, don't try to catch up
+
+		if (p->interval_seconds >= 0.001) {
+			os_sleep(max(1, (u32)((next_sample-now)*1000.0)));
+		} else {
+			while (os_get_current_time_in_seconds() < next_sample) os_yield_thread();
+		}
+	}
+
+	// Closes the target's handle, before sampling_profiler_stop() is done joining us
+	os_capture_thread_stack_done();
+}
+
+bool sampling_profiler_start(u64 hz) {
+	Sampling_Profiler *p = &_sampling_profiler;
+	assert(!p->running, "Sampling profiler is already running");
+	assert(hz > 0, "Sampling profiler needs a rate above 0 Hz");
+
+	if (!p->samples) {
+		p->samples = alloc(get_heap_allocator(), SAMPLING_PROFILER_MAX_SAMPLES*sizeof(Stack_Sample));
+		mutex_init(&p->samples_mutex);
+	}
+	p->sample_count = 0;
+	p->target_thread_id = get_context().thread_id;
+	p->interval_seconds = 1.0/(f64)hz;
+	p->start_seconds = os_get_current_time_in_seconds();
+	p->stop_seconds = 0;
+
+	p->running = true;
+	os_thread_init(&p->thread, _sampling_profiler_thread_proc);
+	os_thread_start(&p->thread);
+	return true;
+}
+
+void sampling_profiler_stop() {
+	Sampling_Profiler *p = &_sampling_profiler;
+	if (!p->running) return;
+
+	p->running = false;
+	os_thread_join(&p->thread);
+	os_thread_destroy(&p->thread);
+	p->stop_seconds = os_get_current_time_in_seconds();
+
+	f64 seconds = p->stop_seconds-p->start_seconds;
+	log_verbose("Sampling profiler took %llu samples in %.2fs (%.0f Hz)", p->sample_count, seconds, (f64)p->sample_count/seconds);
+}
+
+u64 sampling_profiler_get_sample_count() {
+	return _sampling_profiler.sample_count;
+}
+
+// Frames are separated by ';' and the count by ' ' in the collapsed format
+void _sampling_profiler_sanitize_name(string name) {
+	for (u64 i = 0; i < name.count; i++) {
+		if (name.data[i] == ';' || name.data[i] == ' ') name.data[i] = '_';
+	}
+}
+
+u64 _sampling_profiler_hash_line(string line) {
+	u64 hash = 14695981039346656037ull; // FNV-1a
+	for (u64 i = 0; i < line.count; i++) hash = (hash ^ line.data[i]) * 1099511628211ull;
+	return hash;
+}
+
+typedef struct Collapsed_Stack {
+	u64 hash;
+	u64 offset; // Into the line builder
+	u64 length;
+} Collapsed_Stack;
+
+s64 _sampling_profiler_find_address(u64 *sorted, u64 count, u64 address) {
+	u64 low = 0;
+	u64 high = count;
+	while (low < high) {
+		u64 mid = (low+high)/2;
+		if (sorted[mid] < address) low = mid+1;
+		else high = mid;
+	}
+	return (low < count && sorted[low] == address) ? (s64)low : -1;
+}
+
+bool sampling_profiler_dump_collapsed(string path) {
+	Sampling_Profiler *p = &_sampling_profiler;
+	Allocator heap = get_heap_allocator();
+
+	if (!p->samples) {
+		log_error("Sampling profiler has no samples, call sampling_profiler_start() first");
+		return false;
+	}
+
+	mutex_acquire_or_wait(&p->samples_mutex);
+	u64 sample_count = min(p->sample_count, SAMPLING_PROFILER_MAX_SAMPLES);
+
+	// Return addresses point after the call, so look up the call itself (except innermost)
+	#define _SAMPLE_ADDRESS(s, i) ((i) == 0 ? (s)->addresses[0] : (s)->addresses[i]-1)
+
+	///
+	// Symbolize every unique address once
+
+	u64 total_frames = 0;
+	for (u64 i = 0; i < sample_count; i++) total_frames += p->samples[i].depth;
+
+	u64 *addresses = alloc(heap, max(total_frames, 1)*sizeof(u64));
+	u64 *help = alloc(heap, max(total_frames, 1)*sizeof(u64));
+	u64 n = 0;
+	for (u64 i = 0; i < sample_count; i++) {
+		Stack_Sample *s = &p->samples[i];
+		for (u64 j = 0; j < s->depth; j++) addresses[n++] = _SAMPLE_ADDRESS(s, j);
+	}
+	radix_sort(addresses, help, total_frames, sizeof(u64), 0, 64);
+	u64 unique_count = 0;
+	for (u64 i = 0; i < total_frames; i++) {
+		if (unique_count == 0 || addresses[unique_count-1] != addresses[i]) {
+			addresses[unique_count++] = addresses[i];
+		}
+	}
+
+	string *names = alloc(heap, max(unique_count, 1)*sizeof(string));
+	for (u64 i = 0; i < unique_count; i++) {
+		names[i] = os_get_symbol_name(addresses[i], heap);
+		_sampling_profiler_sanitize_name(names[i]);
+	}
+
+	///
+	// One line per sample, root first
+
+	String_Builder lines;
+	string_builder_init_reserve(&lines, 1024*64, heap);
+	Collapsed_Stack *stacks = alloc(heap, max(sample_count, 1)*sizeof(Collapsed_Stack));
+	Collapsed_Stack *stacks_help = alloc(heap, max(sample_count, 1)*sizeof(Collapsed_Stack));
+	for (u64 i = 0; i < sample_count; i++) {
+		Stack_Sample *s = &p->samples[i];
+		u64 offset = lines.count;
+		for (s64 j = (s64)s->depth-1; j >= 0; j--) {
+			s64 index = _sampling_profiler_find_address(addresses, unique_count, _SAMPLE_ADDRESS(s, j));
+			assert(index != -1, "Internal sampling profiler error: address was not symbolized");
+			string_builder_append(&lines, names[index]);
+			if (j > 0) string_builder_append(&lines, STR(";"));
+		}
+		stacks[i].offset = offset;
+		stacks[i].length = lines.count-offset;
+		stacks[i].hash = _sampling_profiler_hash_line((string){stacks[i].length, (u8*)lines.buffer+offset});
+	}
+	#undef _SAMPLE_ADDRESS
+
+	mutex_release(&p->samples_mutex);
+
+	///
+	// Merge identical lines. Different addresses in the same function give the same line.
+
+	radix_sort(stacks, stacks_help, sample_count, sizeof(Collapsed_Stack), offsetof(Collapsed_Stack, hash), 64);
+
+	String_Builder output;
+	string_builder_init_reserve(&output, 1024*64, heap);
+	u64 first = 0;
+	while (first < sample_count) {
+		string line = (string){stacks[first].length, (u8*)lines.buffer+stacks[first].offset};
+		u64 count = 1;
+		while (first+count < sample_count && stacks[first+count].hash == stacks[first].hash
+		       && strings_match(line, (string){stacks[first+count].length, (u8*)lines.buffer+stacks[first+count].offset})) {
+			count += 1;
+		}
+		string_builder_print(&output, "%s %llu\n", line, count);
+		first += count;
+	}
+
+	bool ok = os_write_entire_file(path, output.result);
+	if (!ok) log_error("Could not write sampling profile to '%s'", path);
+
+	for (u64 i = 0; i < unique_count; i++) dealloc_string(heap, names[i]);
+	dealloc(heap, names);
+	dealloc(heap, addresses);
+	dealloc(heap, help);
+	dealloc(heap, stacks);
+	dealloc(heap, stacks_help);
+	dealloc(heap, lines.buffer);
+	dealloc(heap, output.buffer);
+
+	return ok;
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -0,0 +1,485 @@
+
+/*
+	Baked sprite atlases.
+
+	Loading every sprite as its own png means one file read, one decode and one texture upload
+	per sprite. Instead, a directory of pngs can be packed offline into one .atlas file:
+
+		bake_sprite_atlas(STR("res/sprites"), STR("res/sprites.atlas"));
+
+	(build_atlas_baker.c is a small command line tool that does just that.)
+
+	At runtime the whole file is read once and each page is uploaded once, straight from the
+	file, nothing is decoded:
+
+		Sprite_Atlas sprites;
+		sprite_atlas_load(&sprites, STR("res/sprites.atlas"), get_heap_allocator());
+		Gfx_Image *player = sprite_atlas_get(&sprites, STR("player")); // "player.png"
+		draw_image(player, pos, size, COLOR_WHITE);
+
+	The images returned by sprite_atlas_get live in the atlas pages (see gfx_atlas.c), so they
+	draw & batch like any other image. Look them up once and keep the pointer, the lookup is a
+	binary search over name hashes. Don't delete_image() them, sprite_atlas_unload() does that.
+
+	File layout, all offsets from the start of the file:
+
+		Sprite_Atlas_File_Header
+		Sprite_Atlas_File_Page[page_count]
+		Sprite_Atlas_Sprite[sprite_count]    sorted by name_hash
+		names                                not null terminated
+		pixels of each page                  4 channels, bottom row first, 16 byte aligned
+*/
+
+#define SPRITE_ATLAS_MAGIC 0x5441474f // "OGAT"
+#define SPRITE_ATLAS_VERSION 1
+
+typedef struct Sprite_Atlas_File_Header {
+	u32 magic;
+	u32 version;
+	u32 page_count;
+	u32 sprite_count;
+	u64 names_offset;
+	u64 names_size;
+} Sprite_Atlas_File_Header;
+
+typedef struct Sprite_Atlas_File_Page {
+	u32 width, height;
+	u64 pixels_offset;
+} Sprite_Atlas_File_Page;
+
+// #Volatile on disk, no implicit padding
+typedef struct Sprite_Atlas_Sprite {
+	u64 name_hash;
+	u32 name_offset, name_length;
+	u32 page;
+	u32 x, y, width, height; // Pixel rect in the page, without padding
+	float32 pivot_x, pivot_y; // 0..1 over the sprite
+	u32 reserved;
+} Sprite_Atlas_Sprite;
+
+typedef struct Sprite_Atlas {
+	Allocator allocator;
+	u64 page_count;
+	u64 sprite_count;
+	Gfx_Atlas_Page *pages;
+	Sprite_Atlas_Sprite *sprites;
+	Gfx_Image *images; // One per sprite, same order as sprites
+	char *names;
+	u64 names_size;
+} Sprite_Atlas;
+
+typedef struct Sprite_Atlas_Bake_Image {
+	string name;
+	u32 width, height;
+	u8 *pixels; // 4 channels, bottom row first like load_image_from_disk
+	Vector2 pivot;
+} Sprite_Atlas_Bake_Image;
+
+u64 ogb_instance
+sprite_atlas_hash_name(string name);
+
+bool ogb_instance
+bake_sprite_atlas_from_images(Sprite_Atlas_Bake_Image *images, u64 image_count, string output_path);
+
+// Bakes every .png directly in directory, sprites are named by the file name without ".png"
+bool ogb_instance
+bake_sprite_atlas(string directory, string output_path);
+
+bool ogb_instance
+sprite_atlas_load(Sprite_Atlas *atlas, string path, Allocator allocator);
+
+void ogb_instance
+sprite_atlas_unload(Sprite_Atlas *atlas);
+
+// Index into atlas->sprites & atlas->images, -1 if there is no such sprite
+s64 ogb_instance
+sprite_atlas_find(Sprite_Atlas *atlas, string name);
+
+Gfx_Image * ogb_instance
+sprite_atlas_get(Sprite_Atlas *atlas, string name);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+u64 sprite_atlas_hash_name(string name) {
+	// #Volatile stored in baked files
+	return djb2_hash(name);
+}
+
+int _sprite_atlas_compare_bake_order(const void *a, const void *b) {
+	Sprite_Atlas_Bake_Image *image_a = *(Sprite_Atlas_Bake_Image**)a;
+	Sprite_Atlas_Bake_Image *image_b = *(Sprite_Atlas_Bake_Image**)b;
+	if (image_a->height != image_b->height) return image_a->height > image_b->height ? -1 : 1;
+	if (image_a->width  != image_b->width)  return image_a->width  > image_b->width  ? -1 : 1;
+	return 0;
+}
+int _sprite_atlas_compare_sprites(const void *a, const void *b) {
+	u64 hash_a = ((Sprite_Atlas_Sprite*)a)->name_hash;
+	u64 hash_b = ((Sprite_Atlas_Sprite*)b)->name_hash;
+	return hash_a < hash_b ? -1 : (hash_a > hash_b ? 1 : 0);
+}
+
+// Copies the image to x, y in the page and repeats the edges into the padding
+// #Volatile assumes GFX_ATLAS_PADDING 1
+void _sprite_atlas_blit(u8 *page_pixels, u32 page_width, u32 x, u32 y, Sprite_Atlas_Bake_Image *image) {
+	u64 stride = image->width*4;
+	for (s64 r = -1; r <= (s64)image->height; r++) {
+		s64 src_row = clamp(r, 0, (s64)image->height-1);
+		u8 *src = image->pixels + src_row*stride;
+		u8 *dst = page_pixels + ((y+r)*page_width + x)*4;
+		memcpy(dst, src, stride);
+		memcpy(dst-4, src, 4);
+		memcpy(dst+stride, src+stride-4, 4);
+	}
+}
+
+bool bake_sprite_atlas_from_images(Sprite_Atlas_Bake_Image *images, u64 image_count, string output_path) {
+	// #Memory #Heapalloc
+	Allocator allocator = get_heap_allocator();
+
+	for (u64 i = 0; i < image_count; i++) {
+		Sprite_Atlas_Bake_Image *image = &images[i];
+		if (image->width == 0 || image->height == 0 || !image->pixels) {
+			log_error("Sprite '%s' has no pixels", image->name);
+			return false;
+		}
+		if (image->width+GFX_ATLAS_PADDING*2 > GFX_ATLAS_PAGE_SIZE || image->height+GFX_ATLAS_PADDING*2 > GFX_ATLAS_PAGE_SIZE) {
+			log_error("Sprite '%s' is %ux%u, which doesn't fit in a %i pixel atlas page", image->name, image->width, image->height, GFX_ATLAS_PAGE_SIZE);
+			return false;
+		}
+	}
+
+	// Tallest first, that's what skyline packing does best with
+	Sprite_Atlas_Bake_Image **order = alloc(allocator, max(image_count, 1)*sizeof(Sprite_Atlas_Bake_Image*)*2);
+	for (u64 i = 0; i < image_count; i++) order[i] = &images[i];
+	merge_sort(order, order+image_count, image_count, sizeof(Sprite_Atlas_Bake_Image*), _sprite_atlas_compare_bake_order);
+
+	Sprite_Atlas_Sprite *sprites = alloc(allocator, max(image_count, 1)*sizeof(Sprite_Atlas_Sprite));
+	memset(sprites, 0, max(image_count, 1)*sizeof(Sprite_Atlas_Sprite));
+
+	u64 page_capacity = 4;
+	u64 page_count = 0;
+	Gfx_Atlas_Page *pages = alloc(allocator, page_capacity*sizeof(Gfx_Atlas_Page));
+	Sprite_Atlas_File_Page *file_pages = alloc(allocator, page_capacity*sizeof(Sprite_Atlas_File_Page));
+
+	u64 names_size = 0;
+	for (u64 i = 0; i < image_count; i++) {
+		Sprite_Atlas_Bake_Image *image = order[i];
+		u32 w = image->width+GFX_ATLAS_PADDING*2;
+		u32 h = image->height+GFX_ATLAS_PADDING*2;
+
+		u64 page = page_count;
+		u32 x = 0, y = 0;
+		u64 node = 0;
+		for (u64 p = 0; p < page_count; p++) {
+			if (_gfx_atlas_page_find(&pages[p], w, h, &x, &y, &node)) {
+				page = p;
+				break;
+			}
+		}
+
+		if (page == page_count) {
+			if (page_count >= page_capacity) {
+				u64 new_capacity = page_capacity*2;
+				Gfx_Atlas_Page *new_pages = alloc(allocator, new_capacity*sizeof(Gfx_Atlas_Page));
+				Sprite_Atlas_File_Page *new_file_pages = alloc(allocator, new_capacity*sizeof(Sprite_Atlas_File_Page));
+				memcpy(new_pages, pages, page_count*sizeof(Gfx_Atlas_Page));
+				memcpy(new_file_pages, file_pages, page_count*sizeof(Sprite_Atlas_File_Page));
+				dealloc(allocator, pages);
+				dealloc(allocator, file_pages);
+				pages = new_pages;
+				file_pages = new_file_pages;
+				page_capacity = new_capacity;
+			}
+			page_count += 1;
+			pages[page] = ZERO(Gfx_Atlas_Page);
+			pages[page].skyline = alloc(allocator, (GFX_ATLAS_PAGE_SIZE+1)*sizeof(Gfx_Atlas_Skyline_Node));
+			_gfx_atlas_page_reset(&pages[page]);
+			file_pages[page] = ZERO(Sprite_Atlas_File_Page);
+
+			bool ok = _gfx_atlas_page_find(&pages[page], w, h, &x, &y, &node);
+			assert(ok, "Internal atlas error: sprite didn't fit in an empty page");
+		}
+
+		_gfx_atlas_page_insert(&pages[page], node, x, y, w, h);
+
+		// Pages are cropped to what is used
+		file_pages[page].width  = max(file_pages[page].width,  x+w);
+		file_pages[page].height = max(file_pages[page].height, y+h);
+
+		Sprite_Atlas_Sprite *sprite = &sprites[i];
+		sprite->name_hash   = sprite_atlas_hash_name(image->name);
+		sprite->name_offset = (u32)names_size;
+		sprite->name_length = (u32)image->name.count;
+		sprite->page        = (u32)page;
+		sprite->x           = x+GFX_ATLAS_PADDING;
+		sprite->y           = y+GFX_ATLAS_PADDING;
+		sprite->width       = image->width;
+		sprite->height      = image->height;
+		sprite->pivot_x     = image->pivot.x;
+		sprite->pivot_y     = image->pivot.y;
+		names_size += image->name.count;
+	}
+
+	u64 pages_offset   = sizeof(Sprite_Atlas_File_Header);
+	u64 sprites_offset = pages_offset+page_count*sizeof(Sprite_Atlas_File_Page);
+	u64 names_offset   = sprites_offset+image_count*sizeof(Sprite_Atlas_Sprite);
+	u64 file_size      = (names_offset+names_size+15) & ~15ull;
+	for (u64 p = 0; p < page_count; p++) {
+		file_pages[p].pixels_offset = file_size;
+		file_size = (file_size + (u64)file_pages[p].width*file_pages[p].height*4 + 15) & ~15ull;
+	}
+
+	u8 *file = alloc(allocator, file_size);
+	memset(file, 0, file_size);
+
+	for (u64 i = 0; i < image_count; i++) {
+		Sprite_Atlas_Sprite *sprite = &sprites[i];
+		Sprite_Atlas_File_Page *page = &file_pages[sprite->page];
+		_sprite_atlas_blit(file+page->pixels_offset, page->width, sprite->x, sprite->y, order[i]);
+		memcpy(file+names_offset+sprite->name_offset, order[i]->name.data, sprite->name_length);
+	}
+
+	Sprite_Atlas_Sprite *sort_help = alloc(allocator, max(image_count, 1)*sizeof(Sprite_Atlas_Sprite));
+	merge_sort(sprites, sort_help, image_count, sizeof(Sprite_Atlas_Sprite), _sprite_atlas_compare_sprites);
+	dealloc(allocator, sort_help);
+
+	bool ok = true;
+	for (u64 i = 1; i < image_count; i++) {
+		if (sprites[i].name_hash == sprites[i-1].name_hash) {
+			string a = (string){sprites[i-1].name_length, file+names_offset+sprites[i-1].name_offset};
+			string b = (string){sprites[i].name_length,   file+names_offset+sprites[i].name_offset};
+			log_error("Sprite names '%s' and '%s' are duplicates or have the same hash, rename one of them", a, b);
+			ok = false;
+		}
+	}
+
+	if (ok) {
+		Sprite_Atlas_File_Header *header = (Sprite_Atlas_File_Header*)file;
+		header->magic        = SPRITE_ATLAS_MAGIC;
+		header->version      = SPRITE_ATLAS_VERSION;
+		header->page_count   = (u32)page_count;
+		header->sprite_count = (u32)image_count;
+		header->names_offset = names_offset;
+		header->names_size   = names_size;
+		memcpy(file+pages_offset, file_pages, page_count*sizeof(Sprite_Atlas_File_Page));
+		memcpy(file+sprites_offset, sprites, image_count*sizeof(Sprite_Atlas_Sprite));
+
+		ok = os_write_entire_file(output_path, (string){file_size, file});
+		if (ok) {
+			log_info("Baked %llu sprites into %llu atlas pages in '%s' (%llu bytes)", image_count, page_count, output_path, file_size);
+		} else {
+			log_error("Could not write sprite atlas to '%s'", output_path);
+		}
+	}
+
+	for (u64 p = 0; p < page_count; p++) dealloc(allocator, pages[p].skyline);
+	dealloc(allocator, file);
+	dealloc(allocator, pages);
+	dealloc(allocator, file_pages);
+	dealloc(allocator, sprites);
+	dealloc(allocator, order);
+
+	return ok;
+}
+
+bool bake_sprite_atlas(string directory, string output_path) {
+	// #Memory #Heapalloc
+	Allocator allocator = get_heap_allocator();
+
+	string *file_names;
+	u64 file_count;
+	if (!os_get_file_names_in_directory(directory, &file_names, &file_count, allocator)) {
+		log_error("Could not list files in '%s'", directory);
+		return false;
+	}
+
+	Sprite_Atlas_Bake_Image *images = alloc(allocator, max(file_count, 1)*sizeof(Sprite_Atlas_Bake_Image));
+	u64 image_count = 0;
+
+	stbi_set_flip_vertically_on_load(1);
+	third_party_allocator = allocator;
+
+	bool ok = true;
+	for (u64 i = 0; i < file_count; i++) {
+		string name = file_names[i];
+		if (name.count <= 4 || !strings_match(string_view(name, name.count-4, 4), STR(".png"))) continue;
+
+		string path = tprint("%s/%s", directory, name);
+		string png;
+		if (!os_read_entire_file(path, &png, allocator)) {
+			log_error("Could not read '%s'", path);
+			ok = false;
+			break;
+		}
+
+		int width, height, channels;
+		u8 *pixels = stbi_load_from_memory(png.data, png.count, &width, &height, &channels, STBI_rgb_alpha);
+		dealloc_string(allocator, png);
+		if (!pixels) {
+			log_error("Could not decode '%s'", path);
+			ok = false;
+			break;
+		}
+
+		Sprite_Atlas_Bake_Image *image = &images[image_count];
+		image_count += 1;
+		image->name   = string_view(name, 0, name.count-4);
+		image->width  = width;
+		image->height = height;
+		image->pixels = pixels;
+		image->pivot  = v2(0.5, 0.5);
+	}
+
+	if (ok) ok = bake_sprite_atlas_from_images(images, image_count, output_path);
+
+	for (u64 i = 0; i < image_count; i++) stbi_image_free(images[i].pixels);
+	third_party_allocator = ZERO(Allocator);
+
+	for (u64 i = 0; i < file_count; i++) dealloc_string(allocator, file_names[i]);
+	dealloc(allocator, file_names);
+	dealloc(allocator, images);
+
+	return ok;
+}
+
+bool _sprite_atlas_file_is_valid(string file) {
+	if (file.count < sizeof(Sprite_Atlas_File_Header)) return false;
+	Sprite_Atlas_File_Header *header = (Sprite_Atlas_File_Header*)file.data;
+	if (header->magic != SPRITE_ATLAS_MAGIC || header->version != SPRITE_ATLAS_VERSION) return false;
+
+	u64 pages_end   = sizeof(Sprite_Atlas_File_Header) + (u64)header->page_count*sizeof(Sprite_Atlas_File_Page);
+	u64 sprites_end = pages_end + (u64)header->sprite_count*sizeof(Sprite_Atlas_Sprite);
+	if (sprites_end > file.count) return false;
+	if (header->names_offset < sprites_end || header->names_offset+header->names_size > file.count) return false;
+
+	Sprite_Atlas_File_Page *pages = (Sprite_Atlas_File_Page*)(file.data+sizeof(Sprite_Atlas_File_Header));
+	for (u64 i = 0; i < header->page_count; i++) {
+		if (pages[i].width == 0 || pages[i].height == 0) return false;
+		if (pages[i].pixels_offset+(u64)pages[i].width*pages[i].height*4 > file.count) return false;
+	}
+
+	Sprite_Atlas_Sprite *sprites = (Sprite_Atlas_Sprite*)(file.data+pages_end);
+	for (u64 i = 0; i < header->sprite_count; i++) {
+		Sprite_Atlas_Sprite *s = &sprites[i];
+		if (s->page >= header->page_count) return false;
+		if ((u64)s->x+s->width > pages[s->page].width || (u64)s->y+s->height > pages[s->page].height) return false;
+		if ((u64)s->name_offset+s->name_length > header->names_size) return false;
+		if (i > 0 && sprites[i-1].name_hash > s->name_hash) return false;
+	}
+
+	return true;
+}
+
+bool sprite_atlas_load(Sprite_Atlas *atlas, string path, Allocator allocator) {
+	*atlas = ZERO(Sprite_Atlas);
+
+	string file;
+	if (!os_read_entire_file(path, &file, allocator)) {
+		log_error("Could not read sprite atlas '%s'", path);
+		return false;
+	}
+	if (!_sprite_atlas_file_is_valid(file)) {
+		log_error("'%s' is not a sprite atlas, or was baked with another version", path);
+		dealloc_string(allocator, file);
+		return false;
+	}
+
+	Sprite_Atlas_File_Header *header = (Sprite_Atlas_File_Header*)file.data;
+	Sprite_Atlas_File_Page *file_pages = (Sprite_Atlas_File_Page*)(file.data+sizeof(Sprite_Atlas_File_Header));
+	Sprite_Atlas_Sprite *file_sprites = (Sprite_Atlas_Sprite*)(file_pages+header->page_count);
+
+	atlas->allocator    = allocator;
+	atlas->page_count   = header->page_count;
+	atlas->sprite_count = header->sprite_count;
+	atlas->names_size   = header->names_size;
+	atlas->pages   = alloc(allocator, max(atlas->page_count,   1)*sizeof(Gfx_Atlas_Page));
+	atlas->sprites = alloc(allocator, max(atlas->sprite_count, 1)*sizeof(Sprite_Atlas_Sprite));
+	atlas->images  = alloc(allocator, max(atlas->sprite_count, 1)*sizeof(Gfx_Image));
+	atlas->names   = alloc(allocator, max(atlas->names_size,   1));
+	memcpy(atlas->sprites, file_sprites, atlas->sprite_count*sizeof(Sprite_Atlas_Sprite));
+	memcpy(atlas->names, file.data+header->names_offset, atlas->names_size);
+
+	for (u64 i = 0; i < atlas->page_count; i++) {
+		// Not make_image(), a small page would be put in the runtime atlas
+		Gfx_Image *image = alloc(allocator, sizeof(Gfx_Image));
+		*image = ZERO(Gfx_Image);
+		image->width      = file_pages[i].width;
+		image->height     = file_pages[i].height;
+		image->channels   = 4;
+		image->allocator  = allocator;
+		image->gfx_handle = GFX_INVALID_HANDLE;
+		gfx_init_image(image, file.data+file_pages[i].pixels_offset);
+
+		atlas->pages[i] = ZERO(Gfx_Atlas_Page);
+		atlas->pages[i].image = image;
+	}
+
+	for (u64 i = 0; i < atlas->sprite_count; i++) {
+		Sprite_Atlas_Sprite *sprite = &atlas->sprites[i];
+		Gfx_Atlas_Page *page = &atlas->pages[sprite->page];
+		float32 page_width  = (float32)page->image->width;
+		float32 page_height = (float32)page->image->height;
+		page->image_count += 1;
+
+		Gfx_Image *image = &atlas->images[i];
+		*image = ZERO(Gfx_Image);
+		image->width       = sprite->width;
+		image->height      = sprite->height;
+		image->channels    = 4;
+		image->allocator   = allocator;
+		image->gfx_handle  = page->image->gfx_handle;
+		image->atlas_page  = page;
+		image->atlas_x     = sprite->x;
+		image->atlas_y     = sprite->y;
+		image->atlas_uv.x1 = (float32)sprite->x/page_width;
+		image->atlas_uv.y1 = (float32)sprite->y/page_height;
+		image->atlas_uv.x2 = (float32)(sprite->x+sprite->width)/page_width;
+		image->atlas_uv.y2 = (float32)(sprite->y+sprite->height)/page_height;
+	}
+
+	dealloc_string(allocator, file);
+
+	log_verbose("Loaded %llu sprites in %llu pages from '%s'", atlas->sprite_count, atlas->page_count, path);
+
+	return true;
+}
+
+void sprite_atlas_unload(Sprite_Atlas *atlas) {
+	Allocator allocator = atlas->allocator;
+	for (u64 i = 0; i < atlas->page_count; i++) {
+		delete_image(atlas->pages[i].image);
+	}
+	if (atlas->pages)   dealloc(allocator, atlas->pages);
+	if (atlas->sprites) dealloc(allocator, atlas->sprites);
+	if (atlas->images)  dealloc(allocator, atlas->images);
+	if (atlas->names)   dealloc(allocator, atlas->names);
+	*atlas = ZERO(Sprite_Atlas);
+}
+
+s64 sprite_atlas_find(Sprite_Atlas *atlas, string name) {
+	u64 hash = sprite_atlas_hash_name(name);
+
+	u64 low = 0;
+	u64 high = atlas->sprite_count;
+	while (low < high) {
+		u64 middle = low + (high-low)/2;
+		if (atlas->sprites[middle].name_hash < hash) low = middle+1;
+		else                                         high = middle;
+	}
+
+	if (low >= atlas->sprite_count || atlas->sprites[low].name_hash != hash) return -1;
+
+	Sprite_Atlas_Sprite *sprite = &atlas->sprites[low];
+	string sprite_name = (string){sprite->name_length, (u8*)atlas->names+sprite->name_offset};
+	if (!strings_match(name, sprite_name)) return -1;
+
+	return (s64)low;
+}
+
+Gfx_Image *sprite_atlas_get(Sprite_Atlas *atlas, string name) {
+	s64 index = sprite_atlas_find(atlas, name);
+	if (index < 0) return 0;
+	return &atlas->images[index];
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -0,0 +1,168 @@
+
+/*
+	Static batches.
+
+	Tile maps, backgrounds and anything else that looks the same every frame doesn't need to be
+	transformed, culled and batched again every frame. Record it once:
+
+		Static_Batch tiles = ZERO(Static_Batch);
+		static_batch_begin(&tiles);
+		for (...) draw_image(tile_image, tile_pos, tile_size, COLOR_WHITE);
+		static_batch_end(&tiles);
+
+	and draw the whole batch every frame:
+
+		draw_static_batch(&tiles);
+
+	Everything drawn between begin & end goes into the batch instead of the frame. It's kept in
+	world space: the frame's view & projection are not applied and nothing is culled. z layers
+	sort the quads within the batch. draw_static_batch() takes the current view & projection, which the
+	renderer applies in the vertex shader, so moving the camera is free. The instances are
+	uploaded once and kept on the GPU until the batch is recorded again.
+
+	Things to know:
+		- Static batches are drawn under the quads of the frame, in the order they were drawn.
+		  z layers don't sort a batch against the frame, a batch is under a frame quad at any z.
+		- Scissors are in window pixels, so quads with a scissor can't be recorded.
+		- Text is not snapped to pixels, since the batch doesn't know where it ends up on screen.
+		- A batch is culled as a whole, by the bounds of everything in it.
+		- Nothing is tracked. If an image in the batch is deleted, or the batch should look
+		  different, record it again, or static_batch_clear() it.
+		- The batch must stay alive until the frame it is drawn in has been rendered. Ending,
+		  clearing & destroying a batch waits for the render thread (gfx_render_thread.c).
+*/
+
+typedef struct Static_Batch {
+	Gfx_Batch batch; // Instance corners are in world space
+	Vector2 bounds_min, bounds_max;
+	u64 version; // Bumped whenever the contents change
+
+	// Renderer's copy of the instances, uploaded again when gpu_version != version
+	void *gpu_data;
+	u64 gpu_version;
+
+	// While recording
+	bool recording;
+	u64 first_quad;
+	Matrix4 frame_projection;
+	Matrix4 frame_view;
+} Static_Batch;
+
+// Implemented per renderer, frees gpu_data
+ogb_instance void
+gfx_release_static_batch(Static_Batch *sb);
+
+// Draws after this go into the batch, replacing what was in it. Recorded quads can't be
+// scissored, their text isn't pixel snapped, and the batch is drawn under every frame quad no
+// matter the z layer.
+ogb_instance void
+static_batch_begin(Static_Batch *sb);
+
+ogb_instance void
+static_batch_end(Static_Batch *sb);
+
+ogb_instance void
+static_batch_clear(Static_Batch *sb);
+
+ogb_instance void
+static_batch_destroy(Static_Batch *sb);
+
+// Returns false if the batch was empty or culled
+ogb_instance bool
+draw_static_batch(Static_Batch *sb);
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+
+void static_batch_begin(Static_Batch *sb) {
+	assert(!sb->recording, "Static batch is already being recorded");
+	assert(!draw_frame._disable_culling, "Only one static batch can be recorded at a time");
+
+	sb->recording = true;
+	sb->first_quad = draw_frame.num_quads;
+	sb->frame_projection = draw_frame.projection;
+	sb->frame_view = draw_frame.view;
+
+	draw_frame.projection = m4_scalar(1.0);
+	draw_frame.view = m4_scalar(1.0);
+	draw_frame._disable_culling = true;
+}
+
+void static_batch_end(Static_Batch *sb) {
+	assert(sb->recording, "static_batch_end() without static_batch_begin()");
+	assert(draw_frame._disable_culling && draw_frame.num_quads >= sb->first_quad, "The draw frame was reset while recording a static batch");
+
+	Draw_Quad *quads = quad_buffer+sb->first_quad;
+	u64 quad_count = draw_frame.num_quads-sb->first_quad;
+
+	// The frame in flight might be drawing the old contents
+	gfx_render_thread_wait();
+
+	sb->bounds_min = v2(0, 0);
+	sb->bounds_max = v2(0, 0);
+	if (quad_count > 0) {
+		sb->bounds_min = quads[0].bottom_left;
+		sb->bounds_max = quads[0].bottom_left;
+	}
+	for (u64 i = 0; i < quad_count; i++) {
+		assert(!quads[i].scissor, "Quads with a window scissor can't be recorded into a static batch");
+		Vector2 *corners = &quads[i].bottom_left;
+		for (u64 c = 0; c < 4; c++) {
+			sb->bounds_min.x = min(sb->bounds_min.x, corners[c].x);
+			sb->bounds_min.y = min(sb->bounds_min.y, corners[c].y);
+			sb->bounds_max.x = max(sb->bounds_max.x, corners[c].x);
+			sb->bounds_max.y = max(sb->bounds_max.y, corners[c].y);
+		}
+	}
+	// World space, no pixel snapping or scissors
+	gfx_batch_build(&sb->batch, quads, quad_count, 0, true, 0, 0);
+	sb->version += 1;
+
+	// The recorded quads are not part of the frame
+	draw_frame.num_quads = sb->first_quad;
+	draw_frame.projection = sb->frame_projection;
+	draw_frame.view = sb->frame_view;
+	draw_frame._disable_culling = false;
+	sb->recording = false;
+}
+
+void static_batch_clear(Static_Batch *sb) {
+	assert(!sb->recording, "Can't clear a static batch while recording it");
+	gfx_render_thread_wait();
+	sb->batch.instance_count = 0;
+	sb->batch.draw_call_count = 0;
+	sb->version += 1;
+}
+
+void static_batch_destroy(Static_Batch *sb) {
+	assert(!sb->recording, "Can't destroy a static batch while recording it");
+	gfx_render_thread_wait();
+	gfx_release_static_batch(sb);
+	gfx_batch_destroy(&sb->batch);
+	*sb = ZERO(Static_Batch);
+}
+
+bool draw_static_batch(Static_Batch *sb) {
+	assert(!sb->recording, "Can't draw a static batch while recording it");
+	assert(!draw_frame._disable_culling, "Static batches can't be drawn into other static batches");
+	assert(draw_frame.static_batch_draw_count < MAX_STATIC_BATCH_DRAWS, "Too many static batches drawn this frame, max is %d", MAX_STATIC_BATCH_DRAWS);
+
+	if (sb->batch.instance_count == 0) return false;
+
+	Matrix4 world_to_clip = get_world_to_clip();
+
+	// Cull the bounds like a quad
+	Draw_Quad bounds;
+	bounds.bottom_left  = sb->bounds_min;
+	bounds.top_left     = v2(sb->bounds_min.x, sb->bounds_max.y);
+	bounds.top_right    = sb->bounds_max;
+	bounds.bottom_right = v2(sb->bounds_max.x, sb->bounds_min.y);
+	if (!_project_quad_corners(&bounds, world_to_clip)) return false;
+
+	Static_Batch_Draw *d = &draw_frame.static_batch_draws[draw_frame.static_batch_draw_count];
+	draw_frame.static_batch_draw_count += 1;
+	d->batch = sb;
+	d->world_to_clip = world_to_clip;
+	return true;
+}
+
+#endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -904,6 +904,16 @@ void test_linmath() {
         }
     }
     
+    // Test 2D matrix multiplication & translation against the full versions
+    Matrix4 world_to_clip = m4_mul(m4_make_orthographic_projection(-16, 16, -9, 9, -1, 10), m4_inverse(m4_make_translation(v3(3, -2, 0))));
+    Matrix4 xform = m4_rotate_z(m4_make_translation(v3(5, 7, 0)), 0.7f);
+    Matrix4 full_2d = m4_translate(m4_mul(world_to_clip, xform), v3(2, 3, 0));
+    Matrix4 fast_2d = m4_translate_2d(m4_mul_2d(world_to_clip, xform), v2(2, 3));
+    Vector4 full_point = m4_transform(full_2d, v4(1, 1, 0, 1));
+    Vector4 fast_point = m4_transform(fast_2d, v4(1, 1, 0, 1));
+    assert(fabs(full_point.x-fast_point.x) < 1e-5 && fabs(full_point.y-fast_point.y) < 1e-5, "m4_mul_2d or m4_translate_2d incorrect");
+    assert(fast_2d.m[2][2] == 1.0f && fast_2d.m[3][3] == 1.0f && fast_2d.m[2][0] == 0.0f, "m4_mul_2d should leave z & w rows as identity");
+    
     // Test Vector2 creation
     Vector2 v2_test1 = v2(1.0f, 2.0f);
     assert(v2_test1.x == 1.0f && v2_test1.y == 2.0f, "Vector2 creation failed");
@@ -1090,11 +1100,171 @@ void test_random_distribution() {
     print("Min: %d, max: %d\n", min_bin, max_bin);
 }
 
+#define ATOMICS_TEST_THREAD_COUNT 8
+#define ATOMICS_TEST_ITERATIONS 10000
+typedef struct Atomics_Test_Shared_Data {
+	volatile u64 counter;
+	volatile u32 bits;
+	volatile u8 small_counter;
+} Atomics_Test_Shared_Data;
+void atomics_test_thread(Thread *t) {
+	Atomics_Test_Shared_Data *data = (Atomics_Test_Shared_Data*)t->data;
+	u32 bit = 1u << (t->id % 32);
+	for (int i = 0; i < ATOMICS_TEST_ITERATIONS; i++) {
+		atomic_fetch_add_64(&data->counter, 3);
+		atomic_fetch_sub_64(&data->counter, 1);
+		atomic_fetch_add_8(&data->small_counter, 1);
+		atomic_fetch_or_32(&data->bits, bit);
+	}
+}
+void test_atomics() {
+	volatile u8  a8  = 0;
+	volatile u16 a16 = 0;
+	volatile u32 a32 = 0;
+	volatile u64 a64 = 0;
+	
+	atomic_store_8 (&a8,  200, MEMORY_ORDER_RELAXED);
+	atomic_store_16(&a16, 60000, MEMORY_ORDER_RELEASE);
+	atomic_store_32(&a32, 0xF0F0F0F0, MEMORY_ORDER_SEQ_CST);
+	atomic_store_64(&a64, 0xFFFFFFFF00000000ull, MEMORY_ORDER_SEQ_CST);
+	assert(atomic_load_8 (&a8,  MEMORY_ORDER_RELAXED) == 200, "Failed: atomic_load_8");
+	assert(atomic_load_16(&a16, MEMORY_ORDER_ACQUIRE) == 60000, "Failed: atomic_load_16");
+	assert(atomic_load_32(&a32, MEMORY_ORDER_SEQ_CST) == 0xF0F0F0F0, "Failed: atomic_load_32");
+	assert(atomic_load_64(&a64, MEMORY_ORDER_ACQUIRE) == 0xFFFFFFFF00000000ull, "Failed: atomic_load_64");
+	
+	// All return the previous value
+	assert(atomic_fetch_add_8(&a8, 100) == 200 && a8 == 44, "Failed: atomic_fetch_add_8 should wrap");
+	assert(atomic_fetch_sub_16(&a16, 1) == 60000 && a16 == 59999, "Failed: atomic_fetch_sub_16");
+	assert(atomic_fetch_and_32(&a32, 0xFF00FF00) == 0xF0F0F0F0 && a32 == 0xF000F000, "Failed: atomic_fetch_and_32");
+	assert(atomic_fetch_or_32(&a32, 0x0F) == 0xF000F000 && a32 == 0xF000F00F, "Failed: atomic_fetch_or_32");
+	assert(atomic_fetch_xor_32(&a32, 0xF000F00F) == 0xF000F00F && a32 == 0, "Failed: atomic_fetch_xor_32");
+	assert(atomic_exchange_64(&a64, 69) == 0xFFFFFFFF00000000ull && a64 == 69, "Failed: atomic_exchange_64");
+	assert(atomic_fetch_add_64(&a64, 1) == 69 && a64 == 70, "Failed: atomic_fetch_add_64");
+	
+	int x = 5, y = 6;
+	void *volatile p = &x;
+	assert(atomic_load_pointer(&p, MEMORY_ORDER_ACQUIRE) == &x, "Failed: atomic_load_pointer");
+	assert(atomic_exchange_pointer(&p, &y) == &x && p == &y, "Failed: atomic_exchange_pointer");
+	assert(!compare_and_swap_pointer(&p, &x, &x) && p == &y, "Failed: compare_and_swap_pointer should fail");
+	assert(compare_and_swap_pointer(&p, &x, &y) && p == &x, "Failed: compare_and_swap_pointer should succeed");
+	atomic_store_pointer(&p, 0, MEMORY_ORDER_RELEASE);
+	assert(p == 0, "Failed: atomic_store_pointer");
+	
+	// Contended
+	Atomics_Test_Shared_Data data = {0};
+	Thread threads[ATOMICS_TEST_THREAD_COUNT];
+	for (int i = 0; i < ATOMICS_TEST_THREAD_COUNT; i++) {
+		os_thread_init(&threads[i], atomics_test_thread);
+		threads[i].data = &data;
+		os_thread_start(&threads[i]);
+	}
+	u32 expected_bits = 0;
+	for (int i = 0; i < ATOMICS_TEST_THREAD_COUNT; i++) {
+		os_thread_join(&threads[i]);
+		expected_bits |= 1u << (threads[i].id % 32);
+		os_thread_destroy(&threads[i]);
+	}
+	assert(data.counter == ATOMICS_TEST_THREAD_COUNT*ATOMICS_TEST_ITERATIONS*2, "Failed: lost atomic increments");
+	assert(data.small_counter == (u8)(ATOMICS_TEST_THREAD_COUNT*ATOMICS_TEST_ITERATIONS), "Failed: lost 8 bit atomic increments");
+	assert(data.bits == expected_bits, "Failed: lost atomic or");
+}
+
+#define SPINLOCK_TEST_ITERATIONS 20000
+typedef struct Spinlock_Test_Shared_Data {
+	Spinlock spinlock;
+	Ticket_Lock ticket_lock;
+	bool naive_lock;
+	u64 counter;
+	volatile bool go;
+} Spinlock_Test_Shared_Data;
+void spinlock_test_spinlock(Thread *t) {
+	Spinlock_Test_Shared_Data *data = (Spinlock_Test_Shared_Data*)t->data;
+	while (!data->go) cpu_pause();
+	for (int i = 0; i < SPINLOCK_TEST_ITERATIONS; i++) {
+		spinlock_acquire_or_wait(&data->spinlock);
+		data->counter += 1;
+		spinlock_release(&data->spinlock);
+	}
+}
+void spinlock_test_ticket_lock(Thread *t) {
+	Spinlock_Test_Shared_Data *data = (Spinlock_Test_Shared_Data*)t->data;
+	while (!data->go) cpu_pause();
+	for (int i = 0; i < SPINLOCK_TEST_ITERATIONS; i++) {
+		ticket_lock_acquire_or_wait(&data->ticket_lock);
+		data->counter += 1;
+		ticket_lock_release(&data->ticket_lock);
+	}
+}
+void spinlock_test_naive(Thread *t) {
+	// What Spinlock used to be: cas in a tight loop, no backoff
+	Spinlock_Test_Shared_Data *data = (Spinlock_Test_Shared_Data*)t->data;
+	while (!data->go) cpu_pause();
+	for (int i = 0; i < SPINLOCK_TEST_ITERATIONS; i++) {
+		while (!compare_and_swap_bool(&data->naive_lock, true, false)) {
+			while (data->naive_lock) MEMORY_BARRIER;
+		}
+		data->counter += 1;
+		MEMORY_BARRIER;
+		compare_and_swap_bool(&data->naive_lock, false, true);
+	}
+}
+void spinlock_test_run(Thread_Proc proc, Spinlock_Test_Shared_Data *data, int num_threads) {
+	Thread threads[64];
+	assert(num_threads <= 64, "Too many threads for spinlock test");
+	data->counter = 0;
+	data->go = false;
+	for (int i = 0; i < num_threads; i++) {
+		os_thread_init(&threads[i], proc);
+		threads[i].data = data;
+		os_thread_start(&threads[i]);
+	}
+	data->go = true;
+	for (int i = 0; i < num_threads; i++) {
+		os_thread_destroy(&threads[i]);
+	}
+	assert(data->counter == (u64)num_threads*SPINLOCK_TEST_ITERATIONS, "Failed: lock let more than one thread in");
+}
+void test_spinlock() {
+	assert(sizeof(Spinlock) == CACHE_LINE_SIZE, "Failed: Spinlock should fill a cache line");
+	assert(sizeof(Ticket_Lock) == CACHE_LINE_SIZE, "Failed: Ticket_Lock should fill a cache line");
+	
+	Spinlock l;
+	spinlock_init(&l);
+	spinlock_acquire_or_wait(&l);
+	assert(!spinlock_acquire_or_wait_timeout(&l, 0.001), "Failed: Spinlock should time out when held");
+	spinlock_release(&l);
+	assert(spinlock_acquire_or_wait_timeout(&l, 0.001), "Failed: Spinlock should be acquirable");
+	spinlock_release(&l);
+	
+	Ticket_Lock t = {0};
+	ticket_lock_acquire_or_wait(&t);
+	ticket_lock_release(&t);
+	ticket_lock_acquire_or_wait(&t);
+	ticket_lock_release(&t);
+	assert(t.now_serving == 2 && t.next_ticket == 2, "Failed: Ticket lock tickets out of sync");
+	
+	Spinlock_Test_Shared_Data *data = alloc(get_heap_allocator(), sizeof(Spinlock_Test_Shared_Data));
+	memset(data, 0, sizeof(*data));
+	
+	// Don't go above the core count, ticket locks degrade badly when the next in line isn't scheduled
+	u64 max_threads = min(max(os.number_of_logical_processors, 1), 64);
+	for (u64 num_threads = 1; true; num_threads = min(num_threads*2, max_threads)) {
+		spinlock_test_run(spinlock_test_spinlock, data, num_threads);
+		spinlock_test_run(spinlock_test_ticket_lock, data, num_threads);
+		spinlock_test_run(spinlock_test_naive, data, num_threads);
+		if (num_threads == max_threads) break;
+	}
+	
+	dealloc(get_heap_allocator(), data);
+}
+
 #define MUTEX_TEST_TASK_COUNT 1000
 typedef struct Mutex_Test_Shared_Data {
     int counter;
     bool any_active_thread;
     Mutex mutex;
+    Spinlock spinlock;
+    Mutex_Handle os_mutex;
 } Mutex_Test_Shared_Data;
 void mutex_test_increment_counter(Thread* t) {
     Mutex_Test_Shared_Data* data = (Mutex_Test_Shared_Data*)t->data;
@@ -1107,20 +1277,108 @@ void mutex_test_increment_counter(Thread* t) {
         mutex_release(&data->mutex);
     }
 }
+void mutex_test_increment_counter_spinlock(Thread* t) {
+    Mutex_Test_Shared_Data* data = (Mutex_Test_Shared_Data*)t->data;
+    for (int i = 0; i < MUTEX_TEST_TASK_COUNT; i++) {
+        spinlock_acquire_or_wait(&data->spinlock);
+        data->counter++;
+        spinlock_release(&data->spinlock);
+    }
+}
+void mutex_test_increment_counter_os_mutex(Thread* t) {
+    Mutex_Test_Shared_Data* data = (Mutex_Test_Shared_Data*)t->data;
+    for (int i = 0; i < MUTEX_TEST_TASK_COUNT; i++) {
+        os_lock_mutex(data->os_mutex);
+        data->counter++;
+        os_unlock_mutex(data->os_mutex);
+    }
+}
+void mutex_test_run_threads(Thread_Proc proc, Mutex_Test_Shared_Data *data, int num_threads) {
+	Allocator allocator = get_heap_allocator();
+	
+	data->counter = 0;
+	
+	Thread *threads = alloc(allocator, sizeof(Thread)*num_threads);
+	for (u64 i = 0; i < num_threads; i++) {
+		os_thread_init(&threads[i], proc);
+		threads[i].data = data;
+	}
+	
+	for (u64 i = 0; i < num_threads; i++) {
+    	os_thread_start(&threads[i]);
+	}
+	for (u64 i = 0; i < num_threads; i++) {
+    	os_thread_join(&threads[i]);
+	}
+	
+	for (u64 i = 0; i < num_threads; i++) {
+    	os_thread_destroy(&threads[i]);
+	}
+	dealloc(allocator, threads);
+	
+    assert(data->counter == num_threads * MUTEX_TEST_TASK_COUNT, "Failed: Counter does not match expected value after threading tasks");
+}
+
+typedef struct Condition_Variable_Test_Data {
+	Mutex mutex;
+	Condition_Variable cv;
+	int queue[16];
+	int queue_count;
+	int consumed_sum;
+	bool done;
+} Condition_Variable_Test_Data;
+void condition_variable_test_consumer(Thread *t) {
+	Condition_Variable_Test_Data *data = (Condition_Variable_Test_Data*)t->data;
+	mutex_acquire_or_wait(&data->mutex);
+	while (true) {
+		while (data->queue_count == 0 && !data->done) {
+			condition_variable_wait(&data->cv, &data->mutex);
+		}
+		if (data->queue_count == 0 && data->done) break;
+		
+		data->queue_count -= 1;
+		data->consumed_sum += data->queue[data->queue_count];
+		
+		// Room in queue for producer
+		condition_variable_broadcast(&data->cv);
+	}
+	mutex_release(&data->mutex);
+}
+
+typedef struct Semaphore_Test_Data {
+	Binary_Semaphore ping;
+	Binary_Semaphore pong;
+	int rounds;
+	volatile int value;
+} Semaphore_Test_Data;
+void semaphore_test_ponger(Thread *t) {
+	Semaphore_Test_Data *data = (Semaphore_Test_Data*)t->data;
+	for (int i = 0; i < data->rounds; i++) {
+		binary_semaphore_wait(&data->ping);
+		assert(data->value == i*2+1, "Failed: semaphore let ponger through too early");
+		data->value += 1;
+		binary_semaphore_signal(&data->pong);
+	}
+}
+
 void test_mutex() {
     Mutex m;
     
     // Test initialization
     mutex_init(&m);
-    assert(m.spin_time_microseconds == MUTEX_DEFAULT_SPIN_TIME_MICROSECONDS, "Failed: Default spin time incorrect");
-    assert(!m.spinlock_acquired, "Failed: Spinlock should not be acquired after initialization");
+    assert(m.state == MUTEX_STATE_UNLOCKED, "Failed: Mutex should not be acquired after initialization");
 
     // Test acquire and release without contention
     mutex_acquire_or_wait(&m);
-    assert(m.spinlock_acquired, "Failed: Mutex should be acquired after mutex_acquire_or_wait");
+    assert(m.state != MUTEX_STATE_UNLOCKED, "Failed: Mutex should be acquired after mutex_acquire_or_wait");
+    assert(m.acquiring_thread == context.thread_id, "Failed: Mutex should be owned by this thread");
+    assert(!mutex_try_acquire(&m), "Failed: mutex_try_acquire should fail on an acquired mutex");
+    
+    mutex_release(&m);
+    assert(m.state == MUTEX_STATE_UNLOCKED, "Failed: Mutex should not be acquired after mutex_release");
     
+    assert(mutex_try_acquire(&m), "Failed: mutex_try_acquire should succeed on an unlocked mutex");
     mutex_release(&m);
-    assert(!m.spinlock_acquired, "Failed: Spinlock should not be acquired after mutex_release");
 
     // Clean up
     mutex_destroy(&m);
@@ -1129,26 +1387,517 @@ void test_mutex() {
     data.counter = 0;
     data.any_active_thread = false;
     mutex_init(&data.mutex);
+    spinlock_init(&data.spinlock);
+    data.os_mutex = os_make_mutex();
+
+	// Same workload on Mutex, Spinlock and raw OS mutex, contention timings are in benchmarks.c
+	const int thread_counts[] = {2, 8, 100};
+	for (int i = 0; i < sizeof(thread_counts)/sizeof(thread_counts[0]); i++) {
+		int num_threads = thread_counts[i];
+		mutex_test_run_threads(mutex_test_increment_counter, &data, num_threads);
+		mutex_test_run_threads(mutex_test_increment_counter_spinlock, &data, num_threads);
+		mutex_test_run_threads(mutex_test_increment_counter_os_mutex, &data, num_threads);
+	}
 
-    Allocator allocator = get_heap_allocator();
-
-	const int num_threads = 100;
+    mutex_destroy(&data.mutex);
+    os_destroy_mutex(data.os_mutex);
+    
+    // Condition variable: one producer, a few consumers, small queue
+    Condition_Variable_Test_Data cv_data = {0};
+    mutex_init(&cv_data.mutex);
+    condition_variable_init(&cv_data.cv);
+    
+    Thread consumers[4];
+    for (int i = 0; i < 4; i++) {
+    	os_thread_init(&consumers[i], condition_variable_test_consumer);
+    	consumers[i].data = &cv_data;
+    	os_thread_start(&consumers[i]);
+    }
+    
+    int expected_sum = 0;
+    mutex_acquire_or_wait(&cv_data.mutex);
+    for (int i = 1; i <= 10000; i++) {
+    	while (cv_data.queue_count == 16) {
+    		condition_variable_wait(&cv_data.cv, &cv_data.mutex);
+    	}
+    	cv_data.queue[cv_data.queue_count] = i;
+    	cv_data.queue_count += 1;
+    	expected_sum += i;
+    	condition_variable_signal(&cv_data.cv);
+    }
+    cv_data.done = true;
+    condition_variable_broadcast(&cv_data.cv);
+    mutex_release(&cv_data.mutex);
+    
+    for (int i = 0; i < 4; i++) {
+    	os_thread_destroy(&consumers[i]);
+    }
+    assert(cv_data.consumed_sum == expected_sum, "Failed: consumers got %d, expected %d", cv_data.consumed_sum, expected_sum);
+    
+    mutex_acquire_or_wait(&cv_data.mutex);
+    assert(!condition_variable_wait_timeout(&cv_data.cv, &cv_data.mutex, 0.001), "Failed: Nobody signaled, wait should time out");
+    mutex_release(&cv_data.mutex);
+    mutex_destroy(&cv_data.mutex);
+    
+    // Binary semaphore ping pong
+    Semaphore_Test_Data sem_data = {0};
+    sem_data.rounds = 1000;
+    binary_semaphore_init(&sem_data.ping, false);
+    binary_semaphore_init(&sem_data.pong, false);
+    
+    Thread ponger;
+    os_thread_init(&ponger, semaphore_test_ponger);
+    ponger.data = &sem_data;
+    os_thread_start(&ponger);
+    
+    for (int i = 0; i < sem_data.rounds; i++) {
+    	assert(sem_data.value == i*2, "Failed: semaphore let pinger through too early");
+    	sem_data.value += 1;
+    	binary_semaphore_signal(&sem_data.ping);
+    	binary_semaphore_wait(&sem_data.pong);
+    }
+    os_thread_destroy(&ponger);
+    
+    assert(sem_data.value == sem_data.rounds*2, "Failed: ping pong did not finish");
+    
+    binary_semaphore_destroy(&sem_data.ping);
+    binary_semaphore_destroy(&sem_data.pong);
+}
 
-	Thread *threads = alloc(allocator, sizeof(Thread)*num_threads);
-	for (u64 i = 0; i < num_threads; i++) {
-		os_thread_init(&threads[i], mutex_test_increment_counter);
-		threads[i].data = &data;
+#define QUEUE_TEST_ITEM_COUNT (1024*256)
+#define QUEUE_TEST_BATCH_SIZE 64
+typedef struct Queue_Test_Shared_Data {
+	Spsc_Queue spsc;
+	Mpmc_Queue mpmc;
+	bool batched;
+	u64 producer_count;
+	volatile u64 next_producer_id;
+	volatile u64 popped_count;
+	volatile u64 popped_sum;
+} Queue_Test_Shared_Data;
+void queue_test_spsc_producer(Thread *t) {
+	Queue_Test_Shared_Data *data = (Queue_Test_Shared_Data*)t->data;
+	u64 batch[QUEUE_TEST_BATCH_SIZE];
+	u64 i = 0;
+	while (i < QUEUE_TEST_ITEM_COUNT) {
+		u64 pushed;
+		if (data->batched) {
+			u64 count = min(QUEUE_TEST_BATCH_SIZE, QUEUE_TEST_ITEM_COUNT-i);
+			for (u64 j = 0; j < count; j++) batch[j] = i+j;
+			pushed = spsc_queue_push_many(&data->spsc, batch, count);
+		} else {
+			pushed = spsc_queue_push(&data->spsc, &i) ? 1 : 0;
+		}
+		if (pushed == 0) os_yield_thread();
+		i += pushed;
 	}
-	for (u64 i = 0; i < num_threads; i++) {
-    	os_thread_start(&threads[i]);
+}
+void queue_test_mpmc_producer(Thread *t) {
+	Queue_Test_Shared_Data *data = (Queue_Test_Shared_Data*)t->data;
+	u64 id = atomic_fetch_add_64(&data->next_producer_id, 1);
+	u64 items_per_producer = QUEUE_TEST_ITEM_COUNT/data->producer_count;
+	u64 batch[QUEUE_TEST_BATCH_SIZE];
+	u64 i = 0;
+	while (i < items_per_producer) {
+		u64 pushed;
+		if (data->batched) {
+			u64 count = min(QUEUE_TEST_BATCH_SIZE, items_per_producer-i);
+			for (u64 j = 0; j < count; j++) batch[j] = id*items_per_producer+i+j;
+			pushed = mpmc_queue_push_many(&data->mpmc, batch, count);
+		} else {
+			u64 value = id*items_per_producer+i;
+			pushed = mpmc_queue_push(&data->mpmc, &value) ? 1 : 0;
+		}
+		if (pushed == 0) os_yield_thread();
+		i += pushed;
 	}
-	for (u64 i = 0; i < num_threads; i++) {
-    	os_thread_join(&threads[i]);
+}
+void queue_test_mpmc_consumer(Thread *t) {
+	Queue_Test_Shared_Data *data = (Queue_Test_Shared_Data*)t->data;
+	u64 batch[QUEUE_TEST_BATCH_SIZE];
+	u64 total = (QUEUE_TEST_ITEM_COUNT/data->producer_count)*data->producer_count;
+	while (atomic_load_64(&data->popped_count, MEMORY_ORDER_ACQUIRE) < total) {
+		u64 popped = data->batched
+			? mpmc_queue_pop_many(&data->mpmc, batch, QUEUE_TEST_BATCH_SIZE)
+			: (mpmc_queue_pop(&data->mpmc, batch) ? 1 : 0);
+		if (popped == 0) {
+			os_yield_thread();
+			continue;
+		}
+		u64 sum = 0;
+		for (u64 j = 0; j < popped; j++) sum += batch[j];
+		atomic_fetch_add_64(&data->popped_sum, sum);
+		atomic_fetch_add_64(&data->popped_count, popped);
+	}
+}
+void queue_test_run_spsc(Queue_Test_Shared_Data *data, bool batched) {
+	data->batched = batched;
+	Thread producer;
+	os_thread_init(&producer, queue_test_spsc_producer);
+	producer.data = data;
+	os_thread_start(&producer);
+	
+	// Single consumer, everything must come out in the order it went in
+	u64 batch[QUEUE_TEST_BATCH_SIZE];
+	u64 expected = 0;
+	while (expected < QUEUE_TEST_ITEM_COUNT) {
+		u64 popped = batched
+			? spsc_queue_pop_many(&data->spsc, batch, QUEUE_TEST_BATCH_SIZE)
+			: (spsc_queue_pop(&data->spsc, batch) ? 1 : 0);
+		if (popped == 0) os_yield_thread();
+		for (u64 j = 0; j < popped; j++) {
+			assert(batch[j] == expected, "Failed: Spsc_Queue item out of order, expected %llu got %llu", expected, batch[j]);
+			expected += 1;
+		}
+	}
+	
+	os_thread_destroy(&producer);
+	assert(spsc_queue_get_count(&data->spsc) == 0, "Failed: Spsc_Queue should be empty");
+}
+void queue_test_run_mpmc(Queue_Test_Shared_Data *data, bool batched, u64 thread_count) {
+	Thread producers[32];
+	Thread consumers[32];
+	data->batched = batched;
+	data->producer_count = thread_count;
+	data->next_producer_id = 0;
+	data->popped_count = 0;
+	data->popped_sum = 0;
+	for (u64 i = 0; i < thread_count; i++) {
+		os_thread_init(&producers[i], queue_test_mpmc_producer);
+		producers[i].data = data;
+		os_thread_init(&consumers[i], queue_test_mpmc_consumer);
+		consumers[i].data = data;
+	}
+	
+	for (u64 i = 0; i < thread_count; i++) {
+		os_thread_start(&consumers[i]);
+		os_thread_start(&producers[i]);
+	}
+	for (u64 i = 0; i < thread_count; i++) {
+		os_thread_destroy(&producers[i]);
+		os_thread_destroy(&consumers[i]);
 	}
+	
+	// Every value from 0 to total-1 was pushed exactly once
+	u64 total = (QUEUE_TEST_ITEM_COUNT/thread_count)*thread_count;
+	assert(data->popped_count == total, "Failed: Mpmc_Queue lost or duplicated items");
+	assert(data->popped_sum == total*(total-1)/2, "Failed: Mpmc_Queue lost or duplicated items");
+	assert(mpmc_queue_get_count(&data->mpmc) == 0, "Failed: Mpmc_Queue should be empty");
+}
+void test_queues() {
+	
+	// Spsc single threaded
+	Spsc_Queue spsc;
+	spsc_queue_init(&spsc, sizeof(u64), 5, get_heap_allocator());
+	assert(spsc.capacity == 8, "Failed: Queue capacity should round up to power of 2");
+	for (u64 i = 0; i < 8; i++) {
+		assert(spsc_queue_push(&spsc, &i), "Failed: Spsc_Queue push");
+	}
+	u64 value = 69;
+	assert(!spsc_queue_push(&spsc, &value), "Failed: Spsc_Queue push should fail when full");
+	assert(spsc_queue_get_count(&spsc) == 8, "Failed: Spsc_Queue count");
+	for (u64 i = 0; i < 5; i++) {
+		assert(spsc_queue_pop(&spsc, &value) && value == i, "Failed: Spsc_Queue pop");
+	}
+	// Wrap around in the middle of a batch
+	u64 values[8] = {100, 101, 102, 103, 104, 105, 106, 107};
+	assert(spsc_queue_push_many(&spsc, values, 8) == 5, "Failed: Spsc_Queue push_many should push as many as fit");
+	u64 out[16];
+	assert(spsc_queue_pop_many(&spsc, out, 16) == 8, "Failed: Spsc_Queue pop_many");
+	assert(out[0] == 5 && out[2] == 7 && out[3] == 100 && out[7] == 104, "Failed: Spsc_Queue pop_many order");
+	assert(!spsc_queue_pop(&spsc, &value), "Failed: Spsc_Queue pop should fail when empty");
+	spsc_queue_deinit(&spsc);
+	
+	// Mpmc single threaded
+	Mpmc_Queue mpmc;
+	mpmc_queue_init(&mpmc, 3, 4, get_heap_allocator()); // Odd item size
+	assert(mpmc.cell_size == 16, "Failed: Mpmc_Queue cells should be 8 byte aligned");
+	u8 small[3] = {1, 2, 3};
+	for (u64 i = 0; i < 4; i++) {
+		small[0] = (u8)i;
+		assert(mpmc_queue_push(&mpmc, small), "Failed: Mpmc_Queue push");
+	}
+	assert(!mpmc_queue_push(&mpmc, small), "Failed: Mpmc_Queue push should fail when full");
+	assert(mpmc_queue_pop(&mpmc, small) && small[0] == 0 && small[2] == 3, "Failed: Mpmc_Queue pop");
+	u8 small_many[3*4];
+	assert(mpmc_queue_push_many(&mpmc, small_many, 4) == 1, "Failed: Mpmc_Queue push_many should push as many as fit");
+	assert(mpmc_queue_pop_many(&mpmc, small_many, 4) == 4, "Failed: Mpmc_Queue pop_many");
+	assert(small_many[0] == 1 && small_many[3] == 2 && small_many[6] == 3, "Failed: Mpmc_Queue pop_many order");
+	assert(!mpmc_queue_pop(&mpmc, small), "Failed: Mpmc_Queue pop should fail when empty");
+	assert(mpmc_queue_pop_many(&mpmc, small_many, 4) == 0, "Failed: Mpmc_Queue pop_many should pop nothing when empty");
+	mpmc_queue_deinit(&mpmc);
+	
+	// Threaded, throughput is in benchmarks.c
+	Queue_Test_Shared_Data *data = alloc(get_heap_allocator(), sizeof(Queue_Test_Shared_Data));
+	memset(data, 0, sizeof(*data));
+	spsc_queue_init(&data->spsc, sizeof(u64), 1024, get_heap_allocator());
+	mpmc_queue_init(&data->mpmc, sizeof(u64), 1024, get_heap_allocator());
+	
+	queue_test_run_spsc(data, false);
+	queue_test_run_spsc(data, true);
+	
+	// Producers & consumers both this many, so keep it at half the cores
+	u64 max_threads = min(max(os.number_of_logical_processors/2, 1), 32);
+	for (u64 thread_count = 1; true; thread_count = min(thread_count*2, max_threads)) {
+		queue_test_run_mpmc(data, false, thread_count);
+		queue_test_run_mpmc(data, true, thread_count);
+		if (thread_count == max_threads) break;
+	}
+	
+	spsc_queue_deinit(&data->spsc);
+	mpmc_queue_deinit(&data->mpmc);
+	dealloc(get_heap_allocator(), data);
+}
 
-    assert(data.counter == num_threads * MUTEX_TEST_TASK_COUNT, "Failed: Counter does not match expected value after threading tasks");
+#define JOB_TEST_ROOT_COUNT 64
+#define JOB_TEST_CHILD_COUNT 64
+typedef struct Job_Test_Shared_Data {
+	volatile u64 counter;
+	u64 work_iterations;
+	volatile u64 sink;
+} Job_Test_Shared_Data;
+void job_test_increment(void *data) {
+	Job_Test_Shared_Data *shared = (Job_Test_Shared_Data*)data;
+	
+	// Synthetic work + make sure temporary storage works on all workers
+	u64 *scratch = (u64*)talloc(sizeof(u64)*16);
+	u64 x = 0;
+	for (u64 i = 0; i < shared->work_iterations; i++) {
+		scratch[i%16] = x;
+		x = x*6364136223846793005ull + 1442695040888963407ull + scratch[(i+7)%16];
+	}
+	shared->sink = x;
+	
+	atomic_fetch_add_64(&shared->counter, 1);
+}
+void job_test_fan_out(void *data) {
+	Job_Test_Shared_Data *shared = (Job_Test_Shared_Data*)data;
+	
+	Job jobs[JOB_TEST_CHILD_COUNT];
+	for (u64 i = 0; i < JOB_TEST_CHILD_COUNT; i++) {
+		jobs[i].proc = job_test_increment;
+		jobs[i].data = shared;
+	}
+	
+	// Waiting inside of a job should not deadlock
+	Job_Counter children = {0};
+	jobs_run(jobs, JOB_TEST_CHILD_COUNT, &children);
+	job_wait(&children);
+	
+	assert(job_counter_is_done(&children), "Failed: job_wait returned before children were done");
+}
+void job_test_external_thread(Thread *t) {
+	Job_Test_Shared_Data *shared = (Job_Test_Shared_Data*)t->data;
+	
+	assert(job_get_current_worker_index() == -1, "Failed: external thread should not be in the job pool");
+	
+	Job_Counter counter = {0};
+	for (u64 i = 0; i < JOB_TEST_CHILD_COUNT; i++) {
+		job_run(job_test_increment, shared, &counter);
+	}
+	job_wait(&counter);
+}
+void job_test_fan_out_all(u64 work_iterations) {
+	Job_Test_Shared_Data shared = {0};
+	shared.work_iterations = work_iterations;
+	
+	Job_Counter counter = {0};
+	for (u64 i = 0; i < JOB_TEST_ROOT_COUNT; i++) {
+		job_run(job_test_fan_out, &shared, &counter);
+	}
+	job_wait(&counter);
+	
+	assert(shared.counter == JOB_TEST_ROOT_COUNT*JOB_TEST_CHILD_COUNT, "Failed: expected %llu jobs to run, %llu did", JOB_TEST_ROOT_COUNT*JOB_TEST_CHILD_COUNT, shared.counter);
+}
+void test_jobs() {
+	
+	bool was_initted = job_system.initted;
+	if (was_initted) job_system_shutdown();
+	
+	u64 max_workers = max(os.number_of_logical_processors, 1);
+	
+	job_system_init(max_workers);
+	assert(job_system_get_worker_count() == max_workers, "Failed: wrong worker count");
+	assert(job_get_current_worker_index() == 0, "Failed: initializing thread should be worker 0");
+	
+	// Single jobs
+	Job_Test_Shared_Data shared = {0};
+	shared.work_iterations = 10;
+	Job_Counter counter = {0};
+	for (u64 i = 0; i < 1000; i++) {
+		job_run(job_test_increment, &shared, &counter);
+	}
+	job_wait(&counter);
+	assert(shared.counter == 1000, "Failed: expected 1000 jobs to run, %llu did", shared.counter);
+	
+	// More jobs than fit in the queue
+	shared.counter = 0;
+	for (u64 i = 0; i < JOB_QUEUE_CAPACITY*2; i++) {
+		job_run(job_test_increment, &shared, &counter);
+	}
+	job_wait(&counter);
+	assert(shared.counter == JOB_QUEUE_CAPACITY*2, "Failed: jobs were lost when queue was full");
+	
+	// Jobs from a thread outside of the pool
+	shared.counter = 0;
+	Thread external;
+	os_thread_init(&external, job_test_external_thread);
+	external.data = &shared;
+	os_thread_start(&external);
+	os_thread_join(&external);
+	assert(shared.counter == JOB_TEST_CHILD_COUNT, "Failed: jobs from external thread did not run");
+	
+	// Jobs waiting on jobs
+	job_test_fan_out_all(10);
+	
+	job_system_shutdown();
+	
+	// Several threads starting the job system at once by running jobs. One of them starts it,
+	// none of them joins the pool.
+	shared.counter = 0;
+	Thread starters[4];
+	for (u64 i = 0; i < 4; i++) {
+		os_thread_init(&starters[i], job_test_external_thread);
+		starters[i].data = &shared;
+	}
+	for (u64 i = 0; i < 4; i++) os_thread_start(&starters[i]);
+	for (u64 i = 0; i < 4; i++) os_thread_destroy(&starters[i]);
+	assert(shared.counter == JOB_TEST_CHILD_COUNT*4, "Failed: jobs were lost when the job system was started from several threads");
+	assert(job_system_get_worker_count() == max_workers, "Failed: wrong worker count after lazy start");
+	assert(job_get_current_worker_index() == -1, "Failed: no outside thread should be worker 0 after a lazy start");
+	assert(job_system.workers[0].thread.id != 0, "Failed: worker 0 should be a spawned thread after a lazy start");
+	
+	// Jobs waiting on jobs, with every worker spawned
+	job_test_fan_out_all(10);
+	job_system_shutdown();
+	
+	
+	if (was_initted) job_system_init(0);
+}
 
-    mutex_destroy(&data.mutex);
+#define PARALLEL_TEST_ENTITY_COUNT 1024*16
+#define PARALLEL_TEST_QUAD_COUNT 1024*64
+typedef struct Parallel_Test_Entity {
+	Vector2 pos;
+	Vector2 velocity;
+	f32 health;
+	u32 brain_iterations; // To make some entities much more expensive than others
+	bool is_valid;
+} Parallel_Test_Entity;
+typedef struct Parallel_Test_Quads {
+	Vector2 *in;
+	Vector2 *out;
+	Matrix4 xform;
+} Parallel_Test_Quads;
+void parallel_test_mark(u64 first, u64 end, void *userdata) {
+	u8 *marks = (u8*)userdata;
+	// Temporary storage should just work in here
+	u8 *scratch = (u8*)talloc(end-first);
+	for (u64 i = first; i < end; i++) {
+		scratch[i-first] = 1;
+		marks[i] += scratch[i-first];
+	}
+}
+void parallel_test_update_entities(u64 first, u64 end, void *userdata) {
+	Parallel_Test_Entity *entities = (Parallel_Test_Entity*)userdata;
+	for (u64 i = first; i < end; i++) {
+		Parallel_Test_Entity *en = &entities[i];
+		if (!en->is_valid) continue;
+		
+		Vector2 target = en->pos;
+		for (u32 j = 0; j < en->brain_iterations; j++) {
+			target = v2_add(v2_mulf(target, 0.999f), v2(0.001f, 0.002f));
+		}
+		en->velocity = v2_mulf(v2_sub(target, en->pos), 0.5f);
+		en->pos = v2_add(en->pos, v2_mulf(en->velocity, 1.0f/60.0f));
+	}
+}
+void parallel_test_transform_quads(u64 first, u64 end, void *userdata) {
+	Parallel_Test_Quads *quads = (Parallel_Test_Quads*)userdata;
+	for (u64 i = first*4; i < end*4; i++) {
+		Vector4 p = m4_transform(quads->xform, v4(quads->in[i].x, quads->in[i].y, 0, 1));
+		quads->out[i] = p.xy;
+	}
+}
+void parallel_test_sum_health(u64 first, u64 end, void *partial, void *userdata) {
+	Parallel_Test_Entity *entities = (Parallel_Test_Entity*)userdata;
+	f64 *sum = (f64*)partial;
+	for (u64 i = first; i < end; i++) {
+		*sum += entities[i].health;
+	}
+}
+void parallel_test_combine_sum(void *result, void *partial, void *userdata) {
+	*(f64*)result += *(f64*)partial;
+}
+void test_parallel_for() {
+	
+	Allocator heap = get_heap_allocator();
+	
+	// Every item is visited exactly once, for different grains
+	u64 mark_count = 10007;
+	u8 *marks = (u8*)alloc(heap, mark_count);
+	u64 grains[] = {0, 1, 7, 100, 10007, 20000};
+	for (u64 g = 0; g < sizeof(grains)/sizeof(grains[0]); g++) {
+		memset(marks, 0, mark_count);
+		parallel_for(0, mark_count, grains[g], parallel_test_mark, marks);
+		for (u64 i = 0; i < mark_count; i++) {
+			assert(marks[i] == 1, "Failed: parallel_for with grain %llu visited item %llu %d times", grains[g], i, (int)marks[i]);
+		}
+	}
+	memset(marks, 0, mark_count);
+	parallel_for(100, 200, 0, parallel_test_mark, marks);
+	for (u64 i = 0; i < mark_count; i++) {
+		assert(marks[i] == (i >= 100 && i < 200), "Failed: parallel_for visited items outside of range");
+	}
+	parallel_for(5, 5, 0, parallel_test_mark, marks);
+	dealloc(heap, marks);
+	
+	// Entity update style: most entities are cheap, a few are very expensive
+	Parallel_Test_Entity *entities = (Parallel_Test_Entity*)alloc(heap, sizeof(Parallel_Test_Entity)*PARALLEL_TEST_ENTITY_COUNT);
+	Parallel_Test_Entity *entities_serial = (Parallel_Test_Entity*)alloc(heap, sizeof(Parallel_Test_Entity)*PARALLEL_TEST_ENTITY_COUNT);
+	f64 expected_health = 0;
+	for (u64 i = 0; i < PARALLEL_TEST_ENTITY_COUNT; i++) {
+		entities[i].pos = v2((f32)(i%100), (f32)(i/100));
+		entities[i].health = (f32)(i%10);
+		entities[i].brain_iterations = (i % 64 == 0) ? 2000 : 10;
+		entities[i].is_valid = (i % 3) != 0;
+		expected_health += entities[i].health;
+	}
+	memcpy(entities_serial, entities, sizeof(Parallel_Test_Entity)*PARALLEL_TEST_ENTITY_COUNT);
+	
+	parallel_test_update_entities(0, PARALLEL_TEST_ENTITY_COUNT, entities_serial);
+	parallel_for(0, PARALLEL_TEST_ENTITY_COUNT, 0, parallel_test_update_entities, entities);
+	assert(bytes_match(entities, entities_serial, sizeof(Parallel_Test_Entity)*PARALLEL_TEST_ENTITY_COUNT), "Failed: parallel entity update does not match serial");
+	
+	// Reduce
+	f64 zero = 0;
+	f64 health = 0;
+	parallel_reduce(0, PARALLEL_TEST_ENTITY_COUNT, 0, parallel_test_sum_health, parallel_test_combine_sum, &zero, &health, sizeof(f64), entities);
+	assert(health == expected_health, "Failed: parallel_reduce sum is %.1f, expected %.1f", health, expected_health);
+	health = 1;
+	parallel_reduce(0, 3, 0, parallel_test_sum_health, parallel_test_combine_sum, &zero, &health, sizeof(f64), entities);
+	assert(health == 1+entities[0].health+entities[1].health+entities[2].health, "Failed: serial parallel_reduce is wrong");
+	
+	dealloc(heap, entities);
+	dealloc(heap, entities_serial);
+	
+	// Quad transform style: cheap and uniform per item
+	Parallel_Test_Quads quads;
+	quads.in  = (Vector2*)alloc(heap, sizeof(Vector2)*4*PARALLEL_TEST_QUAD_COUNT);
+	quads.out = (Vector2*)alloc(heap, sizeof(Vector2)*4*PARALLEL_TEST_QUAD_COUNT);
+	quads.xform = m4_mul(m4_make_scale(v3(2, 2, 1)), m4_make_translation(v3(10, 20, 0)));
+	for (u64 i = 0; i < 4*PARALLEL_TEST_QUAD_COUNT; i++) {
+		quads.in[i] = v2((f32)(i%1000), (f32)(i/1000));
+	}
+	
+	memset(quads.out, 0, sizeof(Vector2)*4*PARALLEL_TEST_QUAD_COUNT);
+	parallel_for(0, PARALLEL_TEST_QUAD_COUNT, 0, parallel_test_transform_quads, &quads);
+	
+	for (u64 i = 0; i < 4*PARALLEL_TEST_QUAD_COUNT; i++) {
+		assert(quads.out[i].x == quads.in[i].x*2+20 && quads.out[i].y == quads.in[i].y*2+40, "Failed: quad %llu was not transformed", i/4);
+	}
+	dealloc(heap, quads.in);
+	dealloc(heap, quads.out);
 }
 
 #ifndef OOGABOOGA_HEADLESS
@@ -1289,6 +2038,914 @@ void test_growing_array() {
     assert(growing_array_get_valid_count(things) == 99, "Failed: growing_array_get_valid_count");
 }
 
+#define ASYNC_TEST_TASK_COUNT 64
+#define ASYNC_TEST_CHILD_COUNT 16
+typedef struct Async_Test_Inner {
+	Async_Task task;
+	u64 yield_count;
+} Async_Test_Inner;
+typedef struct Async_Test_Task {
+	Async_Task task;
+	Job_Test_Shared_Data children_data;
+	Job_Counter children;
+	Async_Test_Inner inner;
+	Job_Counter inner_done;
+	u64 round;
+	volatile u64 *finished_count;
+} Async_Test_Task;
+bool async_test_inner_proc(Async_Task *task) {
+	Async_Test_Inner *inner = (Async_Test_Inner*)task->data;
+	async_begin(task);
+	
+	for (inner->yield_count = 0; inner->yield_count < 5; inner->yield_count++) {
+		async_yield(task);
+	}
+	
+	async_end(task);
+}
+bool async_test_proc(Async_Task *task) {
+	Async_Test_Task *t = (Async_Test_Task*)task->data;
+	async_begin(task);
+	
+	// Wait for jobs a few times, state has to survive being resumed on other workers
+	for (t->round = 0; t->round < 3; t->round++) {
+		for (u64 i = 0; i < ASYNC_TEST_CHILD_COUNT; i++) {
+			job_run(job_test_increment, &t->children_data, &t->children);
+		}
+		async_await(task, &t->children);
+		assert(t->children_data.counter == (t->round+1)*ASYNC_TEST_CHILD_COUNT, "Failed: async task resumed before jobs were done");
+	}
+	
+	// Awaiting a counter that's already done continues right away
+	async_await(task, &t->children);
+	
+	// Tasks can wait for other tasks
+	async_run(&t->inner.task, async_test_inner_proc, &t->inner, &t->inner_done);
+	async_await(task, &t->inner_done);
+	assert(t->inner.yield_count == 5, "Failed: async task resumed before inner task was done");
+	
+	atomic_fetch_add_64(t->finished_count, 1);
+	
+	async_end(task);
+}
+void test_async() {
+	
+	bool was_initted = job_system.initted;
+	if (was_initted) job_system_shutdown();
+	
+	Async_Test_Task *tasks = (Async_Test_Task*)alloc(get_heap_allocator(), sizeof(Async_Test_Task)*ASYNC_TEST_TASK_COUNT);
+	
+	u64 max_workers = max(os.number_of_logical_processors, 1);
+	for (u64 worker_count = 1; true; worker_count = min(worker_count*2, max_workers)) {
+		job_system_init(worker_count);
+		
+		memset(tasks, 0, sizeof(Async_Test_Task)*ASYNC_TEST_TASK_COUNT);
+		volatile u64 finished_count = 0;
+		Job_Counter all_done = {0};
+		for (u64 i = 0; i < ASYNC_TEST_TASK_COUNT; i++) {
+			tasks[i].children_data.work_iterations = 10;
+			tasks[i].finished_count = &finished_count;
+			async_run(&tasks[i].task, async_test_proc, &tasks[i], &all_done);
+		}
+		assert(!job_counter_is_done(&all_done), "Failed: async tasks should be running");
+		
+		// Like a game loop would, without blocking on them
+		while (!job_counter_is_done(&all_done)) {
+			job_help(0.001);
+		}
+		assert(finished_count == ASYNC_TEST_TASK_COUNT, "Failed: %llu/%d async tasks finished", finished_count, ASYNC_TEST_TASK_COUNT);
+		
+		// job_wait works too
+		memset(tasks, 0, sizeof(Async_Test_Task)*ASYNC_TEST_TASK_COUNT);
+		finished_count = 0;
+		for (u64 i = 0; i < ASYNC_TEST_TASK_COUNT; i++) {
+			tasks[i].children_data.work_iterations = 10;
+			tasks[i].finished_count = &finished_count;
+			async_run(&tasks[i].task, async_test_proc, &tasks[i], &all_done);
+		}
+		job_wait(&all_done);
+		assert(finished_count == ASYNC_TEST_TASK_COUNT, "Failed: %llu/%d async tasks finished", finished_count, ASYNC_TEST_TASK_COUNT);
+		
+		job_system_shutdown();
+		
+		if (worker_count == max_workers) break;
+	}
+	
+	dealloc(get_heap_allocator(), tasks);
+	
+	if (was_initted) job_system_init(0);
+}
+
+u64 profiler_test_count_occurrences(string s, string needle) {
+	u64 count = 0;
+	s64 index;
+	while (s.count >= needle.count && (index = string_find_from_left(s, needle)) != -1) {
+		count += 1;
+		s.data  += index+needle.count;
+		s.count -= index+needle.count;
+	}
+	return count;
+}
+void test_profiler() {
+	
+	// Cycle counter calibration should agree with the os clock
+	u64 cycles_per_second = os_measure_cycles_per_second(0.02);
+	assert(cycles_per_second > 0, "Failed: Could not measure cycles per second");
+	f64 start_seconds = os_get_current_time_in_seconds();
+	u64 start_cycles = rdtsc();
+	os_high_precision_sleep(20);
+	f64 elapsed_seconds = os_get_current_time_in_seconds()-start_seconds;
+	f64 elapsed_cycle_seconds = cycles_to_seconds(rdtsc()-start_cycles);
+	assert(fabs(elapsed_cycle_seconds-elapsed_seconds) < elapsed_seconds*0.1, "Failed: cycles_to_seconds says %.4fs, os clock says %.4fs", elapsed_cycle_seconds, elapsed_seconds);
+	assert(fabs(cycles_to_microseconds(os.cycles_per_second/1000)-1000.0) < 0.01, "Failed: cycles_to_microseconds");
+	
+	// Don't leave our test events in the trace
+	profiler_flush();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	u64 output_count_before = _profile_output.count;
+	spinlock_release(&_profiler_lock);
+	
+	// Recording only writes to this threads ring. Holding the lock keeps the flush thread out.
+	u64 event_count = PROFILER_EVENTS_PER_THREAD/2;
+	u64 record_start = rdtsc();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	for (u64 i = 0; i < event_count; i++) {
+		_profiler_report_time_cycles(STR("Profiler test"), 10+i, record_start+i);
+	}
+	assert(_profiler_thread_buffer != 0, "Failed: Thread should have a profiler buffer after recording");
+	assert(spsc_queue_get_count(&_profiler_thread_buffer->events) == event_count, "Failed: Events should be in the ring until flushed");
+	spinlock_release(&_profiler_lock);
+	
+	profiler_flush();
+	assert(spsc_queue_get_count(&_profiler_thread_buffer->events) == 0, "Failed: Flush should empty the ring");
+	
+	spinlock_acquire_or_wait(&_profiler_lock);
+	string flushed = string_view(_profile_output.result, output_count_before, _profile_output.count-output_count_before);
+	assert(string_find_from_left(flushed, STR("\"name\":\"Profiler test\"")) != -1, "Failed: Flushed trace should contain the event");
+	spinlock_release(&_profiler_lock);
+	
+	// Trace is in microseconds
+	_profiler_report_time_cycles(STR("Profiler test"), os.cycles_per_second/1000, os.cycles_per_second);
+	event_count += 1;
+	profiler_flush();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	flushed = string_view(_profile_output.result, output_count_before, _profile_output.count-output_count_before);
+	assert(string_find_from_left(flushed, STR("\"dur\":1000.000,\"name\":\"Profiler test\"")) != -1, "Failed: 1ms event should have a duration of 1000us in the trace");
+	assert(string_find_from_left(flushed, STR("\"ts\":1000000.000}")) != -1, "Failed: Event 1s after 0 should have timestamp 1000000us in the trace");
+	spinlock_release(&_profiler_lock);
+	
+	// Counter tracks & frames
+	profiler_counter(STR("Test counter"), 42.5);
+	profiler_frame_end(); // No begin, nothing recorded
+	profiler_frame_begin();
+	os_high_precision_sleep(1);
+	profiler_frame_end();
+	profiler_flush();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	flushed = string_view(_profile_output.result, output_count_before, _profile_output.count-output_count_before);
+	assert(string_find_from_left(flushed, STR("\"name\":\"Test counter\",\"ph\":\"C\"")) != -1, "Failed: Trace should contain the counter event");
+	assert(string_find_from_left(flushed, STR("\"args\":{\"value\":42.500}")) != -1, "Failed: Counter event should have its value");
+	assert(profiler_test_count_occurrences(flushed, STR("\"cat\":\"frame\",\"dur\"")) == 1, "Failed: Trace should contain exactly one frame");
+	assert(string_find_from_left(flushed, STR("\"ph\":\"i\",\"s\":\"g\"")) != -1, "Failed: Frame should have a global marker");
+	spinlock_release(&_profiler_lock);
+	
+	// Temporary storage high water survives resets until it's read
+	reset_temporary_storage();
+	talloc(1234);
+	reset_temporary_storage();
+	talloc(10);
+	assert(get_and_reset_temporary_storage_high_water() >= 1234, "Failed: Temporary storage high water");
+	assert(get_and_reset_temporary_storage_high_water() < 1234, "Failed: Temporary storage high water should reset");
+	
+	// Overfilling the ring moves events aside instead of losing them. Recording never flushes
+	// itself, or this would never get past the lock.
+	spinlock_acquire_or_wait(&_profiler_lock);
+	for (u64 i = 0; i < PROFILER_EVENTS_PER_THREAD*2; i++) {
+		_profiler_report_time_cycles(STR("Profiler test"), 10, record_start);
+	}
+	Profile_Thread_Buffer *buffer = _profiler_thread_buffer;
+	spinlock_acquire_or_wait(&buffer->raw_lock);
+	u64 pending = buffer->raw_count + spsc_queue_get_count(&buffer->events);
+	spinlock_release(&buffer->raw_lock);
+	spinlock_release(&_profiler_lock);
+	assert(pending == PROFILER_EVENTS_PER_THREAD*2, "Failed: Expected %llu events waiting for a flush, got %llu", PROFILER_EVENTS_PER_THREAD*2, pending);
+	profiler_flush();
+	spinlock_acquire_or_wait(&_profiler_lock);
+	string rest = string_view(_profile_output.result, output_count_before, _profile_output.count-output_count_before);
+	u64 flushed_event_count = profiler_test_count_occurrences(rest, STR("Profiler test"));
+	_profile_output.count = output_count_before;
+	spinlock_release(&_profiler_lock);
+	assert(flushed_event_count == event_count+PROFILER_EVENTS_PER_THREAD*2, "Failed: Expected %llu flushed events, got %llu", event_count+PROFILER_EVENTS_PER_THREAD*2, flushed_event_count);
+}
+
+void profiler_test_stream_thread(Thread *t) {
+	for (u64 i = 0; i < 1000; i++) {
+		_profiler_report_time_cycles(STR("Stream test other thread"), 10, rdtsc());
+	}
+}
+void test_profiler_streaming() {
+	
+	string trace_path = STR("oogabooga_test_trace.ogbtrace");
+	string json_path = STR("oogabooga_test_trace.json");
+	
+	// Streaming, more events than fit in the ring so some chunks are written before stopping
+	assert(profiler_start_streaming(trace_path), "Failed: Could not start profiler streaming");
+	u64 event_count = PROFILER_EVENTS_PER_THREAD*2;
+	for (u64 i = 0; i < event_count; i++) {
+		_profiler_report_time_cycles(STR("Stream test"), 10, rdtsc());
+	}
+	profiler_frame_begin();
+	profiler_counter(STR("Stream test counter"), 7);
+	profiler_frame_end();
+	Thread thread;
+	os_thread_init(&thread, profiler_test_stream_thread);
+	os_thread_start(&thread);
+	os_thread_join(&thread);
+	os_thread_destroy(&thread);
+	profiler_stop();
+	
+	string trace;
+	assert(os_read_entire_file(trace_path, &trace, get_heap_allocator()), "Failed: Could not read streamed trace");
+	assert(profiler_convert_trace_to_json(trace_path, json_path), "Failed: Could not convert streamed trace");
+	string json;
+	assert(os_read_entire_file(json_path, &json, get_heap_allocator()), "Failed: Could not read converted trace");
+	assert(json.count > 3 && json.data[0] == '[' && strings_match(string_view(json, json.count-3, 3), STR("{}]")), "Failed: Converted trace is not a json array");
+	u64 found = profiler_test_count_occurrences(json, STR("\"Stream test\""));
+	assert(found == event_count, "Failed: Expected %llu streamed events, found %llu", event_count, found);
+	found = profiler_test_count_occurrences(json, STR("\"Stream test other thread\""));
+	assert(found == 1000, "Failed: Expected 1000 streamed events from other thread, found %llu", found);
+	assert(string_find_from_left(json, STR("\"name\":\"Stream test counter\",\"ph\":\"C\"")) != -1, "Failed: Streamed trace should keep counters");
+	assert(string_find_from_left(json, STR("\"args\":{\"value\":7.000}")) != -1, "Failed: Streamed counter should keep its value");
+	assert(string_find_from_left(json, STR("\"cat\":\"frame\"")) != -1, "Failed: Streamed trace should keep frames");
+	dealloc(get_heap_allocator(), trace.data);
+	dealloc(get_heap_allocator(), json.data);
+	
+	// History only keeps the last N seconds
+	profiler_start_history(0.05);
+	for (u64 i = 0; i < 10; i++) {
+		_profiler_report_time_cycles(STR("History old"), 10, rdtsc());
+	}
+	profiler_flush();
+	os_sleep(150);
+	for (u64 i = 0; i < 10; i++) {
+		_profiler_report_time_cycles(STR("History new"), 10, rdtsc());
+	}
+	assert(profiler_snapshot(trace_path), "Failed: Could not write profiler snapshot");
+	profiler_stop();
+	
+	assert(profiler_convert_trace_to_json(trace_path, json_path), "Failed: Could not convert snapshot");
+	assert(os_read_entire_file(json_path, &json, get_heap_allocator()), "Failed: Could not read converted snapshot");
+	assert(profiler_test_count_occurrences(json, STR("\"History new\"")) == 10, "Failed: Snapshot should have the recent events");
+	assert(profiler_test_count_occurrences(json, STR("\"History old\"")) == 0, "Failed: Snapshot should not have events older than the history");
+	dealloc(get_heap_allocator(), json.data);
+	
+	os_file_delete(trace_path);
+	os_file_delete(json_path);
+}
+
+void test_sampling_profiler() {
+	string path = STR("oogabooga_test_samples.folded");
+	
+	assert(sampling_profiler_start(1000), "Failed: Could not start sampling profiler");
+	f64 start = os_get_current_time_in_seconds();
+	u64 work = 0;
+	while (os_get_current_time_in_seconds()-start < 0.1) {
+		for (u64 i = 0; i < 1000; i++) work += i*i;
+	}
+	sampling_profiler_stop();
+	u64 sample_count = sampling_profiler_get_sample_count();
+	assert(sample_count > 0, "Failed: No samples were taken (%llu work)", work);
+	
+	assert(sampling_profiler_dump_collapsed(path), "Failed: Could not dump sampling profile");
+	string folded;
+	assert(os_read_entire_file(path, &folded, get_heap_allocator()), "Failed: Could not read sampling profile");
+	
+	// Every line is "frame;frame;frame count" and the counts add up to the samples
+	u64 total = 0;
+	string rest = folded;
+	while (rest.count > 0) {
+		s64 newline = string_find_from_left(rest, STR("\n"));
+		assert(newline > 0, "Failed: Collapsed stack lines should end with a newline");
+		string line = string_view(rest, 0, newline);
+		s64 space = string_find_from_right(line, STR(" "));
+		assert(space > 0, "Failed: Collapsed stack line should end with a count: '%s'", line);
+		u64 count = 0;
+		for (u64 i = space+1; i < line.count; i++) {
+			assert(line.data[i] >= '0' && line.data[i] <= '9', "Failed: Bad count in '%s'", line);
+			count = count*10 + (line.data[i]-'0');
+		}
+		assert(count > 0, "Failed: Collapsed stack with 0 samples");
+		total += count;
+		rest.data  += newline+1;
+		rest.count -= newline+1;
+	}
+	assert(total == min(sample_count, SAMPLING_PROFILER_MAX_SAMPLES), "Failed: Expected %llu samples in the dump, got %llu", sample_count, total);
+	
+	dealloc(get_heap_allocator(), folded.data);
+	os_file_delete(path);
+}
+
+void test_frame_stats() {
+	Frame_Stats *saved = alloc(get_heap_allocator(), sizeof(Frame_Stats));
+	memcpy(saved, &frame_stats, sizeof(Frame_Stats));
+	memset(&frame_stats, 0, sizeof(Frame_Stats));
+	
+	Frame_Stat_Summary s = get_frame_stat_summary(FRAME_STAT_UPDATE);
+	assert(s.sample_count == 0 && s.max == 0, "Failed: No frames should give an empty summary");
+	
+	// Update takes 1ms, 2ms, ... 100ms
+	if (os.cycles_per_second == 0) os.cycles_per_second = os_measure_cycles_per_second(0.01);
+	u64 cycles_per_ms = os.cycles_per_second/1000;
+	for (u64 i = 1; i <= 100; i++) {
+		frame_stat_scope(FRAME_STAT_QUADS) {}
+		frame_stat_add(FRAME_STAT_UPDATE, cycles_per_ms*i);
+		frame_stats_end_frame();
+	}
+	s = get_frame_stat_summary(FRAME_STAT_UPDATE);
+	assert(s.sample_count == 100, "Failed: Expected 100 samples, got %llu", s.sample_count);
+	assert(fabs(s.last-100.0) < 0.01, "Failed: last should be 100ms, was %.3f", s.last);
+	assert(fabs(s.max-100.0) < 0.01, "Failed: max should be 100ms, was %.3f", s.max);
+	assert(fabs(s.average-50.5) < 0.01, "Failed: average should be 50.5ms, was %.3f", s.average);
+	assert(fabs(s.p50-51.0) < 0.01, "Failed: p50 should be 51ms, was %.3f", s.p50);
+	assert(fabs(s.p95-95.0) < 0.01, "Failed: p95 should be 95ms, was %.3f", s.p95);
+	assert(fabs(s.p99-99.0) < 0.01, "Failed: p99 should be 99ms, was %.3f", s.p99);
+	
+	s = get_frame_stat_summary(FRAME_STAT_QUADS);
+	assert(s.max > 0 && s.max < 1.0, "Failed: Empty scope should be measured but tiny, was %.3fms", s.max);
+	s = get_frame_stat_summary(FRAME_STAT_FRAME);
+	assert(s.sample_count == 100 && s.max > 0, "Failed: Frame time should be measured between frames");
+	
+	// Only the last FRAME_STATS_HISTORY frames are kept
+	for (u64 i = 0; i < FRAME_STATS_HISTORY; i++) {
+		frame_stat_add(FRAME_STAT_UPDATE, cycles_per_ms);
+		frame_stats_end_frame();
+	}
+	s = get_frame_stat_summary(FRAME_STAT_UPDATE);
+	assert(s.sample_count == FRAME_STATS_HISTORY, "Failed: History should be capped");
+	assert(fabs(s.max-1.0) < 0.01, "Failed: Old frames should be forgotten, max was %.3f", s.max);
+	
+	memcpy(&frame_stats, saved, sizeof(Frame_Stats));
+	dealloc(get_heap_allocator(), saved);
+}
+
+#if OOGABOOGA_HAS_GFX
+void test_gfx_batch() {
+	Allocator heap = get_heap_allocator();
+	
+	// 40 images is more than the 32 texture slots of one draw call
+	const u64 image_count = 40;
+	Gfx_Image images[40] = {0};
+	for (u64 i = 0; i < image_count; i++) images[i].gfx_handle = (Gfx_Handle)(i+1);
+	
+	const u64 quad_count = 100;
+	Draw_Quad *quads = alloc(heap, quad_count*sizeof(Draw_Quad));
+	for (u64 i = 0; i < quad_count; i++) {
+		Draw_Quad q = ZERO(Draw_Quad);
+		q.bottom_left  = v2(-0.5, -0.5);
+		q.top_left     = v2(-0.5,  0.5);
+		q.top_right    = v2( 0.5,  0.5);
+		q.bottom_right = v2( 0.5, -0.5);
+		q.color = v4(1, 1, 1, (f32)i);
+		q.z = (s32)(quad_count-i); // Reversed, so sorting has work to do
+		q.image = (i < image_count*2) ? &images[i/2] : 0;
+		quads[i] = q;
+	}
+	quads[0].type = QUAD_TYPE_TEXT;
+	quads[0].bottom_left = v2(0.1234f, 0.1234f);
+	quads[1].image_min_filter = GFX_FILTER_MODE_LINEAR;
+	quads[1].image_mag_filter = GFX_FILTER_MODE_NEAREST;
+	Vector4 scissors[] = {v4(10, 20, 30, 40)};
+	quads[2].scissor = 1;
+	
+	Gfx_Batch batch = ZERO(Gfx_Batch);
+	gfx_batch_build(&batch, quads, quad_count, scissors, true, 100, 100);
+	
+	assert(batch.instance_count == quad_count, "Failed: Expected %llu instances, got %llu", quad_count, batch.instance_count);
+	for (u64 i = 1; i < quad_count; i++) {
+		assert(batch.instances[i-1].color.w > batch.instances[i].color.w, "Failed: Instances should be sorted by z");
+	}
+	assert(quads[0].bottom_left.x == 0.1234f && quads[0].color.w == 0, "Failed: Quads should be left untouched");
+	
+	// Every image is used by two neighbouring quads after sorting, so the first 32 images
+	// fill the first draw call and the last 8 spill into a second one.
+	assert(batch.draw_call_count == 2, "Failed: Expected 2 draw calls, got %llu", batch.draw_call_count);
+	Gfx_Draw_Call *a = &batch.draw_calls[0];
+	Gfx_Draw_Call *b = &batch.draw_calls[1];
+	assert(a->texture_count == GFX_BATCH_MAX_TEXTURES, "Failed: First draw call should use all texture slots, used %llu", a->texture_count);
+	assert(b->texture_count == image_count-GFX_BATCH_MAX_TEXTURES, "Failed: Second draw call should have the remaining textures, had %llu", b->texture_count);
+	assert(a->first_instance == 0 && b->first_instance == a->instance_count, "Failed: Draw calls should be contiguous");
+	assert(a->instance_count+b->instance_count == batch.instance_count, "Failed: Draw calls should cover every instance");
+	
+	for (u64 i = 0; i < quad_count; i++) {
+		Gfx_Quad_Instance *inst = &batch.instances[i];
+		Draw_Quad *q = &quads[(u64)inst->color.w];
+		Gfx_Draw_Call *call = (i < b->first_instance) ? a : b;
+		
+		assert(inst->color.w == q->color.w && inst->uv.x2 == q->uv.x2, "Failed: Instance should have the quad color & uv");
+		
+		if (q->image) {
+			assert(inst->texture_index >= 0 && (u64)inst->texture_index < call->texture_count, "Failed: Texture index out of range");
+			assert(call->textures[inst->texture_index] == q->image->gfx_handle, "Failed: Texture slot has the wrong image");
+		} else {
+			assert(inst->texture_index == -1, "Failed: Untextured quads should have no texture");
+		}
+		
+		// BL, TL, TR, BR
+		if (q->type == QUAD_TYPE_TEXT) {
+			// Snapped to 2/100 in ndc
+			assert(fabs(inst->corners[0].x-0.12f) < 0.0001f, "Failed: Text should snap to pixels, got %f", inst->corners[0].x);
+		} else {
+			assert(inst->corners[0].x == q->bottom_left.x && inst->corners[2].y == q->top_right.y && inst->corners[3].x == q->bottom_right.x, "Failed: Wrong instance corners");
+		}
+		if (q->image_min_filter == GFX_FILTER_MODE_LINEAR && q->image_mag_filter == GFX_FILTER_MODE_NEAREST) {
+			assert(inst->sampler == 2, "Failed: Expected sampler 2, got %d", inst->sampler);
+		} else {
+			assert(inst->sampler == 0, "Failed: Expected sampler 0, got %d", inst->sampler);
+		}
+		if (q->scissor) {
+			// Flipped to top-down
+			assert(inst->has_scissor && inst->scissor.y1 == 60 && inst->scissor.y2 == 80, "Failed: Scissor should be flipped, got %f %f", inst->scissor.y1, inst->scissor.y2);
+		} else {
+			assert(!inst->has_scissor, "Failed: Quad without scissor got one");
+		}
+	}
+	
+	// Already in z order (with equal & negative z) needs no sort and keeps draw order
+	for (u64 i = 0; i < quad_count; i++) quads[i].z = (s32)(i/3)-10;
+	assert(!gfx_batch_z_sort(&batch, quads, quad_count), "Failed: Quads in z order should not be sorted");
+	gfx_batch_build(&batch, quads, quad_count, scissors, true, 100, 100);
+	for (u64 i = 0; i < quad_count; i++) {
+		assert(batch.instances[i].color.w == (f32)i, "Failed: Quads in z order should keep draw order");
+	}
+	
+	// Negative z spanning several radix passes, stable within a layer
+	for (u64 i = 0; i < quad_count; i++) quads[i].z = (i%2) ? -MAX_Z+1+(s32)(i%5) : MAX_Z-(s32)(i%7);
+	assert(gfx_batch_z_sort(&batch, quads, quad_count), "Failed: Quads out of z order should be sorted");
+	for (u64 i = 1; i < quad_count; i++) {
+		Gfx_Sort_Key *prev = &batch.sort_keys[i-1];
+		Gfx_Sort_Key *key = &batch.sort_keys[i];
+		assert(prev->z < key->z || (prev->z == key->z && prev->quad_index < key->quad_index), "Failed: Bad z sort at %llu (%d, %d)", i, prev->z, key->z);
+	}
+	
+	// Big enough to write instances on the job system, which should give the same result
+	u64 big_count = max(GFX_BATCH_PARALLEL_MIN_QUADS, 40000);
+	Draw_Quad *big = alloc(heap, big_count*sizeof(Draw_Quad));
+	for (u64 i = 0; i < big_count; i++) {
+		Draw_Quad q = quads[i%quad_count];
+		q.color.w = (f32)i;
+		q.z = (s32)(get_random()%16);
+		q.image = &images[get_random()%image_count];
+		big[i] = q;
+	}
+	// Several workers even on a single core machine, so ranges really are written by other threads
+	bool was_initted = job_system.initted;
+	if (was_initted) job_system_shutdown();
+	job_system_init(4);
+	gfx_batch_build(&batch, big, big_count, scissors, true, 100, 100);
+	job_system_shutdown();
+	if (was_initted) job_system_init(0);
+	assert(batch.instance_count == big_count, "Failed: Expected %llu instances, got %llu", big_count, batch.instance_count);
+	u64 call_index = 0;
+	for (u64 i = 0; i < big_count; i++) {
+		while (i >= batch.draw_calls[call_index].first_instance+batch.draw_calls[call_index].instance_count) call_index += 1;
+		Gfx_Quad_Instance *inst = &batch.instances[i];
+		Draw_Quad *q = &big[(u64)inst->color.w];
+		assert(i == 0 || batch.instances[i-1].color.w < inst->color.w || big[(u64)batch.instances[i-1].color.w].z < q->z, "Failed: Big batch is not sorted");
+		assert(batch.draw_calls[call_index].textures[inst->texture_index] == q->image->gfx_handle, "Failed: Big batch has the wrong texture at %llu", i);
+		assert(q->type == QUAD_TYPE_TEXT || (inst->corners[1].y == q->top_left.y && inst->corners[3].x == q->bottom_right.x), "Failed: Big batch has wrong corners at %llu", i);
+		assert(inst->has_scissor == (q->scissor != 0), "Failed: Big batch has the wrong scissor at %llu", i);
+	}
+	dealloc(heap, big);
+	
+	gfx_batch_build(&batch, quads, 0, scissors, true, 100, 100);
+	assert(batch.instance_count == 0 && batch.draw_call_count == 0, "Failed: Empty build should give nothing to draw");
+	
+	gfx_batch_destroy(&batch);
+	dealloc(heap, quads);
+}
+
+void test_window_scissors() {
+	reset_draw_frame(&draw_frame);
+	
+	// More scissors in a frame than the stack is deep, pushed and popped one by one
+	const u64 rect_count = SCISSOR_STACK_MAX*2+10;
+	for (u64 i = 0; i < rect_count; i++) {
+		push_window_scissor(v2((f32)i, 0), v2((f32)i+1, 10));
+		draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+		pop_window_scissor();
+	}
+	assert(draw_frame.scissor_rect_count == rect_count, "Failed: Expected %llu scissor rects, got %llu", rect_count, draw_frame.scissor_rect_count);
+	assert(allocated_scissors >= rect_count, "Failed: Scissor buffer didn't grow");
+	for (u64 i = 0; i < rect_count; i++) {
+		Draw_Quad *q = &quad_buffer[i];
+		assert(q->scissor == i+1, "Failed: Quad %llu has scissor %d", i, (int)q->scissor);
+		assert(scissor_buffer[q->scissor-1].x1 == (f32)i, "Failed: Quad %llu points at the wrong scissor rect", i);
+	}
+	
+	// The same rect pushed again is reused, nested scissors still pop back to the outer one
+	push_window_scissor(v2(0, 0), v2(5, 5));
+	push_window_scissor(v2(0, 0), v2(5, 5));
+	assert(draw_frame.scissor_rect_count == rect_count+1, "Failed: Same rect should be reused");
+	push_window_scissor(v2(1, 1), v2(2, 2));
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	pop_window_scissor();
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	pop_window_scissor();
+	pop_window_scissor();
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	u64 n = draw_frame.num_quads;
+	assert(quad_buffer[n-3].scissor == rect_count+2, "Failed: Inner scissor");
+	assert(quad_buffer[n-2].scissor == rect_count+1, "Failed: Outer scissor after pop");
+	assert(quad_buffer[n-1].scissor == 0, "Failed: No scissor after popping all");
+	
+	reset_draw_frame(&draw_frame);
+	assert(draw_frame.scissor_rect_count == 0 && draw_frame.scissor_stack_depth == 0, "Failed: Scissors should be reset with the frame");
+}
+
+void test_gfx_atlas() {
+	Allocator heap = get_heap_allocator();
+	
+	const u64 image_count = 300;
+	Gfx_Image *images[300];
+	u32 *pixels = alloc(heap, 64*64*sizeof(u32));
+	for (u64 i = 0; i < 64*64; i++) pixels[i] = 0xff00ff00;
+	for (u64 i = 0; i < image_count; i++) {
+		u32 w = (u32)get_random_int_in_range(1, 64);
+		u32 h = (u32)get_random_int_in_range(1, 64);
+		images[i] = make_image(w, h, 4, pixels, heap);
+		assert(images[i]->atlas_page, "Failed: Small image should be put in an atlas page");
+		assert(images[i]->gfx_handle == images[i]->atlas_page->image->gfx_handle, "Failed: Atlased image should have the page's handle");
+	}
+	
+	// Rects with their padding stay inside the page and don't overlap
+	for (u64 i = 0; i < image_count; i++) {
+		Gfx_Image *a = images[i];
+		assert(a->atlas_x >= GFX_ATLAS_PADDING && a->atlas_y >= GFX_ATLAS_PADDING, "Failed: No room for padding");
+		assert(a->atlas_x+a->width+GFX_ATLAS_PADDING <= GFX_ATLAS_PAGE_SIZE && a->atlas_y+a->height+GFX_ATLAS_PADDING <= GFX_ATLAS_PAGE_SIZE, "Failed: Image outside of page");
+		for (u64 j = i+1; j < image_count; j++) {
+			Gfx_Image *b = images[j];
+			if (a->atlas_page != b->atlas_page) continue;
+			bool apart = a->atlas_x+a->width+GFX_ATLAS_PADDING <= b->atlas_x-GFX_ATLAS_PADDING
+			          || b->atlas_x+b->width+GFX_ATLAS_PADDING <= a->atlas_x-GFX_ATLAS_PADDING
+			          || a->atlas_y+a->height+GFX_ATLAS_PADDING <= b->atlas_y-GFX_ATLAS_PADDING
+			          || b->atlas_y+b->height+GFX_ATLAS_PADDING <= a->atlas_y-GFX_ATLAS_PADDING;
+			assert(apart, "Failed: Atlas images %llu and %llu overlap", i, j);
+		}
+	}
+	gfx_set_image_data(images[0], 0, 0, images[0]->width, 1, pixels);
+	
+	// Too big, or not 4 channels
+	Gfx_Image *big = make_image(GFX_ATLAS_MAX_IMAGE_SIZE+1, 8, 4, 0, heap);
+	Gfx_Image *mono = make_image(8, 8, 1, 0, heap);
+	assert(!big->atlas_page && !mono->atlas_page, "Failed: Image should have its own texture");
+	
+	// Opted out
+	Gfx_Image *own = make_image_ex(16, 16, 4, pixels, heap, GFX_IMAGE_NO_ATLAS);
+	assert(!own->atlas_page && own->flags == GFX_IMAGE_NO_ATLAS, "Failed: GFX_IMAGE_NO_ATLAS image should have its own texture");
+	assert(own->gfx_handle != images[0]->gfx_handle, "Failed: GFX_IMAGE_NO_ATLAS image shares a handle");
+	
+	// 300 images would be 10 draw calls with their own textures, atlased they fit in one
+	reset_draw_frame(&draw_frame);
+	for (u64 i = 0; i < image_count; i++) {
+		draw_image(images[i], v2(0, 0), v2(1, 1), v4(1, 1, 1, (f32)i));
+	}
+	Gfx_Batch batch = ZERO(Gfx_Batch);
+	gfx_batch_build(&batch, quad_buffer, draw_frame.num_quads, scissor_buffer, false, 100, 100);
+	assert(batch.draw_call_count == 1, "Failed: Expected 1 draw call, got %llu", batch.draw_call_count);
+	for (u64 i = 0; i < image_count; i++) {
+		Vector4 uv = batch.instances[i].uv;
+		Vector4 expected = images[i]->atlas_uv;
+		assert(fabs(uv.x1-expected.x1) < 0.00001f && fabs(uv.y2-expected.y2) < 0.00001f, "Failed: Quad uv should be mapped into the atlas page");
+	}
+	gfx_batch_destroy(&batch);
+	reset_draw_frame(&draw_frame);
+	
+	// Pages are emptied when their last image is deleted
+	Gfx_Atlas_Page *page = images[0]->atlas_page;
+	for (u64 i = 0; i < image_count; i++) delete_image(images[i]);
+	assert(page->image_count == 0 && page->skyline_count == 1, "Failed: Page should be empty");
+	Gfx_Image *again = make_image(16, 16, 4, 0, heap);
+	assert(again->atlas_page == &gfx_atlas.pages[0] && again->atlas_x == GFX_ATLAS_PADDING && again->atlas_y == GFX_ATLAS_PADDING, "Failed: Empty page should be reused");
+	
+	delete_image(again);
+	delete_image(big);
+	delete_image(mono);
+	delete_image(own);
+	dealloc(heap, pixels);
+}
+
+void test_sprite_atlas() {
+	Allocator heap = get_heap_allocator();
+	
+	// Each sprite is filled with its own color
+	const u64 sprite_count = 40;
+	Sprite_Atlas_Bake_Image bake[40];
+	for (u64 i = 0; i < sprite_count; i++) {
+		u32 w = (u32)get_random_int_in_range(1, 100);
+		u32 h = (u32)get_random_int_in_range(1, 100);
+		if (i < 2) {
+			// Two of these don't fit in one page
+			w = GFX_ATLAS_PAGE_SIZE-2;
+			h = GFX_ATLAS_PAGE_SIZE/2;
+		}
+		u32 color = 0xff000000 | (u32)(i+1);
+		u32 *pixels = alloc(heap, w*h*sizeof(u32));
+		for (u64 p = 0; p < w*h; p++) pixels[p] = color;
+		bake[i] = (Sprite_Atlas_Bake_Image){ tprint("sprite_%llu", i), w, h, (u8*)pixels, v2(0.5, (f32)i/100.0) };
+	}
+	
+	string path = STR("test_sprite_atlas.atlas");
+	assert(bake_sprite_atlas_from_images(bake, sprite_count, path), "Failed: Could not bake sprite atlas");
+	
+	// Duplicate names are refused
+	bake[1].name = bake[0].name;
+	assert(!bake_sprite_atlas_from_images(bake, 2, STR("test_sprite_atlas_bad.atlas")), "Failed: Duplicate names should fail to bake");
+	bake[1].name = STR("sprite_1");
+	
+	Sprite_Atlas atlas;
+	assert(sprite_atlas_load(&atlas, path, heap), "Failed: Could not load sprite atlas");
+	assert(atlas.sprite_count == sprite_count, "Failed: Expected %llu sprites, got %llu", sprite_count, atlas.sprite_count);
+	assert(atlas.page_count >= 2, "Failed: Expected the big sprites on separate pages");
+	
+	string file;
+	assert(os_read_entire_file(path, &file, heap), "Failed: Could not read back sprite atlas");
+	Sprite_Atlas_File_Page *file_pages = (Sprite_Atlas_File_Page*)(file.data+sizeof(Sprite_Atlas_File_Header));
+	
+	for (u64 i = 0; i < sprite_count; i++) {
+		s64 index = sprite_atlas_find(&atlas, bake[i].name);
+		assert(index >= 0, "Failed: Sprite '%s' not found", bake[i].name);
+		
+		Sprite_Atlas_Sprite *sprite = &atlas.sprites[index];
+		Gfx_Image *image = sprite_atlas_get(&atlas, bake[i].name);
+		Gfx_Atlas_Page *page = &atlas.pages[sprite->page];
+		assert(image == &atlas.images[index], "Failed: sprite_atlas_get and sprite_atlas_find disagree");
+		assert(image->width == bake[i].width && image->height == bake[i].height, "Failed: Sprite has the wrong size");
+		assert(image->atlas_page == page && image->gfx_handle == page->image->gfx_handle, "Failed: Sprite should use its page's texture");
+		assert(fabs(image->atlas_uv.x2 - (f32)(sprite->x+sprite->width)/(f32)page->image->width) < 0.00001f, "Failed: Sprite uv doesn't match its rect");
+		assert(sprite->pivot_y == bake[i].pivot.y, "Failed: Pivot not stored");
+		
+		// The pixels and the repeated edges are in the page
+		u32 *page_pixels = (u32*)(file.data+file_pages[sprite->page].pixels_offset);
+		u32 page_width = file_pages[sprite->page].width;
+		u32 color = 0xff000000 | (u32)(i+1);
+		u32 right = sprite->x+sprite->width;
+		u32 top = sprite->y+sprite->height;
+		assert(page_pixels[sprite->y*page_width+sprite->x] == color, "Failed: Sprite pixels missing");
+		assert(page_pixels[(sprite->y-1)*page_width+sprite->x-1] == color, "Failed: Padding corner missing");
+		assert(page_pixels[top*page_width+right] == color, "Failed: Padding corner missing");
+		assert(page_pixels[(top-1)*page_width+right-1] == color, "Failed: Sprite pixels missing");
+	}
+	assert(sprite_atlas_find(&atlas, STR("sprite_")) == -1, "Failed: Found a sprite that doesn't exist");
+	assert(sprite_atlas_get(&atlas, STR("nope")) == 0, "Failed: Found a sprite that doesn't exist");
+	
+	// Sprites on the same page are drawn with one texture
+	reset_draw_frame(&draw_frame);
+	for (u64 i = 0; i < sprite_count; i++) {
+		draw_image(&atlas.images[i], v2(0, 0), v2(1, 1), COLOR_WHITE);
+	}
+	Gfx_Batch batch = ZERO(Gfx_Batch);
+	gfx_batch_build(&batch, quad_buffer, draw_frame.num_quads, scissor_buffer, false, 100, 100);
+	assert(batch.draw_call_count == 1 && batch.draw_calls[0].texture_count == atlas.page_count, "Failed: Expected 1 draw call with %llu textures", atlas.page_count);
+	for (u64 i = 0; i < sprite_count; i++) {
+		Vector4 uv = batch.instances[i].uv;
+		assert(fabs(uv.x1-atlas.images[i].atlas_uv.x1) < 0.00001f && fabs(uv.y2-atlas.images[i].atlas_uv.y2) < 0.00001f, "Failed: Quad uv should be mapped into the sprite's rect");
+	}
+	gfx_batch_destroy(&batch);
+	reset_draw_frame(&draw_frame);
+	
+	// Garbage is refused
+	string garbage = STR("not an atlas, definitely not an atlas");
+	assert(os_write_entire_file(STR("test_sprite_atlas_bad.atlas"), garbage), "Failed: Could not write test file");
+	Sprite_Atlas bad;
+	assert(!sprite_atlas_load(&bad, STR("test_sprite_atlas_bad.atlas"), heap), "Failed: Garbage should not load");
+	
+	sprite_atlas_unload(&atlas);
+	assert(atlas.sprite_count == 0 && atlas.images == 0, "Failed: Atlas should be cleared on unload");
+	
+	dealloc_string(heap, file);
+	for (u64 i = 0; i < sprite_count; i++) dealloc(heap, bake[i].pixels);
+	os_file_delete(path);
+	os_file_delete(STR("test_sprite_atlas_bad.atlas"));
+}
+
+void test_static_batch() {
+	reset_draw_frame(&draw_frame);
+	draw_rect(v2(0, 0), v2(0.1, 0.1), COLOR_WHITE);
+	u64 frame_quads = draw_frame.num_quads;
+	
+	// The frame's camera is ignored & nothing is culled while recording
+	draw_frame.view = m4_make_translation(v3(100, 0, 0));
+	Matrix4 view = draw_frame.view;
+	Static_Batch sb = ZERO(Static_Batch);
+	static_batch_begin(&sb);
+	for (u64 i = 0; i < 100; i++) {
+		push_z_layer((s32)(100-i));
+		draw_rect(v2((f32)i*10, -5), v2(10, 10), v4(1, 1, 1, (f32)i));
+		pop_z_layer();
+	}
+	static_batch_end(&sb);
+	
+	assert(draw_frame.num_quads == frame_quads, "Failed: Recorded quads should not be in the frame");
+	assert(bytes_match(&draw_frame.view, &view, sizeof(Matrix4)), "Failed: Frame view should be restored");
+	assert(sb.batch.instance_count == 100 && sb.batch.draw_call_count == 1, "Failed: Expected 100 instances in 1 draw call, got %llu in %llu", sb.batch.instance_count, sb.batch.draw_call_count);
+	
+	// World space, sorted by z
+	for (u64 i = 0; i < 100; i++) {
+		Gfx_Quad_Instance *instance = &sb.batch.instances[i];
+		assert(instance->color.w == (f32)(99-i), "Failed: Static batch should be z sorted");
+		assert(instance->corners[0].x == (f32)(99-i)*10 && instance->corners[2].y == 5, "Failed: Static batch should be in world space");
+	}
+	assert(sb.bounds_min.x == 0 && sb.bounds_min.y == -5 && sb.bounds_max.x == 1000 && sb.bounds_max.y == 5, "Failed: Wrong static batch bounds");
+	
+	// Drawn with the camera at the time of drawing, culled as a whole
+	draw_frame.view = m4_make_translation(v3(500, 0, 0));
+	assert(draw_static_batch(&sb), "Failed: Static batch should be visible");
+	Static_Batch_Draw *d = &draw_frame.static_batch_draws[0];
+	Matrix4 world_to_clip = get_world_to_clip();
+	assert(draw_frame.static_batch_draw_count == 1 && d->batch == &sb, "Failed: Static batch not in the frame");
+	assert(bytes_match(&d->world_to_clip, &world_to_clip, sizeof(Matrix4)), "Failed: Static batch should be drawn with the current camera");
+	draw_frame.view = m4_make_translation(v3(-500, 0, 0));
+	assert(!draw_static_batch(&sb), "Failed: Static batch out of view should be culled");
+	assert(draw_frame.static_batch_draw_count == 1, "Failed: Culled static batch should not be in the frame");
+	
+#if GFX_RENDERER == GFX_RENDERER_NULL
+	// Uploaded once, until recorded again
+	gfx_update();
+	assert(null_renderer_last_frame.static_batch_count == 1 && null_renderer_last_frame.static_instance_count == 100, "Failed: Static batch not rendered");
+	assert(null_renderer_last_frame.upload_bytes == (100+frame_quads)*sizeof(Gfx_Quad_Instance), "Failed: Static batch should be uploaded on first draw");
+	draw_static_batch(&sb);
+	gfx_update();
+	assert(null_renderer_last_frame.static_batch_count == 1 && null_renderer_last_frame.upload_bytes == 0, "Failed: Unchanged static batch should not be uploaded again");
+	static_batch_begin(&sb);
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	static_batch_end(&sb);
+	draw_static_batch(&sb);
+	gfx_update();
+	assert(null_renderer_last_frame.upload_bytes == sizeof(Gfx_Quad_Instance), "Failed: Recorded static batch should be uploaded again");
+	
+	// A static batch is under the frame's quads, whatever their z layers
+	static_batch_begin(&sb);
+	push_z_layer(100);
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	pop_z_layer();
+	static_batch_end(&sb);
+	push_z_layer(-100);
+	draw_rect(v2(0, 0), v2(0.1, 0.1), COLOR_RED);
+	pop_z_layer();
+	draw_static_batch(&sb);
+	gfx_update();
+	assert(null_renderer_last_frame.draw_call_count == 2 && null_renderer_last_frame.first_frame_draw_call == 1, "Failed: Static batch should be drawn before the frame's quads");
+	
+	// Cleared after it was drawn in the same frame, the renderer skips it
+	draw_static_batch(&sb);
+	static_batch_clear(&sb);
+	gfx_update();
+	assert(null_renderer_last_frame.static_batch_count == 0 && null_renderer_last_frame.upload_bytes == 0, "Failed: Cleared static batch should not be uploaded or drawn");
+	assert(sb.gpu_version == sb.version, "Failed: Cleared static batch should be up to date on the renderer");
+	
+	// Same when recorded empty
+	static_batch_begin(&sb);
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	static_batch_end(&sb);
+	draw_static_batch(&sb);
+	static_batch_begin(&sb);
+	static_batch_end(&sb);
+	gfx_update();
+	assert(null_renderer_last_frame.static_batch_count == 0 && null_renderer_last_frame.upload_bytes == 0, "Failed: Static batch recorded empty should not be uploaded or drawn");
+#endif
+	
+	// Text in a static batch is not snapped to pixels, it's in world space
+	static_batch_begin(&sb);
+	Draw_Quad *text = draw_rect(v2(0.3333f, 0.3333f), v2(1, 1), COLOR_WHITE);
+	text->type = QUAD_TYPE_TEXT;
+	static_batch_end(&sb);
+	assert(sb.batch.instances[0].corners[0].x == 0.3333f && sb.batch.instances[0].corners[0].y == 0.3333f, "Failed: Static batch text should not be pixel snapped");
+	
+	static_batch_clear(&sb);
+	assert(!draw_static_batch(&sb), "Failed: Cleared static batch should not be drawn");
+	static_batch_destroy(&sb);
+	reset_draw_frame(&draw_frame);
+}
+
+#if GFX_RENDERER == GFX_RENDERER_NULL
+void test_render_thread() {
+	reset_draw_frame(&draw_frame);
+	
+	gfx_render_thread_start();
+	assert(gfx_render_thread.running, "Failed: Render thread should be running");
+	
+	for (u64 i = 0; i < 10; i++) {
+		for (u64 j = 0; j < i+1; j++) {
+			draw_rect(v2((f32)j*0.01f, 0), v2(0.01, 0.01), COLOR_WHITE);
+		}
+		Draw_Quad *handed_off = quad_buffer;
+		gfx_update();
+		
+		// The game gets a fresh frame right away, the old one belongs to the render thread now
+		assert(draw_frame.num_quads == 0, "Failed: Draw frame should be reset after the hand off");
+		assert(quad_buffer != handed_off && gfx_render_thread.quads == handed_off, "Failed: Quad buffers should be swapped, not copied");
+		
+		// Drawing the next frame doesn't touch the one in flight
+		draw_rect(v2(0, 0), v2(0.5, 0.5), COLOR_RED);
+		
+		gfx_render_thread_wait();
+		assert(gfx_render_thread.frames_rendered == i+1, "Failed: Expected %llu frames rendered, got %llu", i+1, gfx_render_thread.frames_rendered);
+		assert(null_renderer_last_frame.quad_count == i+1 && null_renderer_last_frame.instance_count == i+1, "Failed: Frame %llu should have %llu quads, got %llu", i, i+1, null_renderer_last_frame.quad_count);
+		reset_draw_frame(&draw_frame);
+	}
+	
+	// The cbuffer is copied with the frame
+	shader_recompile_with_extension(STR(""), sizeof(u64));
+	u64 cbuffer_value = 1234;
+	draw_frame.cbuffer = &cbuffer_value;
+	gfx_update();
+	cbuffer_value = 0;
+	gfx_render_thread_wait();
+	assert(gfx_render_thread.render_frame.cbuffer != &cbuffer_value && *(u64*)gfx_render_thread.render_frame.cbuffer == 1234, "Failed: cbuffer should be copied with the frame");
+	shader_recompile_with_extension(STR(""), 0);
+	
+	// Recording waits for the frame in flight, which might be drawing the batch
+	Static_Batch sb = ZERO(Static_Batch);
+	static_batch_begin(&sb);
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	static_batch_end(&sb);
+	draw_static_batch(&sb);
+	gfx_update();
+	static_batch_begin(&sb);
+	draw_rect(v2(0, 0), v2(1, 1), COLOR_WHITE);
+	draw_rect(v2(1, 0), v2(1, 1), COLOR_WHITE);
+	static_batch_end(&sb);
+	assert(null_renderer_last_frame.static_instance_count == 1, "Failed: Static batch should be rendered before it's recorded again");
+	draw_static_batch(&sb);
+	gfx_update();
+	gfx_render_thread_wait();
+	assert(null_renderer_last_frame.static_instance_count == 2, "Failed: Recorded static batch not rendered");
+	static_batch_destroy(&sb);
+	
+	gfx_render_thread_stop();
+	assert(!gfx_render_thread.running, "Failed: Render thread should be stopped");
+	
+	// Back to rendering in gfx_update()
+	draw_rect(v2(0, 0), v2(0.1, 0.1), COLOR_WHITE);
+	gfx_update();
+	assert(null_renderer_last_frame.quad_count == 1, "Failed: Frame should be rendered in gfx_update() without the render thread");
+	
+	reset_draw_frame(&draw_frame);
+}
+#endif
+
+void test_draw_sprites() {
+	Gfx_Image image = ZERO(Gfx_Image);
+	image.gfx_handle = (Gfx_Handle)1;
+	
+	const u64 count = 1000;
+	Draw_Sprite *sprites = alloc(get_heap_allocator(), count*sizeof(Draw_Sprite));
+	for (u64 i = 0; i < count; i++) {
+		// About half of them off screen
+		sprites[i].position = v2(get_random_float32()*8-4, get_random_float32()*4-2);
+		sprites[i].size = v2(0.5f, 0.25f);
+		sprites[i].color = v4(1, 1, 1, (f32)i);
+		sprites[i].image = (i%2) ? &image : 0;
+	}
+	
+	reset_draw_frame(&draw_frame);
+	draw_frame.view = m4_make_scale(v3(1.5, 1.5, 1));
+	push_z_layer(7);
+	for (u64 i = 0; i < count; i++) {
+		draw_image(sprites[i].image, sprites[i].position, sprites[i].size, sprites[i].color);
+	}
+	u64 expected = draw_frame.num_quads;
+	assert(expected > 0 && expected < count, "Failed: Expected some sprites to be culled, %llu of %llu were drawn", expected, count);
+	
+	u64 drawn = draw_sprites(sprites, count);
+	assert(drawn == expected, "Failed: draw_sprites drew %llu, draw_image drew %llu", drawn, expected);
+	assert(draw_frame.num_quads == expected*2, "Failed: draw_sprites should add to the quad buffer");
+	for (u64 i = 0; i < expected; i++) {
+		Draw_Quad *a = &quad_buffer[i];
+		Draw_Quad *b = &quad_buffer[expected+i];
+		assert(bytes_match(&a->bottom_left, &b->bottom_left, sizeof(Vector2)*4), "Failed: Sprite corners differ from draw_image");
+		assert(a->color.w == b->color.w && a->image == b->image && a->z == 7 && b->z == 7, "Failed: Sprite differs from draw_image");
+	}
+	
+	// Bulk quads keep their own filters
+	Draw_Quad q = quad_buffer[0];
+	q.bottom_left = v2(0, 0); q.top_left = v2(0, 1); q.top_right = v2(1, 1); q.bottom_right = v2(1, 0);
+	q.image_min_filter = GFX_FILTER_MODE_LINEAR;
+	Draw_Quad far = q;
+	far.bottom_left.x += 100; far.top_left.x += 100; far.top_right.x += 100; far.bottom_right.x += 100;
+	Draw_Quad quads[] = {q, far, q};
+	u64 before = draw_frame.num_quads;
+	assert(draw_quads(quads, 3) == 2, "Failed: draw_quads should cull the far quad");
+	assert(draw_frame.num_quads == before+2 && quad_buffer[before].image_min_filter == GFX_FILTER_MODE_LINEAR, "Failed: draw_quads output is wrong");
+	Draw_Quad *single = draw_quad(q);
+	assert(bytes_match(&single->bottom_left, &quad_buffer[before].bottom_left, sizeof(Vector2)*4), "Failed: draw_quads and draw_quad disagree");
+	
+	pop_z_layer();
+	reset_draw_frame(&draw_frame);
+	dealloc(get_heap_allocator(), sprites);
+}
+#endif // OOGABOOGA_HAS_GFX
+
 void oogabooga_run_tests() {
 	
 	print("Testing growing array... ");
@@ -1327,9 +2984,80 @@ void oogabooga_run_tests() {
 	test_random_distribution();
 	print("OK!\n");
 	
+	print("Testing atomics... ");
+	test_atomics();
+	print("OK!\n");
+	
+	print("Testing spinlock... ");
+	test_spinlock();
+	print("OK!\n");
+	
 	print("Testing mutex... ");
 	test_mutex();
 	print("OK!\n");
+	
+	print("Testing queues... ");
+	test_queues();
+	print("OK!\n");
+	
+	print("Testing jobs... ");
+	test_jobs();
+	print("OK!\n");
+	
+	print("Testing parallel for... ");
+	test_parallel_for();
+	print("OK!\n");
+	
+	print("Testing async tasks... ");
+	test_async();
+	print("OK!\n");
+	
+	print("Testing profiler... ");
+	test_profiler();
+	print("OK!\n");
+	
+	print("Testing profiler streaming... ");
+	test_profiler_streaming();
+	print("OK!\n");
+	
+	print("Testing sampling profiler... ");
+	test_sampling_profiler();
+	print("OK!\n");
+	
+	print("Testing frame stats... ");
+	test_frame_stats();
+	print("OK!\n");
+
+#if OOGABOOGA_HAS_GFX
+	print("Testing gfx batch... ");
+	test_gfx_batch();
+	print("OK!\n");
+	
+	print("Testing window scissors... ");
+	test_window_scissors();
+	print("OK!\n");
+	
+	print("Testing gfx atlas... ");
+	test_gfx_atlas();
+	print("OK!\n");
+	
+	print("Testing sprite atlas... ");
+	test_sprite_atlas();
+	print("OK!\n");
+	
+	print("Testing draw sprites... ");
+	test_draw_sprites();
+	print("OK!\n");
+	
+	print("Testing static batch... ");
+	test_static_batch();
+	print("OK!\n");
+#if GFX_RENDERER == GFX_RENDERER_NULL
+	print("Testing render thread... ");
+	test_render_thread();
+	print("OK!\n");
+#endif
+#endif
 
 #ifndef OOGABOOGA_HEADLESS
 	print("Testing radix sort... ");
@@ -18,28 +18,35 @@ void radix_sort(void *collection, void *help_buffer, u64 item_count, u64 item_si
     const int PASS_COUNT = ((number_of_bits + BITS_PER_PASS - 1) / BITS_PER_PASS);
     const u64 SIGN_SHIFT = 1ULL << (number_of_bits - 1);
 
-    u64* count = (u64*)alloc(get_temporary_allocator(), RADIX * sizeof(u64));
+    if (item_count <= 1) return;
+
+    u64* count = (u64*)alloc(get_temporary_allocator(), PASS_COUNT * RADIX * sizeof(u64));
     u64* prefix_sum = (u64*)alloc(get_temporary_allocator(), RADIX * sizeof(u64));
     u8* items = (u8*)collection;
     u8* buffer = (u8*)help_buffer;
 
+    // Count the digits of all passes in one read over the items
+    memset(count, 0, PASS_COUNT * RADIX * sizeof(u64));
+    for (u64 i = 0; i < item_count; ++i) {
+        u64 sort_value = *(u64*)(items + i * item_size + sort_value_offset_in_item);
+        sort_value += SIGN_SHIFT;
+        for (u32 pass = 0; pass < PASS_COUNT; ++pass) {
+            ++count[pass * RADIX + ((sort_value >> (pass * BITS_PER_PASS)) & MASK)];
+        }
+    }
+
     for (u32 pass = 0; pass < PASS_COUNT; ++pass) {
         u32 shift = pass * BITS_PER_PASS;
+        u64 *pass_count = count + pass * RADIX;
 
-        for (u32 i = 0; i < RADIX; ++i) {
-            count[i] = 0;
-        }
-
-        for (u64 i = 0; i < item_count; ++i) {
-            u64 sort_value = *(u64*)(items + i * item_size + sort_value_offset_in_item);
-            sort_value += SIGN_SHIFT; 
-            u32 digit = (sort_value >> shift) & MASK;
-            ++count[digit];
-        }
+        // If every item has the same digit this pass wouldn't move anything.
+        // Common for z, which rarely uses the high bits.
+        u64 first_value = *(u64*)(items + sort_value_offset_in_item) + SIGN_SHIFT;
+        if (pass_count[(first_value >> shift) & MASK] == item_count) continue;
 
         prefix_sum[0] = 0;
         for (u32 i = 1; i < RADIX; ++i) {
-            prefix_sum[i] = prefix_sum[i - 1] + count[i - 1];
+            prefix_sum[i] = prefix_sum[i - 1] + pass_count[i - 1];
         }
 
         for (u64 i = 0; i < item_count; ++i) {
@@ -50,8 +57,13 @@ void radix_sort(void *collection, void *help_buffer, u64 item_count, u64 item_si
             ++prefix_sum[digit];
         }
 
-        memcpy(items, buffer, item_count * item_size);
+        // Ping-pong instead of copying back every pass
+        u8 *temp = items;
+        items = buffer;
+        buffer = temp;
     }
+
+    if (items != (u8*)collection) memcpy(collection, items, item_count * item_size);
 }
 
 void merge_sort(void *collection, void *help_buffer, u64 item_count, u64 item_size, int (*compare)(const void *, const void *)) {